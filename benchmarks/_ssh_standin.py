@@ -0,0 +1,108 @@
+"""
+带真实 SSH 协议的本地替身 (paramiko 服务端)
+
+与 _standin.LocalTransport 不同，这里客户端拿到的是真正的 paramiko.Transport / Channel，
+加密、窗口、控制报文都与连接真实服务器时一致；服务端接受任意密码，direct-tcpip 通道
+一律转到本机的替身目标端口。
+"""
+import select
+import socket
+import threading
+from collections import Counter
+
+import _standin  # noqa: F401  (把 src 加入 sys.path)
+
+import paramiko
+
+_HOST_KEY = None
+
+
+def _host_key() -> paramiko.PKey:
+    global _HOST_KEY
+    if _HOST_KEY is None:
+        _HOST_KEY = paramiko.ECDSAKey.generate()
+    return _HOST_KEY
+
+
+class _Server(paramiko.ServerInterface):
+    def get_allowed_auths(self, username):
+        return "password"
+
+    def check_auth_password(self, username, password):
+        return paramiko.AUTH_SUCCESSFUL
+
+    def check_channel_request(self, kind, chanid):
+        return paramiko.OPEN_FAILED_ADMINISTRATIVELY_PROHIBITED
+
+    def check_channel_direct_tcpip_request(self, chanid, origin, destination):
+        return paramiko.OPEN_SUCCEEDED
+
+
+def _relay(channel, target_port: int):
+    try:
+        sock = socket.create_connection(("127.0.0.1", target_port))
+    except OSError:
+        channel.close()
+        return
+    try:
+        while True:
+            r, _, _ = select.select([sock, channel], [], [])
+            if sock in r:
+                data = sock.recv(65536)
+                if not data:
+                    break
+                channel.sendall(data)
+            if channel in r:
+                data = channel.recv(65536)
+                if not data:
+                    break
+                sock.sendall(data)
+    except Exception:
+        pass
+    finally:
+        sock.close()
+        channel.close()
+
+
+def start_ssh_server(target_port: int) -> int:
+    """启动替身 SSH 服务器，返回端口"""
+    server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server.bind(("127.0.0.1", 0))
+    server.listen(16)
+
+    def serve(conn):
+        t = paramiko.Transport(conn)
+        t.add_server_key(_host_key())
+        t.start_server(server=_Server())
+        while t.is_active():
+            channel = t.accept(1.0)
+            if channel is not None:
+                threading.Thread(target=_relay, args=(channel, target_port), daemon=True).start()
+
+    def loop():
+        while True:
+            conn, _ = server.accept()
+            threading.Thread(target=serve, args=(conn,), daemon=True).start()
+
+    threading.Thread(target=loop, daemon=True).start()
+    return server.getsockname()[1]
+
+
+def connect(port: int) -> paramiko.Transport:
+    t = paramiko.Transport(("127.0.0.1", port))
+    t.connect(username="bench", password="bench")
+    return t
+
+
+def count_messages(transport: paramiko.Transport) -> Counter:
+    """统计客户端经该传输发出的 SSH 消息 (按消息类型号计数)"""
+    counts = Counter()
+    send = transport._send_user_message
+
+    def counting(m):
+        counts[m.asbytes()[0]] += 1
+        return send(m)
+
+    transport._send_user_message = counting
+    return counts
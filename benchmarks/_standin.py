@@ -0,0 +1,90 @@
+"""
+性能测试公用的本地替身
+
+LocalTransport 模拟 paramiko.Transport：open_channel() 直接连到本机的替身目标端口，
+返回的套接字交给 Socks5Server 中继，SOCKS5 / HTTP 代理代码路径与真实连接一致，只是没有 SSH 加密。
+"""
+import socket
+import struct
+import sys
+import threading
+from pathlib import Path
+
+sys.path.insert(0, str(Path(__file__).resolve().parent.parent / "src"))
+
+
+def start_server(handler, host: str = "127.0.0.1") -> int:
+    """启动替身目标服务器，每个连接一个线程调用 handler(conn)，返回端口"""
+    server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server.bind((host, 0))
+    server.listen(1024)
+
+    def loop():
+        while True:
+            conn, _ = server.accept()
+            threading.Thread(target=handler, args=(conn,), daemon=True).start()
+
+    threading.Thread(target=loop, daemon=True).start()
+    return server.getsockname()[1]
+
+
+def echo_handler(conn: socket.socket):
+    try:
+        while True:
+            data = conn.recv(65536)
+            if not data:
+                break
+            conn.sendall(data)
+    except OSError:
+        pass
+    finally:
+        conn.close()
+
+
+def sink_handler(conn: socket.socket):
+    """读空全部数据，结束时回一个字节确认"""
+    try:
+        while conn.recv(1 << 20):
+            pass
+        conn.sendall(b"\x00")
+    except OSError:
+        pass
+    finally:
+        conn.close()
+
+
+class LocalTransport:
+    """替身 Transport：所有 direct-tcpip 目标都连到同一个本地端口"""
+
+    def __init__(self, target_port: int):
+        self.target_port = target_port
+        self.opens = 0
+
+    def is_active(self) -> bool:
+        return True
+
+    def open_channel(self, kind, dest_addr, src_addr=None, timeout=None, **kwargs):
+        self.opens += 1
+        return socket.create_connection(("127.0.0.1", self.target_port), timeout=timeout)
+
+
+def socks5_connect(port: int, host: str = "bench.test", dest_port: int = 80) -> socket.socket:
+    sock = socket.create_connection(("127.0.0.1", port))
+    sock.sendall(b"\x05\x01\x00")
+    if sock.recv(2) != b"\x05\x00":
+        raise OSError("SOCKS5 握手失败")
+    hb = host.encode()
+    sock.sendall(b"\x05\x01\x00\x03" + bytes([len(hb)]) + hb + struct.pack("!H", dest_port))
+    reply = sock.recv(10)
+    if len(reply) < 2 or reply[1] != 0x00:
+        raise OSError("SOCKS5 CONNECT 失败")
+    return sock
+
+
+def free_port() -> int:
+    s = socket.socket()
+    s.bind(("127.0.0.1", 0))
+    port = s.getsockname()[1]
+    s.close()
+    return port
@@ -0,0 +1,135 @@
+"""
+SSH 控制报文开销：paramiko 默认 vs 合并窗口调整 + 后台批量关闭 (channel_ctl.py)
+
+客户端经真实的 paramiko 会话连到本地替身 SSH 服务器 (_ssh_standin.py)，模拟网页请求:
+每条连接发一个小请求、收一个大小不等的响应后关闭。统计客户端发出的 SSH 消息，报告:
+  - 每请求的 CHANNEL_OPEN / WINDOW_ADJUST / EOF+CLOSE 个数
+  - 统计页 control_packets 指标 (估算值) 与实测的对照
+  - 每秒完成的请求数
+
+用法:
+  python benchmarks/bench_control.py
+  python benchmarks/bench_control.py --requests 500 --workers 16 --tuning latency
+"""
+import argparse
+import random
+import threading
+import time
+
+from _ssh_standin import connect, count_messages, start_ssh_server
+from _standin import free_port, socks5_connect, start_server
+
+from ssh_tunnel_vpn import channel_ctl, fastpath
+from ssh_tunnel_vpn.ssh_tunnel import Socks5Server
+from ssh_tunnel_vpn.tuning import apply_transport, get_profile
+
+MSG_CHANNEL_OPEN = 90
+MSG_CHANNEL_WINDOW_ADJUST = 93
+MSG_CHANNEL_EOF = 96
+MSG_CHANNEL_CLOSE = 97
+
+_REQUEST = b"GET / HTTP/1.1\r\nHost: bench.test\r\n\r\n"
+
+
+def respond_handler(conn):
+    """读到请求后回一个响应：首 4 字节为响应长度"""
+    try:
+        data = conn.recv(4096)
+        if data:
+            size = int.from_bytes(data[:4], "big")
+            conn.sendall(b"\0" * size)
+    except OSError:
+        pass
+    finally:
+        conn.close()
+
+
+def response_sizes(n: int, seed: int = 3) -> list:
+    """网页资源大小分布: 多数几 KB 到几十 KB，少数数百 KB 到数 MB"""
+    rnd = random.Random(seed)
+    sizes = []
+    for _ in range(n):
+        r = rnd.random()
+        if r < 0.7:
+            sizes.append(rnd.randint(1, 64) * 1024)
+        elif r < 0.95:
+            sizes.append(rnd.randint(64, 1024) * 1024)
+        else:
+            sizes.append(rnd.randint(1, 8) * 1024 * 1024)
+    return sizes
+
+
+def _worker(port: int, sizes: list, errors: list):
+    for size in sizes:
+        try:
+            sock = socks5_connect(port)
+            sock.sendall(size.to_bytes(4, "big") + _REQUEST)
+            got = 0
+            while True:
+                data = sock.recv(1 << 20)
+                if not data:
+                    break
+                got += len(data)
+            sock.close()
+            if got != size:
+                errors.append(size)
+        except OSError:
+            errors.append(size)
+
+
+def run(ssh_port: int, tuning: str, enabled: bool, sizes: list, workers: int) -> tuple:
+    channel_ctl.ENABLED = enabled
+    transport = connect(ssh_port)
+    apply_transport(transport, get_profile(tuning))
+    counts = count_messages(transport)
+    server = Socks5Server(transport, free_port(), tuning=get_profile(tuning))
+    server.start()
+    errors = []
+    try:
+        chunks = [sizes[i::workers] for i in range(workers)]
+        threads = [threading.Thread(target=_worker, args=(server.bind_port, c, errors)) for c in chunks]
+        t0 = time.perf_counter()
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        dt = time.perf_counter() - t0
+        # 等后台关闭线程发完 EOF/CLOSE
+        deadline = time.time() + 5
+        while counts[MSG_CHANNEL_CLOSE] < counts[MSG_CHANNEL_OPEN] and time.time() < deadline:
+            time.sleep(0.05)
+        estimated = server.get_stats()["control_packets"]
+    finally:
+        server.stop()
+        transport.close()
+    return counts, estimated, len(sizes) / dt, len(errors)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--requests", type=int, default=300, help="请求数")
+    parser.add_argument("--workers", type=int, default=8, help="并发请求数")
+    parser.add_argument("--tuning", default="latency", help="调优档位 (决定通道窗口)")
+    args = parser.parse_args()
+
+    fastpath.AVAILABLE = False
+    target_port = start_server(respond_handler)
+    ssh_port = start_ssh_server(target_port)
+    sizes = response_sizes(args.requests)
+    print(f"{args.requests} 个请求，下行共 {sum(sizes) / 1e6:.1f} MB，并发 {args.workers}，"
+          f"窗口 {get_profile(args.tuning).window_size // 1024} KB")
+
+    print(f"{'模式':<10}{'OPEN':>8}{'W_ADJ':>8}{'EOF+CLOSE':>11}{'合计/请求':>11}{'估算/请求':>11}{'请求/秒':>10}{'失败':>6}")
+    for name, enabled in (("default", False), ("batched", True)):
+        counts, estimated, rate, failed = run(ssh_port, args.tuning, enabled, sizes, args.workers)
+        n = args.requests
+        opens = counts[MSG_CHANNEL_OPEN] / n
+        adjusts = counts[MSG_CHANNEL_WINDOW_ADJUST] / n
+        closes = (counts[MSG_CHANNEL_EOF] + counts[MSG_CHANNEL_CLOSE]) / n
+        print(f"{name:<10}{opens:>8.2f}{adjusts:>8.2f}{closes:>11.2f}{opens + adjusts + closes:>13.2f}"
+              f"{estimated / n:>13.2f}{rate:>12.1f}{failed:>6}")
+    channel_ctl.ENABLED = True
+
+
+if __name__ == "__main__":
+    main()
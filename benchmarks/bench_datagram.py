@@ -0,0 +1,282 @@
+"""
+UDP 数据通道 (datagram.py): 丢包链路上独立流 vs 单条有序流 的请求延迟，及大块吞吐
+
+客户端与伴随进程端的 DatagramSession 都在本进程内，中间插一个按比例随机丢包、
+加单向时延的 UDP 中继。每种丢包率下报告:
+  - 有后台传输 (匀速的大块回显，模拟下载) 时小请求的往返延迟 p50 / p99:
+    每个请求方和后台传输各用一条流 (streams)，或全部按帧复用同一条流 (single，等价于
+    所有通道挤在一条 TCP 连接上的队头阻塞)；两种模式的拥塞控制、加密、重传完全相同，
+    差别只在丢包是否拖住其他请求
+  - 单流大块回显吞吐与重传包数
+
+用法:
+  python benchmarks/bench_datagram.py
+  python benchmarks/bench_datagram.py --loss 0,0.02,0.05 --delay 20 --workers 16
+"""
+import argparse
+import heapq
+import os
+import random
+import selectors
+import socket
+import statistics
+import struct
+import threading
+import time
+
+from _standin import echo_handler
+
+from ssh_tunnel_vpn.datagram import DatagramSession
+
+# 复用帧: 类型 u8 | 请求号 u32 | 长度 u16 | 数据
+_FRAME = struct.Struct(">BIH")
+_REQ, _BULK = 1, 2
+_REQ_SIZE = 32
+_BULK_CHUNK = 8192
+
+
+def start_lossy(target: tuple, loss: float, delay: float, seed: int = 1) -> tuple:
+    """UDP 中继: 两个方向各按 loss 随机丢包、加 delay 秒单向时延；返回 (端口, 停止函数)"""
+    rnd = random.Random(seed)
+    front = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    back = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    for s in (front, back):
+        s.bind(("127.0.0.1", 0))
+        s.setblocking(False)
+        s.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 8 << 20)
+    sel = selectors.DefaultSelector()
+    sel.register(front, selectors.EVENT_READ)
+    sel.register(back, selectors.EVENT_READ)
+    client = [None]
+    heap = []
+    seq = [0]
+    running = [True]
+
+    def loop():
+        while running[0]:
+            timeout = max(0.0, heap[0][0] - time.monotonic()) if heap else 0.2
+            for key, _ in sel.select(min(timeout, 0.2)):
+                while True:
+                    try:
+                        data, addr = key.fileobj.recvfrom(65536)
+                    except (BlockingIOError, InterruptedError):
+                        break
+                    if key.fileobj is front:
+                        client[0] = addr
+                        dst = (back, target)
+                    else:
+                        dst = (front, client[0])
+                    if rnd.random() < loss:
+                        continue
+                    seq[0] += 1
+                    heapq.heappush(heap, (time.monotonic() + delay, seq[0], dst, data))
+            now = time.monotonic()
+            while heap and heap[0][0] <= now:
+                _, _, (s, addr), data = heapq.heappop(heap)
+                try:
+                    s.sendto(data, addr)
+                except OSError:
+                    pass
+        front.close()
+        back.close()
+
+    threading.Thread(target=loop, daemon=True).start()
+
+    def stop():
+        running[0] = False
+
+    return front.getsockname()[1], stop
+
+
+def _session(loss: float, delay: float) -> tuple:
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("127.0.0.1", 0))
+    secret = os.urandom(32)
+
+    def on_stream(conn):
+        threading.Thread(target=echo_handler, args=(conn,), daemon=True).start()
+
+    server = DatagramSession(sock, secret, client=False, on_stream=on_stream)
+    server.start()
+    port, stop_relay = start_lossy(sock.getsockname(), loss, delay)
+    client = DatagramSession.connect("127.0.0.1", port, secret, timeout=10)
+
+    def close():
+        client.close()
+        server.close()
+        stop_relay()
+
+    return client, close
+
+
+def _recv_exact(sock: socket.socket, n: int) -> bytes:
+    buf = bytearray()
+    while len(buf) < n:
+        data = sock.recv(n - len(buf))
+        if not data:
+            raise ConnectionError("流提前关闭")
+        buf += data
+    return bytes(buf)
+
+
+def _drain(conn: socket.socket):
+    try:
+        while conn.recv(65536):
+            pass
+    except OSError:
+        pass
+
+
+def _pace(send, rate: float, stop: threading.Event):
+    """按 rate (B/s) 匀速发送 _BULK_CHUNK 大小的块，直到 stop"""
+    gap = _BULK_CHUNK / rate
+    nxt = time.perf_counter()
+    while not stop.is_set():
+        send()
+        nxt += gap
+        time.sleep(max(0.0, nxt - time.perf_counter()))
+
+
+def latency_streams(client: DatagramSession, workers: int, requests: int, interval: float,
+                    rate: float) -> list:
+    """每个请求方独占一条流，后台传输也单独一条流"""
+    samples = []
+    lock = threading.Lock()
+    stop = threading.Event()
+    bulk_conn = client.open_stream()
+    chunk = os.urandom(_BULK_CHUNK)
+    threading.Thread(target=_drain, args=(bulk_conn,), daemon=True).start()
+    pacer = threading.Thread(target=_pace, args=(lambda: bulk_conn.sendall(chunk), rate, stop))
+    pacer.start()
+
+    def worker(i):
+        conn = client.open_stream()
+        conn.settimeout(60)
+        req = os.urandom(_REQ_SIZE)
+        for n in range(requests):
+            t0 = time.perf_counter()
+            conn.sendall(req)
+            _recv_exact(conn, _REQ_SIZE)
+            with lock:
+                samples.append((time.perf_counter() - t0) * 1000)
+            time.sleep(interval)
+        conn.close()
+
+    threads = [threading.Thread(target=worker, args=(i,)) for i in range(workers)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    stop.set()
+    pacer.join()
+    bulk_conn.close()
+    return samples
+
+
+def latency_single(client: DatagramSession, workers: int, requests: int, interval: float,
+                   rate: float) -> list:
+    """请求与后台传输按帧复用同一条流 (与全部通道共用一条 TCP 连接相同): 回显按发送顺序返回，
+    一个丢包拖住其后的全部帧"""
+    conn = client.open_stream()
+    conn.settimeout(60)
+    send_lock = threading.Lock()
+    waiting = {}
+    samples = []
+    stop = threading.Event()
+    bulk_frame = _FRAME.pack(_BULK, 0, _BULK_CHUNK) + os.urandom(_BULK_CHUNK)
+
+    def send(frame: bytes):
+        with send_lock:
+            conn.sendall(frame)
+
+    def reader():
+        try:
+            while True:
+                kind, rid, n = _FRAME.unpack(_recv_exact(conn, _FRAME.size))
+                _recv_exact(conn, n)
+                if kind == _REQ:
+                    ev, t0 = waiting.pop(rid)
+                    samples.append((time.perf_counter() - t0) * 1000)
+                    ev.set()
+        except (OSError, ConnectionError):
+            pass
+
+    def worker(i):
+        payload = os.urandom(_REQ_SIZE)
+        for n in range(requests):
+            rid = i * requests + n
+            ev = threading.Event()
+            waiting[rid] = (ev, time.perf_counter())
+            send(_FRAME.pack(_REQ, rid, _REQ_SIZE) + payload)
+            ev.wait(60)
+            time.sleep(interval)
+
+    threading.Thread(target=reader, daemon=True).start()
+    pacer = threading.Thread(target=_pace, args=(lambda: send(bulk_frame), rate, stop))
+    pacer.start()
+    threads = [threading.Thread(target=worker, args=(i,)) for i in range(workers)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    stop.set()
+    pacer.join()
+    conn.close()
+    return samples
+
+
+def bulk(client: DatagramSession, size: int) -> float:
+    conn = client.open_stream()
+    conn.settimeout(60)
+    data = os.urandom(size)
+    t0 = time.perf_counter()
+    sender = threading.Thread(target=conn.sendall, args=(data,))
+    sender.start()
+    got = _recv_exact(conn, size)
+    sender.join()
+    dt = time.perf_counter() - t0
+    conn.close()
+    if got != data:
+        raise Exception("回显数据不一致")
+    return size / dt / 1e6
+
+
+def _pct(samples: list, q: float) -> float:
+    s = sorted(samples) or [float("nan")]
+    return s[min(len(s) - 1, int(len(s) * q))]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--loss", default="0,0.02,0.05", help="丢包率列表 (逗号分隔)")
+    parser.add_argument("--delay", type=float, default=20, help="单向时延 (ms)")
+    parser.add_argument("--workers", type=int, default=16, help="并发请求方")
+    parser.add_argument("--requests", type=int, default=40, help="每个请求方的请求数")
+    parser.add_argument("--interval", type=float, default=10, help="请求间隔 (ms)")
+    parser.add_argument("--rate", type=float, default=200, help="后台传输速率 (KB/s，应低于链路容量)")
+    parser.add_argument("--bulk", type=float, default=4, help="大块回显大小 (MB)")
+    args = parser.parse_args()
+
+    delay = args.delay / 1000
+    interval = args.interval / 1000
+    rate = args.rate * 1000
+    print(f"单向时延 {args.delay:.0f} ms，{args.workers} 个并发请求方 × {args.requests} 个请求，"
+          f"后台传输 {args.rate:.0f} KB/s，大块回显 {args.bulk:.0f} MB")
+    print(f"{'丢包':>6}{'streams p50/p99':>20}{'single p50/p99':>20}{'大块回显':>12}{'重传包':>8}")
+    for loss in (float(x) for x in args.loss.split(",") if x.strip()):
+        client, close = _session(loss, delay)
+        try:
+            lat_s = latency_streams(client, args.workers, args.requests, interval, rate)
+            lat_1 = latency_single(client, args.workers, args.requests, interval, rate)
+            retx0 = client.retransmits
+            mbps = bulk(client, int(args.bulk * 1e6))
+            retx = client.retransmits - retx0
+        finally:
+            close()
+        print(f"{loss * 100:>5.0f}%{statistics.median(lat_s):>10.1f} / {_pct(lat_s, 0.99):<6.1f}ms"
+              f"{statistics.median(lat_1):>10.1f} / {_pct(lat_1, 0.99):<6.1f}ms"
+              f"{mbps:>8.2f} MB/s{retx:>8}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,179 @@
+"""
+中继引擎对比：thread (每连接一个线程) vs asyncio (单事件循环)
+
+本地替身代替 SSH 会话，关闭 splice 快速路径，两种引擎都在用户态搬运数据。报告:
+  - 吞吐:   N 条并发流经 SOCKS5 上传到吸收端的总吞吐与进程 CPU 占用
+  - 建连率: 每秒完成的 "建连 → 一次请求/回显 → 关闭" 次数
+  - 容量:   同时保持 N 条空闲连接时新增的线程数与每连接内存 (RSS)
+替身回显目标本身运行在独立的事件循环中，不为每条连接开线程，不计入容量统计之外的开销。
+
+用法:
+  python benchmarks/bench_engine.py
+  python benchmarks/bench_engine.py --streams 8 --mb 64 --conns 2000 --idle 5000
+"""
+import argparse
+import asyncio
+import os
+import threading
+import time
+
+from _standin import LocalTransport, free_port, sink_handler, socks5_connect, start_server
+
+from ssh_tunnel_vpn import fastpath
+from ssh_tunnel_vpn.ssh_tunnel import AsyncSocks5Server, Socks5Server
+
+ENGINES = {"thread": Socks5Server, "asyncio": AsyncSocks5Server}
+
+
+def start_async_echo() -> int:
+    """事件循环实现的回显目标 (大量空闲连接时不占线程)"""
+    ready = threading.Event()
+    port = []
+
+    async def handle(reader, writer):
+        try:
+            while True:
+                data = await reader.read(65536)
+                if not data:
+                    break
+                writer.write(data)
+                await writer.drain()
+        except OSError:
+            pass
+        finally:
+            writer.close()
+
+    async def main():
+        server = await asyncio.start_server(handle, "127.0.0.1", 0, backlog=4096)
+        port.append(server.sockets[0].getsockname()[1])
+        ready.set()
+        await server.serve_forever()
+
+    threading.Thread(target=lambda: asyncio.run(main()), daemon=True).start()
+    ready.wait()
+    return port[0]
+
+
+def _rss() -> int:
+    try:
+        with open("/proc/self/statm") as f:
+            return int(f.read().split()[1]) * os.sysconf("SC_PAGE_SIZE")
+    except (OSError, ValueError):
+        return 0
+
+
+def _upload(port: int, total: int):
+    sock = socks5_connect(port)
+    block = b"\0" * (256 * 1024)
+    sent = 0
+    while sent < total:
+        sock.sendall(block)
+        sent += len(block)
+    sock.shutdown(1)
+    sock.recv(1)
+    sock.close()
+
+
+def bench_throughput(engine: str, sink_port: int, streams: int, mb: int) -> tuple:
+    server = ENGINES[engine](LocalTransport(sink_port), free_port())
+    server.start()
+    try:
+        threads = [threading.Thread(target=_upload, args=(server.bind_port, mb << 20)) for _ in range(streams)]
+        cpu0 = time.process_time()
+        t0 = time.perf_counter()
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        dt = time.perf_counter() - t0
+        cores = (time.process_time() - cpu0) / dt
+    finally:
+        server.stop()
+    return streams * mb / dt, cores
+
+
+def _rr_worker(port: int, count: int, errors: list):
+    for _ in range(count):
+        try:
+            sock = socks5_connect(port)
+            sock.sendall(b"x" * 100)
+            got = 0
+            while got < 100:
+                data = sock.recv(100 - got)
+                if not data:
+                    raise OSError("连接提前关闭")
+                got += len(data)
+            sock.close()
+        except OSError:
+            errors.append(1)
+
+
+def bench_connect_rate(engine: str, echo_port: int, conns: int, workers: int = 16) -> tuple:
+    server = ENGINES[engine](LocalTransport(echo_port), free_port())
+    server.start()
+    errors = []
+    try:
+        per = max(1, conns // workers)
+        threads = [threading.Thread(target=_rr_worker, args=(server.bind_port, per, errors)) for _ in range(workers)]
+        t0 = time.perf_counter()
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        dt = time.perf_counter() - t0
+    finally:
+        server.stop()
+    return per * workers / dt, len(errors)
+
+
+def bench_capacity(engine: str, echo_port: int, idle: int) -> tuple:
+    server = ENGINES[engine](LocalTransport(echo_port), free_port())
+    server.start()
+    socks = []
+    try:
+        time.sleep(0.2)
+        threads0, rss0 = threading.active_count(), _rss()
+        for _ in range(idle):
+            try:
+                sock = socks5_connect(server.bind_port)
+                sock.sendall(b"x")
+                sock.recv(1)
+            except OSError:
+                break
+            socks.append(sock)
+        time.sleep(0.5)
+        held = len(socks)
+        extra_threads = threading.active_count() - threads0
+        per_conn = (_rss() - rss0) / max(held, 1)
+    finally:
+        for sock in socks:
+            sock.close()
+        server.stop()
+    return held, extra_threads, per_conn
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--engine", default="thread,asyncio", help="参与对比的引擎 (逗号分隔)")
+    parser.add_argument("--streams", type=int, default=4, help="吞吐测试的并发流数")
+    parser.add_argument("--mb", type=int, default=64, help="每条流上传量 (MB)")
+    parser.add_argument("--conns", type=int, default=2000, help="建连率测试的连接数")
+    parser.add_argument("--idle", type=int, default=2000, help="容量测试同时保持的连接数")
+    args = parser.parse_args()
+
+    fastpath.AVAILABLE = False
+    sink_port = start_server(sink_handler)
+    echo_port = start_async_echo()
+    engines = [e.strip() for e in args.engine.split(",") if e.strip()]
+
+    print(f"{'引擎':<10}{'吞吐':>14}{'CPU':>9}{'建连率':>14}{'失败':>6}{'保持':>8}{'新增线程':>10}{'每连接内存':>12}")
+    for engine in engines:
+        mbps, cores = bench_throughput(engine, sink_port, args.streams, args.mb)
+        rate, failed = bench_connect_rate(engine, echo_port, args.conns)
+        held, threads, per_conn = bench_capacity(engine, echo_port, args.idle)
+        print(f"{engine:<10}{mbps:>10.1f} MB/s{cores:>7.2f} 核{rate:>10.0f} 次/秒{failed:>6}"
+              f"{held:>8}{threads:>12}{per_conn / 1024:>10.1f} KB")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,110 @@
+"""
+本地 socket→socket 中继：内核态 splice vs 用户态 recv/sendall
+
+链路: 客户端 → HttpProxyServer (CONNECT) → Socks5Server → 本地替身目标，
+两跳都是本地套接字，分别在开启 / 关闭 fastpath 时测:
+  - rtt:        单连接 64 字节 ping-pong 往返，报告 p50 / p99
+  - throughput: 单连接上传 --mb MB 到吸收端，报告 MB/s 与每 MB 消耗的进程 CPU 时间
+
+用法:
+  python benchmarks/bench_fastpath.py
+  python benchmarks/bench_fastpath.py --mb 1024 --pings 5000
+"""
+import argparse
+import socket
+import statistics
+import time
+
+from _standin import LocalTransport, echo_handler, free_port, sink_handler, start_server
+
+from ssh_tunnel_vpn import fastpath
+from ssh_tunnel_vpn.http_proxy import HttpProxyServer
+from ssh_tunnel_vpn.ssh_tunnel import Socks5Server
+
+
+def http_connect(port: int) -> socket.socket:
+    sock = socket.create_connection(("127.0.0.1", port))
+    sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    sock.sendall(b"CONNECT bench.test:80 HTTP/1.1\r\nHost: bench.test:80\r\n\r\n")
+    reply = b""
+    while b"\r\n\r\n" not in reply:
+        data = sock.recv(1024)
+        if not data:
+            raise OSError("代理已关闭连接")
+        reply += data
+    if b" 200 " not in reply.split(b"\r\n", 1)[0]:
+        raise OSError(f"CONNECT 失败: {reply!r}")
+    return sock
+
+
+def bench_rtt(port: int, count: int) -> list:
+    sock = http_connect(port)
+    payload = b"x" * 64
+    samples = []
+    for _ in range(count):
+        t0 = time.perf_counter()
+        sock.sendall(payload)
+        got = 0
+        while got < len(payload):
+            got += len(sock.recv(4096))
+        samples.append(time.perf_counter() - t0)
+    sock.close()
+    return samples
+
+
+def bench_throughput(port: int, total_mb: int) -> tuple:
+    sock = http_connect(port)
+    block = b"\0" * (256 * 1024)
+    total = total_mb * 1024 * 1024
+    cpu0 = time.process_time()
+    t0 = time.perf_counter()
+    sent = 0
+    while sent < total:
+        sock.sendall(block)
+        sent += len(block)
+    sock.shutdown(socket.SHUT_WR)
+    sock.recv(1)
+    dt = time.perf_counter() - t0
+    cpu = time.process_time() - cpu0
+    sock.close()
+    return total_mb / dt, cpu / total_mb
+
+
+def run(target_port: int, fn, *args):
+    socks = Socks5Server(LocalTransport(target_port), free_port())
+    http = HttpProxyServer(free_port(), socks.bind_port)
+    socks.start()
+    http.start()
+    try:
+        return fn(http.listen_port, *args)
+    finally:
+        http.stop()
+        socks.stop()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--mb", type=int, default=512, help="吞吐测试上传量 (MB)")
+    parser.add_argument("--pings", type=int, default=2000, help="往返测试次数")
+    args = parser.parse_args()
+
+    if not fastpath.AVAILABLE:
+        print("当前平台不支持 splice，两组结果均为用户态中继")
+
+    echo_port = start_server(echo_handler)
+    sink_port = start_server(sink_handler)
+    available = fastpath.AVAILABLE
+
+    print(f"{'中继':<10}{'rtt p50':>12}{'rtt p99':>12}{'吞吐':>14}{'CPU/MB':>12}")
+    for name, enabled in (("kernel", available), ("user", False)):
+        fastpath.AVAILABLE = enabled
+        rtt = sorted(run(echo_port, bench_rtt, args.pings))
+        mbps, cpu_per_mb = run(sink_port, bench_throughput, args.mb)
+        p99 = rtt[int(len(rtt) * 0.99)]
+        print(f"{name:<12}{statistics.median(rtt) * 1e6:>9.1f} us{p99 * 1e6:>9.1f} us"
+              f"{mbps:>10.1f} MB/s{cpu_per_mb * 1e3:>9.2f} ms")
+    fastpath.AVAILABLE = available
+
+
+if __name__ == "__main__":
+    main()
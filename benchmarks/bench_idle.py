@@ -0,0 +1,228 @@
+"""
+空闲长连接: 大量挂起的 WebSocket / SSE 式连接的唤醒次数与内存
+
+子进程运行替身回显目标并经 SOCKS5 打开 N 条连接 (各回显一次后保持空闲)，
+本进程只运行被测的 SOCKS5 服务器，因此线程数 / 内存 / 唤醒次数只反映中继本身。报告:
+  - 每连接内存 (RSS 增量) 与新增线程数
+  - 空闲期间进程的唤醒次数 (全部线程的上下文切换数) 与 CPU 占用
+  - 随机唤醒一部分连接时的回显延迟 (缓冲区重新借用) 及之后的内存
+
+每条连接在两个进程中各占 2 个文件描述符；脚本会把 RLIMIT_NOFILE 提到硬上限，
+5 万条连接需要硬上限不低于约 10 万 (ulimit -Hn)。线程引擎用 select，描述符超过 FD_SETSIZE
+(通常 1024) 后的连接无法中继，会计入失败。
+
+用法:
+  python benchmarks/bench_idle.py --streams 50000 --engine asyncio
+  python benchmarks/bench_idle.py --streams 400 --engine thread,asyncio --idle 10
+"""
+import argparse
+import asyncio
+import multiprocessing
+import os
+import random
+import statistics
+import struct
+import threading
+import time
+from pathlib import Path
+
+from _standin import LocalTransport, free_port
+
+from ssh_tunnel_vpn.ssh_tunnel import AsyncSocks5Server, Socks5Server
+
+ENGINES = {"thread": Socks5Server, "asyncio": AsyncSocks5Server}
+
+
+def raise_nofile() -> int:
+    try:
+        import resource
+    except ImportError:
+        return 0
+    soft, hard = resource.getrlimit(resource.RLIMIT_NOFILE)
+    if hard != resource.RLIM_INFINITY and soft < hard:
+        try:
+            resource.setrlimit(resource.RLIMIT_NOFILE, (hard, hard))
+            soft = hard
+        except (ValueError, OSError):
+            pass
+    return soft
+
+
+# ---- 子进程: 回显目标 + 空闲客户端 ----
+
+async def _echo(reader, writer):
+    try:
+        while True:
+            data = await reader.read(4096)
+            if not data:
+                break
+            writer.write(data)
+            await writer.drain()
+    except OSError:
+        pass
+    finally:
+        writer.close()
+
+
+async def _open_stream(port: int):
+    reader, writer = await asyncio.open_connection("127.0.0.1", port)
+    writer.write(b"\x05\x01\x00")
+    await writer.drain()
+    if await reader.readexactly(2) != b"\x05\x00":
+        raise OSError("SOCKS5 握手失败")
+    writer.write(b"\x05\x01\x00\x03\x0aidle.bench" + struct.pack("!H", 443))
+    await writer.drain()
+    reply = await reader.readexactly(10)
+    if reply[1] != 0x00:
+        raise OSError("SOCKS5 CONNECT 失败")
+    writer.write(b"h")
+    await writer.drain()
+    await reader.readexactly(1)
+    return reader, writer
+
+
+async def _poke(stream) -> float:
+    reader, writer = stream
+    t0 = time.perf_counter()
+    writer.write(b"p" * 512)
+    await writer.drain()
+    await reader.readexactly(512)
+    return (time.perf_counter() - t0) * 1000
+
+
+async def _client_main(pipe):
+    loop = asyncio.get_running_loop()
+    server = await asyncio.start_server(_echo, "127.0.0.1", 0, backlog=4096)
+    pipe.send(server.sockets[0].getsockname()[1])
+    streams = []
+    while True:
+        cmd, arg = await loop.run_in_executor(None, pipe.recv)
+        if cmd == "open":
+            port, n = arg
+            sem = asyncio.Semaphore(256)
+            failed = 0
+
+            async def one():
+                nonlocal failed
+                async with sem:
+                    try:
+                        streams.append(await asyncio.wait_for(_open_stream(port), 30))
+                    except (OSError, asyncio.TimeoutError, asyncio.IncompleteReadError):
+                        failed += 1
+
+            await asyncio.gather(*(one() for _ in range(n)))
+            pipe.send((len(streams), failed))
+        elif cmd == "poke":
+            sample = random.Random(5).sample(streams, min(arg, len(streams)))
+            results = await asyncio.gather(*(asyncio.wait_for(_poke(s), 10) for s in sample), return_exceptions=True)
+            pipe.send([r for r in results if isinstance(r, float)])
+        elif cmd == "close":
+            for _, writer in streams:
+                writer.close()
+            streams.clear()
+            pipe.send(None)
+        else:
+            server.close()
+            return
+
+
+def client_process(pipe):
+    raise_nofile()
+    asyncio.run(_client_main(pipe))
+
+
+# ---- 本进程: 被测服务器 ----
+
+def _rss() -> int:
+    try:
+        with open("/proc/self/statm") as f:
+            return int(f.read().split()[1]) * os.sysconf("SC_PAGE_SIZE")
+    except (OSError, ValueError):
+        return 0
+
+
+def _ctx_switches() -> int:
+    """本进程全部线程的上下文切换总数 (Linux)"""
+    total = 0
+    for status in Path("/proc/self/task").glob("*/status"):
+        try:
+            for line in status.read_text().splitlines():
+                if "ctxt_switches:" in line:
+                    total += int(line.split()[1])
+        except (OSError, ValueError):
+            pass
+    return total
+
+
+def run(engine: str, pipe, target_port: int, streams: int, idle: float, poke: int) -> dict:
+    server = ENGINES[engine](LocalTransport(target_port), free_port())
+    server.start()
+    try:
+        time.sleep(0.3)
+        threads0, rss0 = threading.active_count(), _rss()
+        t0 = time.perf_counter()
+        pipe.send(("open", (server.bind_port, streams)))
+        held, failed = pipe.recv()
+        open_s = time.perf_counter() - t0
+        time.sleep(1.0)
+        threads = threading.active_count() - threads0
+        rss_idle = _rss() - rss0
+
+        cs0, cpu0 = _ctx_switches(), time.process_time()
+        time.sleep(idle)
+        wakeups = (_ctx_switches() - cs0) / idle
+        cpu = (time.process_time() - cpu0) / idle
+
+        pipe.send(("poke", poke))
+        lat = pipe.recv()
+        time.sleep(0.5)
+        rss_after = _rss() - rss0
+
+        pipe.send(("close", None))
+        pipe.recv()
+    finally:
+        server.stop()
+    return {
+        "held": held, "failed": failed, "open_s": open_s, "threads": threads,
+        "per_conn": rss_idle / max(held, 1), "per_conn_after": rss_after / max(held, 1),
+        "wakeups": wakeups, "cpu": cpu, "lat": lat,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--engine", default="asyncio", help="参与测试的引擎 (逗号分隔: thread,asyncio)")
+    parser.add_argument("--streams", type=int, default=50000, help="空闲连接数")
+    parser.add_argument("--idle", type=float, default=5.0, help="空闲观测时长 (秒)")
+    parser.add_argument("--poke", type=int, default=500, help="空闲后随机唤醒的连接数")
+    args = parser.parse_args()
+
+    limit = raise_nofile()
+    if limit and limit < 2 * args.streams + 256:
+        fit = max((limit - 256) // 2, 1)
+        print(f"描述符上限 {limit}，连接数由 {args.streams} 降为 {fit} (需要 ulimit -Hn ≥ {2 * args.streams + 256})")
+        args.streams = fit
+
+    ctx = multiprocessing.get_context("spawn")
+    parent, child = ctx.Pipe()
+    proc = ctx.Process(target=client_process, args=(child,), daemon=True)
+    proc.start()
+    target_port = parent.recv()
+
+    print(f"{'引擎':<10}{'保持':>8}{'失败':>6}{'建连':>8}{'新增线程':>10}{'每连接内存':>12}"
+          f"{'唤醒/秒':>10}{'CPU':>8}{'唤醒后延迟 p50/p99':>22}{'之后内存':>10}")
+    try:
+        for engine in (e.strip() for e in args.engine.split(",") if e.strip()):
+            r = run(engine, parent, target_port, args.streams, args.idle, args.poke)
+            lat = sorted(r["lat"]) or [float("nan")]
+            p99 = lat[min(len(lat) - 1, int(len(lat) * 0.99))]
+            print(f"{engine:<10}{r['held']:>8}{r['failed']:>6}{r['open_s']:>7.1f}s{r['threads']:>12}"
+                  f"{r['per_conn']:>12.0f} B{r['wakeups']:>10.1f}{r['cpu'] * 100:>7.1f}%"
+                  f"{statistics.median(lat):>12.2f} / {p99:.2f} ms{r['per_conn_after']:>10.0f} B")
+    finally:
+        parent.send(("exit", None))
+        proc.join(timeout=5)
+
+
+if __name__ == "__main__":
+    main()
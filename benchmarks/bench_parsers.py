@@ -0,0 +1,219 @@
+"""
+热路径解析器微基准：每次调用耗时 (ns/op) 与峰值分配 (B/op)
+
+覆盖:
+  - parse_host_port:   HttpProxyServer._parse_host_port (CONNECT 目标 host:port，含 IPv6)
+  - split_url:         HttpProxyServer._split_absolute_url (http://host/path)
+  - rewrite_line:      HttpProxyServer._rewrite_request_line (绝对 URL → 相对路径)
+  - socks5_addr:       _decode_socks5_address + 端口解包 (IPv4 / 域名 / IPv6)
+  - sniff_tls:         sniff_hostname 于 TLS ClientHello (SNI)
+  - sniff_http:        sniff_hostname 于明文 HTTP 请求头
+  - domain_suffix:     流量账本的域名归并 (ledger.domain_suffix)
+
+语料默认由常见站点域名合成 (Chromium 风格的 CONNECT 行与请求头)；--corpus 可指定真实语料，
+每行一个主机名、host:port 或 "CONNECT host:port HTTP/1.1" (如浏览器 CONNECT 记录、hosts 列表)。
+
+用法:
+  python benchmarks/bench_parsers.py
+  python benchmarks/bench_parsers.py --corpus connect_trace.txt --only parse_host_port,sniff_tls
+"""
+import argparse
+import ipaddress
+import random
+import socket
+import struct
+import time
+import tracemalloc
+
+import _standin  # noqa: F401  (把 src 加入 sys.path)
+
+from ssh_tunnel_vpn.http_proxy import HttpProxyServer
+from ssh_tunnel_vpn.ledger import domain_suffix
+from ssh_tunnel_vpn.sniff import sniff_hostname
+from ssh_tunnel_vpn.ssh_tunnel import _decode_socks5_address
+
+_SITES = [
+    "www.google.com", "fonts.gstatic.com", "www.gstatic.com", "apis.google.com", "accounts.google.com",
+    "www.youtube.com", "i.ytimg.com", "rr3---sn-ab5l6nzr.googlevideo.com", "github.com",
+    "avatars.githubusercontent.com", "api.github.com", "objects.githubusercontent.com",
+    "www.wikipedia.org", "en.wikipedia.org", "upload.wikimedia.org", "www.bbc.co.uk",
+    "static.files.bbci.co.uk", "cdn.jsdelivr.net", "cdnjs.cloudflare.com", "ajax.googleapis.com",
+    "www.amazon.com", "m.media-amazon.com", "images-na.ssl-images-amazon.com", "www.reddit.com",
+    "styles.redditmedia.com", "i.redd.it", "pbs.twimg.com", "abs.twimg.com", "x.com",
+    "www.baidu.com", "s.yimg.jp", "www.taobao.com", "g.alicdn.com", "news.ycombinator.com",
+    "stackoverflow.com", "cdn.sstatic.net", "i.stack.imgur.com", "login.microsoftonline.com",
+    "www.bing.com", "th.bing.com", "edge.microsoft.com", "clients2.google.com",
+]
+
+
+def synthetic_hosts(n: int, seed: int = 1) -> list:
+    rnd = random.Random(seed)
+    hosts = []
+    for _ in range(n):
+        r = rnd.random()
+        if r < 0.05:
+            hosts.append(f"{rnd.randint(1, 223)}.{rnd.randint(0, 255)}.{rnd.randint(0, 255)}.{rnd.randint(1, 254)}")
+        elif r < 0.08:
+            hosts.append(f"2001:db8:{rnd.randint(0, 0xffff):x}::{rnd.randint(1, 0xffff):x}")
+        else:
+            hosts.append(rnd.choice(_SITES))
+    return hosts
+
+
+def load_corpus(path: str) -> list:
+    """读取真实语料，返回 host:port 列表"""
+    targets = []
+    with open(path, encoding="utf-8", errors="replace") as f:
+        for line in f:
+            parts = line.split()
+            if not parts or parts[0].startswith("#"):
+                continue
+            if parts[0].upper() == "CONNECT" and len(parts) > 1:
+                targets.append(parts[1])
+            elif len(parts) > 1 and _is_ip(parts[0]):
+                # hosts 文件格式: "IP 主机名 ..."
+                targets.extend(f"{h}:443" for h in parts[1:])
+            else:
+                targets.append(parts[0] if ":" in parts[0] else f"{parts[0]}:443")
+    return targets
+
+
+def _is_ip(text: str) -> bool:
+    try:
+        ipaddress.ip_address(text)
+        return True
+    except ValueError:
+        return False
+
+
+def _host_of(target: str) -> str:
+    host, _ = HttpProxyServer._parse_host_port(target, 443)
+    return host
+
+
+def _fmt_target(host: str, port: int) -> str:
+    return f"[{host}]:{port}" if ":" in host else f"{host}:{port}"
+
+
+def client_hello(host: str) -> bytes:
+    """带 SNI 与常见扩展的 TLS 1.3 风格 ClientHello 记录"""
+    name = host.encode()
+    sni = struct.pack("!HBH", len(name) + 3, 0, len(name)) + name
+    exts = struct.pack("!HH", 0, len(sni)) + sni
+    exts += struct.pack("!HH", 0x000a, 8) + struct.pack("!H", 6) + b"\x00\x1d\x00\x17\x00\x18"
+    exts += struct.pack("!HH", 0x0010, 14) + struct.pack("!H", 12) + b"\x02h2\x08http/1.1"
+    exts += struct.pack("!HH", 0x002b, 3) + b"\x02\x03\x04"
+    exts += struct.pack("!HH", 0x0033, 38) + struct.pack("!HHH", 36, 0x001d, 32) + bytes(32)
+    ciphers = b"\x13\x01\x13\x02\x13\x03\xc0\x2b\xc0\x2f\xc0\x2c\xc0\x30"
+    body = (b"\x03\x03" + bytes(32) + b"\x20" + bytes(32) + struct.pack("!H", len(ciphers)) + ciphers
+            + b"\x01\x00" + struct.pack("!H", len(exts)) + exts)
+    hs = b"\x01" + struct.pack("!I", len(body))[1:] + body
+    return b"\x16\x03\x01" + struct.pack("!H", len(hs)) + hs
+
+
+def http_head(host: str, path: str) -> bytes:
+    return (f"GET http://{host}{path} HTTP/1.1\r\nHost: {host}\r\nProxy-Connection: keep-alive\r\n"
+            f"User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) "
+            f"Chrome/124.0.0.0 Safari/537.36\r\nAccept: */*\r\nAccept-Encoding: gzip, deflate\r\n\r\n").encode()
+
+
+def build_cases(targets: list) -> dict:
+    rnd = random.Random(2)
+    hosts = [_host_of(t) for t in targets]
+    paths = ["/", "/index.html", "/search?q=ssh+tunnel&hl=en", "/static/js/app.3f9c1d.js",
+             "/api/v1/items?page=2&limit=50", "/favicon.ico"]
+
+    addrs = []
+    for h in hosts:
+        if ":" in h:
+            addrs.append((0x04, socket.inet_pton(socket.AF_INET6, h) + struct.pack("!H", 443)))
+        elif _is_ip(h):
+            addrs.append((0x01, socket.inet_aton(h) + struct.pack("!H", 443)))
+        else:
+            addrs.append((0x03, h.encode() + struct.pack("!H", 443)))
+
+    heads = [http_head(h if ":" not in h else f"[{h}]", rnd.choice(paths)) for h in hosts]
+    urls = [head.split(b" ", 2)[1].decode() for head in heads]
+    names = [h for h in hosts if not _is_ip(h)] or ["example.com"]
+
+    def socks5(item):
+        atyp, raw = item
+        return _decode_socks5_address(atyp, raw[:-2]), struct.unpack("!H", raw[-2:])[0]
+
+    def rewrite(item):
+        head, path = item
+        return HttpProxyServer._rewrite_request_line(head, path)
+
+    return {
+        "parse_host_port": (lambda t: HttpProxyServer._parse_host_port(t, 443),
+                            [_fmt_target(h, 443) if ":" in h else t for h, t in zip(hosts, targets)]),
+        "split_url": (HttpProxyServer._split_absolute_url, urls),
+        "rewrite_line": (rewrite, [(head, HttpProxyServer._split_absolute_url(u)[1]) for head, u in zip(heads, urls)]),
+        "socks5_addr": (socks5, addrs),
+        "sniff_tls": (sniff_hostname, [client_hello(h) for h in names]),
+        "sniff_http": (sniff_hostname, heads),
+        "domain_suffix": (domain_suffix, hosts),
+    }
+
+
+def bench_time(fn, items: list, min_time: float) -> float:
+    """多轮遍历语料取最快一轮，返回 ns/op"""
+    best = float("inf")
+    rounds = 0
+    start = time.perf_counter()
+    while rounds < 3 or time.perf_counter() - start < min_time:
+        t0 = time.perf_counter_ns()
+        for item in items:
+            fn(item)
+        best = min(best, (time.perf_counter_ns() - t0) / len(items))
+        rounds += 1
+    return best
+
+
+def bench_alloc(fn, items: list, samples: int = 500) -> float:
+    """tracemalloc 统计单次调用的峰值分配，返回平均 B/op"""
+    items = items[:samples]
+    fn(items[0])
+    total = 0
+    tracemalloc.start()
+    try:
+        for item in items:
+            tracemalloc.reset_peak()
+            base = tracemalloc.get_traced_memory()[0]
+            fn(item)
+            total += tracemalloc.get_traced_memory()[1] - base
+    finally:
+        tracemalloc.stop()
+    return total / len(items)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--corpus", help="真实语料文件 (每行主机名 / host:port / CONNECT 行 / hosts 格式)")
+    parser.add_argument("--size", type=int, default=2000, help="合成语料条数")
+    parser.add_argument("--min-time", type=float, default=0.5, help="每项最少测量时长 (秒)")
+    parser.add_argument("--only", default="", help="只跑指定项，逗号分隔")
+    args = parser.parse_args()
+
+    if args.corpus:
+        targets = load_corpus(args.corpus)
+        if not targets:
+            print(f"语料为空: {args.corpus}")
+            return
+    else:
+        targets = [_fmt_target(h, 443) for h in synthetic_hosts(args.size)]
+    cases = build_cases(targets)
+    only = {n.strip() for n in args.only.split(",") if n.strip()}
+
+    print(f"语料: {args.corpus or '合成'} ({len(targets)} 条)")
+    print(f"{'项目':<18}{'ns/op':>12}{'B/op':>10}")
+    for name, (fn, items) in cases.items():
+        if only and name not in only:
+            continue
+        ns = bench_time(fn, items, args.min_time)
+        alloc = bench_alloc(fn, items)
+        print(f"{name:<20}{ns:>10.0f}{alloc:>10.0f}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,147 @@
+"""
+远端建连耗时对比：sshd 直连模型 vs 远端伴随进程 (remote_agent.py)
+
+本地替身：在本进程内运行 remote_agent 的服务循环，并用替身解析器模拟远端网络环境，
+两种模型使用同一个解析器、同一组目标地址：
+  - sshd 模型: 每次连接都 getaddrinfo，再按顺序逐个地址阻塞 connect
+  - 伴随进程: 经已建立的 (预热) 连接发送 CONNECT，计时到收到 OK (DNS 缓存 + Happy Eyeballs)
+
+场景:
+  local   解析无延迟，目标可达
+  dns     每次解析耗时 --dns-ms 毫秒 (模拟远端递归 DNS)
+  stall   解析结果首个地址不可达 (SYN 无响应，模拟坏掉的 IPv6)，第二个地址可达
+
+用法:
+  python benchmarks/bench_remote_connect.py
+  python benchmarks/bench_remote_connect.py -n 500 --dns-ms 30 --stall-timeout 3
+"""
+import argparse
+import importlib.util
+import os
+import socket
+import statistics
+import threading
+import time
+from pathlib import Path
+
+AGENT = Path(__file__).resolve().parent.parent / "src" / "ssh_tunnel_vpn" / "remote_agent.py"
+
+_real_getaddrinfo = socket.getaddrinfo
+
+
+def _load_agent():
+    spec = importlib.util.spec_from_file_location("remote_agent", AGENT)
+    module = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(module)
+    return module
+
+
+def _listener(backlog: int = 1024, accept: bool = True, addr: tuple = ("127.0.0.1", 0)) -> tuple:
+    server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server.bind(addr)
+    server.listen(backlog)
+    if accept:
+        def loop():
+            while True:
+                conn, _ = server.accept()
+                conn.close()
+        threading.Thread(target=loop, daemon=True).start()
+    return server, server.getsockname()
+
+
+def _blackhole(port: int) -> tuple:
+    """不 accept 且积压队列已满的监听端口: 后续 SYN 被丢弃，connect 一直挂起
+
+    与可达目标同端口、不同回环地址，模拟同一域名下一个坏掉的地址。
+    """
+    server, addr = _listener(backlog=0, accept=False, addr=("127.0.0.2", port))
+    filler = socket.create_connection(addr)
+    return (server, filler), addr
+
+
+class StandInResolver:
+    def __init__(self, addrs: list, delay: float):
+        self.addrs = addrs
+        self.delay = delay
+
+    def __call__(self, host, port, family=0, type=0, proto=0, flags=0):
+        if host != "target.test":
+            return _real_getaddrinfo(host, port, family, type, proto, flags)
+        if self.delay:
+            time.sleep(self.delay)
+        return [(socket.AF_INET, socket.SOCK_STREAM, socket.IPPROTO_TCP, "", (ip, port)) for ip, _ in self.addrs]
+
+
+def sshd_model(port: int, timeout: float) -> float:
+    t0 = time.perf_counter()
+    last = None
+    for family, type_, proto, _, addr in socket.getaddrinfo("target.test", port, 0, socket.SOCK_STREAM):
+        sock = socket.socket(family, type_, proto)
+        sock.settimeout(timeout)
+        try:
+            sock.connect(addr)
+            break
+        except OSError as e:
+            last = e
+            sock.close()
+    else:
+        raise last or OSError("connect failed")
+    dt = time.perf_counter() - t0
+    sock.close()
+    return dt
+
+
+def agent_model(agent_port: int, token: str, port: int) -> float:
+    conn = socket.create_connection(("127.0.0.1", agent_port))
+    t0 = time.perf_counter()
+    conn.sendall(f"CONNECT {token} target.test {port}\n".encode())
+    reply = conn.recv(64)
+    dt = time.perf_counter() - t0
+    conn.close()
+    if reply.strip() != b"OK":
+        raise OSError(reply.decode(errors="replace").strip())
+    return dt
+
+
+def _report(name: str, samples: list):
+    samples = sorted(samples)
+    p99 = samples[min(len(samples) - 1, int(len(samples) * 0.99))]
+    print(f"    {name:<7} mean {statistics.mean(samples) * 1e3:9.3f} ms   "
+          f"p50 {statistics.median(samples) * 1e3:9.3f} ms   p99 {p99 * 1e3:9.3f} ms")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-n", "--count", type=int, default=200, help="local/dns 场景每种模型的连接次数")
+    parser.add_argument("--dns-ms", type=float, default=20.0, help="dns 场景的解析耗时 (毫秒)")
+    parser.add_argument("--stall-timeout", type=float, default=3.0,
+                        help="stall 场景 sshd 模型的单地址连接超时 (秒，真实系统通常远大于此)")
+    parser.add_argument("--stall-count", type=int, default=5, help="stall 场景的连接次数")
+    args = parser.parse_args()
+
+    agent = _load_agent()
+    _, good = _listener()
+    _keep, dead = _blackhole(good[1])
+    resolver = StandInResolver([good], 0.0)
+    socket.getaddrinfo = resolver
+
+    scenarios = [
+        ("local", [good], 0.0, args.count),
+        ("dns", [good], args.dns_ms / 1000.0, args.count),
+        ("stall", [dead, good], 0.0, args.stall_count),
+    ]
+    for name, addrs, delay, count in scenarios:
+        resolver.addrs, resolver.delay = addrs, delay
+        cache = agent.DnsCache()
+        server, (_, agent_port) = _listener(accept=False)
+        token = os.urandom(16).hex()
+        threading.Thread(target=agent.serve, args=(server, cache, token), daemon=True).start()
+        sshd = [sshd_model(good[1], args.stall_timeout) for _ in range(count)]
+        helper = [agent_model(agent_port, token, good[1]) for _ in range(count)]
+        print(f"  [{name}] {count} 次 (伴随进程 DNS 缓存命中 {cache.hits}/{cache.hits + cache.misses})")
+        _report("sshd", sshd)
+        _report("helper", helper)
+
+
+if __name__ == "__main__":
+    main()
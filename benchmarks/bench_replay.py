@@ -0,0 +1,227 @@
+"""
+按采集的轨迹回放真实负载 (main.py cli --trace 采集)
+
+每条连接按轨迹中的打开时刻经 SOCKS5 建连，上行事件由客户端按原时间点发送，
+下行事件由本地替身目标按原时间点回送；SSH 会话由本地替身代替。报告:
+  - open:  SOCKS5 握手到建连成功的耗时
+  - lag:   连接实际完成时间相对轨迹中最后一个事件的滞后 (中继跟不上负载时变大)
+  - 回放总耗时与轨迹时长之比
+
+用法:
+  python benchmarks/bench_replay.py trace.jsonl
+  python benchmarks/bench_replay.py trace.jsonl --speed 2 --limit 500
+  python benchmarks/bench_replay.py trace.jsonl --engine python,asyncio   # 对比中继引擎
+  python benchmarks/bench_replay.py --synth 300 -o synth.jsonl     # 生成合成轨迹 (大量短连接 + 少量长流)
+"""
+import argparse
+import json
+import random
+import socket
+import statistics
+import struct
+import threading
+import time
+
+from _standin import LocalTransport, free_port, socks5_connect, start_server
+
+from ssh_tunnel_vpn.ssh_tunnel import AsyncSocks5Server, Socks5Server
+from ssh_tunnel_vpn.trace import TRACE_VERSION, load_trace
+
+# 每条回放连接先发送的索引头 (不计入统计)
+_HEADER = struct.Struct("!4sI")
+_MAGIC = b"RPLY"
+
+
+def make_server(engine: str, transport, port: int):
+    if engine == "python":
+        return Socks5Server(transport, port)
+    if engine == "asyncio":
+        return AsyncSocks5Server(transport, port)
+    raise SystemExit(f"未知的引擎: {engine}")
+
+
+def _play(sock: socket.socket, events: list, direction: str, t0: float, speed: float):
+    """按事件时间点发送该方向的数据"""
+    for ms, d, n in events:
+        if d != direction:
+            continue
+        delay = t0 + ms / 1000 / speed - time.monotonic()
+        if delay > 0:
+            time.sleep(delay)
+        sock.sendall(b"\0" * n)
+
+
+def _drain(sock: socket.socket, expect: int) -> int:
+    got = 0
+    while got < expect:
+        data = sock.recv(min(expect - got, 1 << 20))
+        if not data:
+            break
+        got += len(data)
+    return got
+
+
+def target_handler(conns: list, speed: float):
+    """替身目标：读取索引头后按轨迹回送下行数据，同时吸收上行数据"""
+    def handler(conn: socket.socket):
+        try:
+            header = b""
+            while len(header) < _HEADER.size:
+                chunk = conn.recv(_HEADER.size - len(header))
+                if not chunk:
+                    return
+                header += chunk
+            magic, idx = _HEADER.unpack(header)
+            if magic != _MAGIC or idx >= len(conns):
+                return
+            c = conns[idx]
+            t0 = time.monotonic()
+            reader = threading.Thread(target=_drain, args=(conn, c["up"]), daemon=True)
+            reader.start()
+            _play(conn, c["ev"], "d", t0, speed)
+            reader.join()
+            conn.shutdown(socket.SHUT_WR)
+        except OSError:
+            pass
+        finally:
+            conn.close()
+    return handler
+
+
+def replay_one(port: int, idx: int, c: dict, speed: float, results: list):
+    t_start = time.monotonic()
+    try:
+        sock = socks5_connect(port)
+    except OSError:
+        results.append(None)
+        return
+    t_open = time.monotonic()
+    try:
+        sock.sendall(_HEADER.pack(_MAGIC, idx))
+        reader = threading.Thread(target=_drain, args=(sock, c["down"]), daemon=True)
+        reader.start()
+        _play(sock, c["ev"], "u", t_open, speed)
+        reader.join()
+        sock.shutdown(socket.SHUT_WR)
+        sock.recv(1)
+    except OSError:
+        pass
+    finally:
+        sock.close()
+    done = time.monotonic()
+    last_ms = max((e[0] for e in c["ev"]), default=0.0)
+    results.append(((t_open - t_start) * 1000, (done - t_open) * 1000 - last_ms / speed))
+
+
+def replay(conns: list, engine: str, speed: float) -> tuple:
+    target_port = start_server(target_handler(conns, speed))
+    server = make_server(engine, LocalTransport(target_port), free_port())
+    server.start()
+    results = []
+    threads = []
+    t0 = time.monotonic()
+    try:
+        for idx, c in enumerate(conns):
+            delay = t0 + c["t"] / speed - time.monotonic()
+            if delay > 0:
+                time.sleep(delay)
+            t = threading.Thread(target=replay_one, args=(server.bind_port, idx, c, speed, results), daemon=True)
+            t.start()
+            threads.append(t)
+        for t in threads:
+            t.join()
+    finally:
+        server.stop()
+    return results, time.monotonic() - t0
+
+
+def synthesize(n: int, seed: int = 7) -> list:
+    """合成浏览负载：突发的短连接 (小上行 + 数十 KB 下行) 加约 2% 的长流"""
+    rnd = random.Random(seed)
+    conns = []
+    t = 0.0
+    for i in range(n):
+        # 页面加载时成批打开连接，批次之间有停顿
+        t += rnd.expovariate(200) if rnd.random() < 0.9 else rnd.uniform(0.5, 2.0)
+        events = []
+        if rnd.random() < 0.02:
+            dur = rnd.uniform(5, 15)
+            ms = 0.0
+            while ms < dur * 1000:
+                events.append([round(ms, 3), "d", rnd.choice((16384, 32768, 65536))])
+                ms += rnd.uniform(5, 30)
+        else:
+            ms = rnd.uniform(0, 5)
+            for _ in range(rnd.randint(1, 4)):
+                events.append([round(ms, 3), "u", rnd.randint(300, 2000)])
+                ms += rnd.uniform(20, 120)
+                for _ in range(rnd.randint(1, 8)):
+                    events.append([round(ms, 3), "d", rnd.randint(1000, 16384)])
+                    ms += rnd.uniform(0.5, 5)
+            dur = ms / 1000 + 0.01
+        conns.append({
+            "t": round(t, 6), "dst": f"{rnd.getrandbits(48):012x}", "port": 443, "open_ms": 0,
+            "dur": round(dur, 6),
+            "up": sum(e[2] for e in events if e[1] == "u"),
+            "down": sum(e[2] for e in events if e[1] == "d"),
+            "ev": events,
+        })
+    return conns
+
+
+def _pct(values: list, q: float) -> float:
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * q))]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("trace", nargs="?", help="轨迹文件 (JSONL)")
+    parser.add_argument("--engine", default="python", help="中继引擎 (逗号分隔可对比多个)")
+    parser.add_argument("--speed", type=float, default=1.0, help="回放倍速")
+    parser.add_argument("--limit", type=int, default=0, help="只回放前 N 条连接")
+    parser.add_argument("--synth", type=int, default=0, metavar="N", help="生成 N 条连接的合成轨迹")
+    parser.add_argument("-o", "--output", help="合成轨迹的保存路径 (不指定则直接回放)")
+    args = parser.parse_args()
+
+    if args.synth:
+        conns = synthesize(args.synth)
+        if args.output:
+            with open(args.output, "w", encoding="utf-8") as f:
+                f.write(json.dumps({"version": TRACE_VERSION, "started": "synthetic"}) + "\n")
+                for c in conns:
+                    f.write(json.dumps(c, separators=(",", ":")) + "\n")
+            print(f"已生成 {len(conns)} 条连接: {args.output}")
+            return
+    elif args.trace:
+        _, conns = load_trace(args.trace)
+    else:
+        parser.error("需要轨迹文件或 --synth")
+    if args.limit:
+        conns = conns[:args.limit]
+    if not conns:
+        print("轨迹为空")
+        return
+
+    span = max(c["t"] + c["dur"] for c in conns) - conns[0]["t"]
+    base = conns[0]["t"]
+    conns = [dict(c, t=c["t"] - base) for c in conns]
+    total = sum(c["up"] + c["down"] for c in conns)
+    print(f"轨迹: {len(conns)} 条连接，{total / 1e6:.1f} MB，时长 {span:.1f} 秒，倍速 {args.speed}")
+
+    print(f"{'引擎':<10}{'open p50':>10}{'open p99':>10}{'lag p50':>10}{'lag p99':>10}{'失败':>6}{'耗时比':>8}")
+    for engine in args.engine.split(","):
+        results, wall = replay(conns, engine.strip(), args.speed)
+        ok = [r for r in results if r]
+        if not ok:
+            print(f"{engine:<12}全部失败")
+            continue
+        opens = [r[0] for r in ok]
+        lags = [r[1] for r in ok]
+        print(f"{engine:<12}{statistics.median(opens):>8.2f}ms{_pct(opens, 0.99):>8.2f}ms"
+              f"{statistics.median(lags):>8.1f}ms{_pct(lags, 0.99):>8.1f}ms"
+              f"{len(results) - len(ok):>6}{wall / (span / args.speed):>8.2f}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,84 @@
+"""
+并发流扩展性：不绑核 vs 按放置规格绑核
+
+本地替身代替 SSH 会话，1 / 2 / 4 / 8 条并发流同时经 Socks5Server 上传到吸收端，
+报告总吞吐、进程 CPU 占用 (核数) 与每核吞吐。关闭 splice 快速路径，
+使中继与真实 SSH 通道一样在用户态搬运数据。
+
+用法:
+  python benchmarks/bench_scaling.py                     # 绑核规格默认 auto，失败时用全部可用 CPU
+  python benchmarks/bench_scaling.py --placement node:0 --mb 256
+"""
+import argparse
+import os
+import threading
+import time
+
+from _standin import LocalTransport, free_port, sink_handler, socks5_connect, start_server
+
+from ssh_tunnel_vpn import fastpath
+from ssh_tunnel_vpn.placement import get_placement
+from ssh_tunnel_vpn.ssh_tunnel import Socks5Server
+
+
+def upload(port: int, total: int):
+    sock = socks5_connect(port)
+    block = b"\0" * (256 * 1024)
+    sent = 0
+    while sent < total:
+        sock.sendall(block)
+        sent += len(block)
+    sock.shutdown(1)
+    sock.recv(1)
+    sock.close()
+
+
+def run(sink_port: int, placement, streams: int, mb_per_stream: int) -> tuple:
+    server = Socks5Server(LocalTransport(sink_port), free_port(), placement=placement)
+    server.start()
+    try:
+        threads = [threading.Thread(target=upload, args=(server.bind_port, mb_per_stream << 20))
+                   for _ in range(streams)]
+        cpu0 = time.process_time()
+        t0 = time.perf_counter()
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        dt = time.perf_counter() - t0
+        cores = (time.process_time() - cpu0) / dt
+    finally:
+        server.stop()
+    mbps = streams * mb_per_stream / dt
+    return mbps, cores, mbps / max(cores, 1e-9)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--placement", default="auto", help="放置规格 (见 placement.py)")
+    parser.add_argument("--mb", type=int, default=128, help="每条流上传量 (MB)")
+    args = parser.parse_args()
+
+    try:
+        placement = get_placement(args.placement)
+    except Exception as e:
+        cpus = sorted(os.sched_getaffinity(0)) if hasattr(os, "sched_getaffinity") else []
+        if not cpus:
+            print(f"无法绑核: {e}")
+            return
+        print(f"{e}，改用全部可用 CPU")
+        placement = get_placement(",".join(str(c) for c in cpus))
+    print(f"放置: {placement.describe()}")
+
+    fastpath.AVAILABLE = False
+    sink_port = start_server(sink_handler)
+
+    print(f"{'流数':<6}{'放置':<10}{'吞吐':>14}{'CPU':>10}{'每核吞吐':>16}")
+    for streams in (1, 2, 4, 8):
+        for name, p in (("off", None), ("pinned", placement)):
+            mbps, cores, per_core = run(sink_port, p, streams, args.mb)
+            print(f"{streams:<8}{name:<10}{mbps:>10.1f} MB/s{cores:>8.2f} 核{per_core:>10.1f} MB/s")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,81 @@
+"""
+调优档位对比：经 SOCKS5 中继的往返延迟与单流吞吐
+
+本地替身 (benchmarks/_standin.py) 代替 SSH 会话，按每个档位各启动一个 Socks5Server：
+  - rtt:        单连接 64 字节 ping-pong 往返，报告 p50 / p99
+  - throughput: 单连接上传 --mb MB 到吸收端，报告 MB/s
+
+用法:
+  python benchmarks/bench_tuning.py
+  python benchmarks/bench_tuning.py --mb 512 --pings 5000
+"""
+import argparse
+import statistics
+import time
+
+from _standin import LocalTransport, echo_handler, free_port, sink_handler, socks5_connect, start_server
+
+from ssh_tunnel_vpn.ssh_tunnel import Socks5Server
+from ssh_tunnel_vpn.tuning import PROFILES, apply_client_socket
+
+
+def bench_rtt(port: int, profile, count: int) -> list:
+    sock = socks5_connect(port)
+    apply_client_socket(sock, profile)
+    payload = b"x" * 64
+    samples = []
+    for _ in range(count):
+        t0 = time.perf_counter()
+        sock.sendall(payload)
+        got = 0
+        while got < len(payload):
+            got += len(sock.recv(4096))
+        samples.append(time.perf_counter() - t0)
+    sock.close()
+    return samples
+
+
+def bench_throughput(port: int, profile, total_mb: int) -> float:
+    sock = socks5_connect(port)
+    apply_client_socket(sock, profile)
+    block = b"\0" * (256 * 1024)
+    total = total_mb * 1024 * 1024
+    t0 = time.perf_counter()
+    sent = 0
+    while sent < total:
+        sock.sendall(block)
+        sent += len(block)
+    sock.shutdown(1)
+    sock.recv(1)
+    dt = time.perf_counter() - t0
+    sock.close()
+    return total_mb / dt
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--mb", type=int, default=256, help="吞吐测试上传量 (MB)")
+    parser.add_argument("--pings", type=int, default=2000, help="往返测试次数")
+    args = parser.parse_args()
+
+    echo_port = start_server(echo_handler)
+    sink_port = start_server(sink_handler)
+
+    print(f"{'档位':<10}{'rtt p50':>12}{'rtt p99':>12}{'吞吐':>14}")
+    for name, profile in PROFILES.items():
+        rtt_server = Socks5Server(LocalTransport(echo_port), free_port(), tuning=profile)
+        bulk_server = Socks5Server(LocalTransport(sink_port), free_port(), tuning=profile)
+        rtt_server.start()
+        bulk_server.start()
+        try:
+            rtt = sorted(bench_rtt(rtt_server.bind_port, profile, args.pings))
+            mbps = bench_throughput(bulk_server.bind_port, profile, args.mb)
+        finally:
+            rtt_server.stop()
+            bulk_server.stop()
+        p99 = rtt[int(len(rtt) * 0.99)]
+        print(f"{name:<12}{statistics.median(rtt) * 1e6:>9.1f} us{p99 * 1e6:>9.1f} us{mbps:>10.1f} MB/s")
+
+
+if __name__ == "__main__":
+    main()
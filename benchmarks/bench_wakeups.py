@@ -0,0 +1,168 @@
+"""
+空闲唤醒次数: 默认 vs tickless (tickless.py)
+
+子进程运行替身 SSH 服务器 (_ssh_standin.py) 与回显目标，并经 SOCKS5 打开若干条连接
+(各回显一次后保持空闲)；本进程运行完整的 SshTunnelManager (SOCKS5 + HTTP 监听、会话监控、
+统计页、流量账本) 和一个按 CLI 方式刷新统计的消费者线程，因此唤醒次数只反映本进程。报告:
+  - 空闲期间每秒唤醒次数 (全部线程的上下文切换数，Linux) 与 CPU 占用
+  - 唤醒最多的几个线程 (paramiko 传输线程 / 监听 / 统计等)
+默认模式下 paramiko 传输线程每秒读超时 10 次 (Transport._active_check_timeout)；
+tickless 模式下它阻塞在 recv 上，保活交给内核 TCP keepalive。
+
+用法:
+  python benchmarks/bench_wakeups.py
+  python benchmarks/bench_wakeups.py --streams 50 --idle 10 --engine asyncio
+"""
+import argparse
+import multiprocessing
+import os
+import tempfile
+import threading
+import time
+from collections import Counter
+from pathlib import Path
+
+from _standin import echo_handler, free_port, socks5_connect, start_server
+
+import paramiko
+
+from ssh_tunnel_vpn.ssh_tunnel import SshTunnelManager
+
+
+# ---- 子进程: 替身 SSH 服务器 + 回显目标 + 空闲客户端 ----
+
+def server_process(pipe):
+    from _ssh_standin import start_ssh_server
+
+    pipe.send(start_ssh_server(start_server(echo_handler)))
+    streams = []
+    while True:
+        cmd, arg = pipe.recv()
+        if cmd == "open":
+            port, n = arg
+            for _ in range(n):
+                sock = socks5_connect(port, "idle.bench", 443)
+                sock.sendall(b"h")
+                sock.recv(1)
+                streams.append(sock)
+            pipe.send(len(streams))
+        elif cmd == "close":
+            for sock in streams:
+                sock.close()
+            streams.clear()
+            pipe.send(None)
+        else:
+            return
+
+
+# ---- 本进程 ----
+
+def _thread_switches() -> dict:
+    """线程 id → 上下文切换数 (Linux)"""
+    out = {}
+    for status in Path("/proc/self/task").glob("*/status"):
+        try:
+            total = 0
+            for line in status.read_text().splitlines():
+                if "ctxt_switches:" in line:
+                    total += int(line.split()[1])
+            out[int(status.parent.name)] = total
+        except (OSError, ValueError):
+            pass
+    return out
+
+
+def _thread_names() -> dict:
+    names = {}
+    for t in threading.enumerate():
+        if t.native_id is None:
+            continue
+        if isinstance(t, paramiko.Transport):
+            names[t.native_id] = "paramiko 传输"
+        elif t is threading.main_thread():
+            names[t.native_id] = "主线程"
+        else:
+            names[t.native_id] = getattr(t._target, "__qualname__", None) or t.name
+    return names
+
+
+def _consumer(mgr: SshTunnelManager, stop: threading.Event):
+    """按 CLI 的方式刷新统计: 有变化时每 5 秒一次，没变化时等活动信号"""
+    last = None
+    while not stop.is_set():
+        st = mgr.get_stats()
+        key = (st["bytes_up"], st["bytes_down"], st["active"], st["total"])
+        if key == last:
+            token = mgr.activity.arm()
+            if not stop.is_set():
+                mgr.activity.wait(token)
+            continue
+        last = key
+        stop.wait(5)
+
+
+def run(tickless: bool, engine: str, pipe, ssh_port: int, streams: int, settle: float, idle: float,
+        workdir: str) -> dict:
+    mgr = SshTunnelManager()
+    socks_port = free_port()
+    mgr.connect("127.0.0.1", ssh_port, "bench", "bench", socks_port, free_port(),
+                stats_path=os.path.join(workdir, f"stats-{tickless}"),
+                ledger_path=os.path.join(workdir, f"ledger-{tickless}"),
+                engine=engine, tickless=tickless)
+    stop = threading.Event()
+    consumer = threading.Thread(target=_consumer, args=(mgr, stop), daemon=True)
+    consumer.start()
+    try:
+        pipe.send(("open", (socks_port, streams)))
+        held = pipe.recv()
+        # 等统计页 / 消费者看到不再变化后停下 (消费者在最后一次变化后最多再刷新两次，间隔 5 秒)
+        time.sleep(settle)
+        names = _thread_names()
+        cs0, cpu0 = _thread_switches(), time.process_time()
+        time.sleep(idle)
+        cs1, cpu = _thread_switches(), (time.process_time() - cpu0) / idle
+        per = Counter()
+        for tid, n in cs1.items():
+            per[names.get(tid, "其他")] += n - cs0.get(tid, n)
+        pipe.send(("close", None))
+        pipe.recv()
+    finally:
+        stop.set()
+        mgr.activity.poke()
+        mgr.disconnect()
+    # 观测线程自己 (主线程) 的 sleep 也算两次切换
+    per["主线程"] = max(0, per["主线程"] - 2)
+    return {"held": held, "wakeups": sum(per.values()) / idle, "cpu": cpu, "per": per}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--streams", type=int, default=20, help="空闲连接数")
+    parser.add_argument("--idle", type=float, default=10.0, help="空闲观测时长 (秒)")
+    parser.add_argument("--settle", type=float, default=11.0, help="开始观测前的静置时间 (秒)")
+    parser.add_argument("--engine", choices=["thread", "asyncio"], default="thread", help="本地中继引擎")
+    parser.add_argument("--top", type=int, default=4, help="列出唤醒最多的线程数")
+    args = parser.parse_args()
+
+    ctx = multiprocessing.get_context("spawn")
+    parent, child = ctx.Pipe()
+    proc = ctx.Process(target=server_process, args=(child,), daemon=True)
+    proc.start()
+    ssh_port = parent.recv()
+
+    print(f"{args.streams} 条空闲连接，引擎 {args.engine}，观测 {args.idle:.0f} 秒")
+    print(f"{'模式':<10}{'保持':>6}{'唤醒/秒':>10}{'CPU':>8}   唤醒最多的线程 (次/秒)")
+    try:
+        with tempfile.TemporaryDirectory() as workdir:
+            for tickless in (False, True):
+                r = run(tickless, args.engine, parent, ssh_port, args.streams, args.settle, args.idle, workdir)
+                top = "  ".join(f"{name} {n / args.idle:.1f}" for name, n in r["per"].most_common(args.top) if n)
+                print(f"{'tickless' if tickless else '默认':<10}{r['held']:>6}{r['wakeups']:>10.1f}"
+                      f"{r['cpu'] * 100:>7.2f}%   {top or '-'}")
+    finally:
+        parent.send(("exit", None))
+        proc.join(timeout=5)
+
+
+if __name__ == "__main__":
+    main()
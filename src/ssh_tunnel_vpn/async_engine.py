@@ -0,0 +1,340 @@
+"""
+asyncio 中继引擎 — 无原生组件时的可移植替代
+
+默认的线程引擎每条连接一个线程，中继靠 1~2 秒超时的 select 轮询。asyncio 引擎用
+一个事件循环线程服务一个监听端口上的全部连接:
+  - 中继由读写事件回调驱动 (不为每个方向建任务)：空闲的长连接 (WebSocket / SSE / gRPC 流)
+    只占两个读事件注册和几百字节状态，没有定时器，不产生任何唤醒
+  - 套接字: 非阻塞 recv_into 读入跨连接复用的缓冲区 (只在一块数据读入到发完之间借用，
+    空闲连接不持有缓冲区)，memoryview 切片直接发送，转发路径上不为每块数据新建对象
+  - paramiko 通道: 把 Channel.fileno() (有数据或关闭时可读的事件管道) 注册到事件循环，
+    非阻塞 recv；发送窗口已满时按退避定时重试
+  - 通道建立 (open_channel 阻塞等待服务器回复) 交给有界线程池，不阻塞事件循环
+共享会话 / 替身 Transport 返回的普通套接字按套接字处理。
+内核态转发 (fastpath.splice_relay) 需要专用线程阻塞在 splice 上，asyncio 引擎下不使用。
+"""
+import asyncio
+import functools
+import logging
+import socket
+import threading
+from concurrent.futures import ThreadPoolExecutor
+from typing import Callable, List, Optional
+
+from .placement import Placement
+
+logger = logging.getLogger(__name__)
+
+ENGINES = ("thread", "asyncio")
+DEFAULT_ENGINE = "thread"
+
+# 同时进行中的通道建立数；超出的连接在事件循环里排队，不额外占线程
+OPEN_WORKERS = 32
+# 空闲缓冲区保留个数 (同一时刻正在搬运数据的方向数通常远小于连接数)
+POOL_KEEP = 64
+# 通道发送窗口已满时的退避区间 (秒)
+_SEND_BACKOFF_MIN = 0.0005
+_SEND_BACKOFF_MAX = 0.02
+
+
+def check_engine(name: Optional[str]) -> str:
+    engine = (name or DEFAULT_ENGINE).lower()
+    if engine not in ENGINES:
+        raise Exception(f"未知的中继引擎: {name} (可选 {' / '.join(ENGINES)})")
+    return engine
+
+
+class BufferPool:
+    """固定大小的 bytearray 复用池 (仅在事件循环线程内使用，无需加锁)"""
+
+    def __init__(self, size: int, keep: int = POOL_KEEP):
+        self.size = size
+        self.keep = keep
+        self._free: List[bytearray] = []
+
+    def take(self) -> bytearray:
+        return self._free.pop() if self._free else bytearray(self.size)
+
+    def give(self, buf: bytearray):
+        if len(self._free) < self.keep:
+            self._free.append(buf)
+
+
+class LoopThread:
+    """在独立线程中运行的事件循环，外加建立通道用的有界线程池"""
+
+    def __init__(self, name: str, placement: Optional[Placement] = None):
+        self.name = name
+        self.placement = placement
+        self.loop = asyncio.new_event_loop()
+        self._executor = ThreadPoolExecutor(max_workers=OPEN_WORKERS, thread_name_prefix=f"{name}-open")
+        self._thread: Optional[threading.Thread] = None
+        self._main: Optional[asyncio.Task] = None
+        self._tasks = set()
+        self._relays = set()
+
+    def start(self, main):
+        """启动事件循环线程并运行协程 main (通常是 accept 循环)"""
+        self._thread = threading.Thread(target=self._run, args=(main,), name=self.name, daemon=True)
+        self._thread.start()
+
+    def _run(self, main):
+        if self.placement:
+            self.placement.pin_worker()
+        asyncio.set_event_loop(self.loop)
+        self._main = self.loop.create_task(main)
+        try:
+            self.loop.run_forever()
+        finally:
+            try:
+                self.loop.run_until_complete(self._cancel_all())
+            except Exception:
+                pass
+            self.loop.close()
+
+    def spawn(self, coro) -> asyncio.Task:
+        """在事件循环内创建任务并持有引用直到结束"""
+        task = self.loop.create_task(coro)
+        self._tasks.add(task)
+        task.add_done_callback(self._tasks.discard)
+        return task
+
+    async def run_blocking(self, fn: Callable, *args, **kwargs):
+        return await self.loop.run_in_executor(self._executor, functools.partial(fn, *args, **kwargs))
+
+    def start_relay(self, a, b, pool: BufferPool, on_data: Callable[[object, bool, int], None],
+                    on_done: Callable[[object], None], ctx=None) -> "Relay":
+        """在事件循环内开始中继 a ⇄ b (见 Relay)；搬运完全由读写事件回调驱动，空闲连接不产生任何唤醒"""
+        prepare(a)
+        prepare(b)
+        relay = Relay(self, a, b, pool, on_data, on_done, ctx)
+        try:
+            for d in relay.dirs:
+                self.loop.add_reader(d.src_fd, d.readable)
+        except Exception:
+            for d in relay.dirs:
+                d.stop()
+            raise
+        self._relays.add(relay)
+        return relay
+
+    async def _cancel_all(self):
+        for relay in list(self._relays):
+            relay.finish()
+        tasks = [t for t in list(self._tasks) + [self._main] if t is not None and not t.done()]
+        for t in tasks:
+            t.cancel()
+        await asyncio.gather(*tasks, return_exceptions=True)
+
+    def cancel_main(self, timeout: float = 3):
+        """取消 main (accept 循环) 并等它结束；已有的任务与中继照常运行"""
+
+        async def cancel():
+            if self._main is not None and not self._main.done():
+                self._main.cancel()
+                await asyncio.gather(self._main, return_exceptions=True)
+
+        if self.loop.is_running():
+            try:
+                asyncio.run_coroutine_threadsafe(cancel(), self.loop).result(timeout)
+            except Exception:
+                pass
+
+    def stop(self, timeout: float = 3):
+        if self.loop.is_running():
+            self.loop.call_soon_threadsafe(self.loop.stop)
+        if self._thread:
+            self._thread.join(timeout=timeout)
+        self._executor.shutdown(wait=False)
+
+
+def prepare(conn):
+    """中继前把两端切换为非阻塞"""
+    if isinstance(conn, socket.socket):
+        conn.setblocking(False)
+    else:
+        conn.settimeout(0.0)
+
+
+async def recv_exact(loop: asyncio.AbstractEventLoop, sock: socket.socket, n: int) -> bytes:
+    """从非阻塞套接字读满 n 字节；对端提前关闭时抛出 ConnectionError"""
+    buf = bytearray(n)
+    view = memoryview(buf)
+    got = 0
+    while got < n:
+        k = await loop.sock_recv_into(sock, view[got:])
+        if not k:
+            raise ConnectionError("对端已关闭")
+        got += k
+    return bytes(buf)
+
+
+async def recv_until(loop: asyncio.AbstractEventLoop, sock: socket.socket, data: bytes,
+                     marker: bytes, limit: int = 65536) -> bytes:
+    """追加读取直到 data 中出现 marker (或超过 limit)；对端关闭时返回空串"""
+    while marker not in data and len(data) < limit:
+        chunk = await loop.sock_recv(sock, 4096)
+        if not chunk:
+            return b""
+        data += chunk
+    return data
+
+
+async def send_all(loop: asyncio.AbstractEventLoop, conn, data):
+    if isinstance(conn, socket.socket):
+        await loop.sock_sendall(conn, data)
+        return
+    # paramiko 通道: 窗口满时 send 抛 socket.timeout (非阻塞模式)，没有可等待的事件，退避重试
+    data = bytes(data)
+    delay = _SEND_BACKOFF_MIN
+    while data:
+        try:
+            n = conn.send(data)
+        except socket.timeout:
+            n = 0
+        if n:
+            data = data[n:]
+            delay = _SEND_BACKOFF_MIN
+        else:
+            await asyncio.sleep(delay)
+            delay = min(delay * 2, _SEND_BACKOFF_MAX)
+
+
+def _try_send(dst, data) -> int:
+    """非阻塞发送，返回已发出的字节数 (发送缓冲 / 通道窗口已满时为 0)"""
+    if isinstance(dst, socket.socket):
+        try:
+            return dst.send(data)
+        except (BlockingIOError, InterruptedError):
+            return 0
+    try:
+        return dst.send(bytes(data))
+    except socket.timeout:
+        return 0
+
+
+class _Direction:
+    """单个方向的搬运状态
+
+    空闲时只有源端的一个读事件注册，不持有缓冲区、没有定时器；读到数据时临时借用缓冲区，
+    能一次发完就立即归还。对端发不动时把剩余数据拷出、暂停读取 (背压)，
+    套接字等可写事件，paramiko 通道 (窗口满时没有可等待的事件) 按退避定时重试。
+    """
+
+    __slots__ = ("relay", "src", "dst", "src_fd", "dst_fd", "forward", "pending", "timer", "delay")
+
+    def __init__(self, relay: "Relay", src, dst, forward: bool):
+        self.relay = relay
+        self.src = src
+        self.dst = dst
+        self.src_fd = src.fileno()
+        self.dst_fd = dst.fileno() if isinstance(dst, socket.socket) else -1
+        self.forward = forward
+        self.pending = None
+        self.timer = None
+        self.delay = _SEND_BACKOFF_MIN
+
+    def readable(self):
+        relay = self.relay
+        buf = None
+        try:
+            if isinstance(self.src, socket.socket):
+                buf = relay.pool.take()
+                try:
+                    n = self.src.recv_into(buf)
+                except (BlockingIOError, InterruptedError):
+                    return
+                data = memoryview(buf)[:n]
+            else:
+                try:
+                    data = self.src.recv(relay.pool.size)
+                except socket.timeout:
+                    return
+                n = len(data)
+            if not n:
+                relay.finish()
+                return
+            sent = _try_send(self.dst, data)
+            relay.on_data(relay.ctx, self.forward, n)
+            if sent < n:
+                self.pending = bytes(data[sent:])
+                relay.loop.remove_reader(self.src_fd)
+                self._wait_writable()
+        except Exception:
+            relay.finish()
+        finally:
+            if buf is not None:
+                relay.pool.give(buf)
+
+    def _wait_writable(self):
+        loop = self.relay.loop
+        if self.dst_fd >= 0:
+            loop.add_writer(self.dst_fd, self.writable)
+        else:
+            self.timer = loop.call_later(self.delay, self.writable)
+            self.delay = min(self.delay * 2, _SEND_BACKOFF_MAX)
+
+    def writable(self):
+        relay = self.relay
+        self.timer = None
+        try:
+            sent = _try_send(self.dst, self.pending)
+        except Exception:
+            relay.finish()
+            return
+        if sent < len(self.pending):
+            self.pending = self.pending[sent:]
+            if self.dst_fd < 0:
+                if sent:
+                    self.delay = _SEND_BACKOFF_MIN
+                self._wait_writable()
+            return
+        self.pending = None
+        self.delay = _SEND_BACKOFF_MIN
+        if self.dst_fd >= 0:
+            relay.loop.remove_writer(self.dst_fd)
+        relay.loop.add_reader(self.src_fd, self.readable)
+
+    def stop(self):
+        loop = self.relay.loop
+        loop.remove_reader(self.src_fd)
+        if self.dst_fd >= 0:
+            loop.remove_writer(self.dst_fd)
+        if self.timer:
+            self.timer.cancel()
+            self.timer = None
+        self.pending = None
+
+
+class Relay:
+    """一条连接的双向中继，由 LoopThread.start_relay 创建
+
+    任一方向结束即拆除整条连接 (与线程引擎一致)。建立连接的协程在交出连接后就结束，
+    中继期间不保留任务 / 协程栈；on_data(ctx, forward, n) 统计每块数据 (forward 为 a→b)，
+    on_done(ctx) 在拆除时调用一次，负责关闭两端。
+    """
+
+    __slots__ = ("owner", "loop", "pool", "dirs", "on_data", "on_done", "ctx")
+
+    def __init__(self, owner: "LoopThread", a, b, pool: BufferPool,
+                 on_data: Callable[[object, bool, int], None], on_done: Callable[[object], None], ctx):
+        self.owner = owner
+        self.loop = owner.loop
+        self.pool = pool
+        self.on_data = on_data
+        self.on_done = on_done
+        self.ctx = ctx
+        self.dirs = (_Direction(self, a, b, True), _Direction(self, b, a, False))
+
+    def finish(self):
+        if self.dirs is None:
+            return
+        for d in self.dirs:
+            d.stop()
+        # 断开 Relay 与 _Direction 的循环引用，拆除后立即释放
+        self.dirs = None
+        self.owner._relays.discard(self)
+        try:
+            self.on_done(self.ctx)
+        except Exception as e:
+            logger.debug(f"中继收尾失败: {e}")
@@ -0,0 +1,120 @@
+"""
+SSH 通道控制报文 — 合并窗口调整、后台批量关闭、开销计量
+
+paramiko 对每条通道:
+  - 接收方每消费 window/10 字节就发一个 WINDOW_ADJUST (阈值见 Channel.in_window_threshold)
+  - close() 在调用线程里发 EOF + CLOSE，期间持有传输层写锁
+短连接多时，这些小报文各自一次加密、一次 send 系统调用、一个 TCP 段。这里:
+  - 窗口调整阈值提高到窗口的一半：对端始终还有至少半个窗口可发，不会因此停顿，
+    而调整报文减少约 5 倍 (只按阈值合并；没有到达阈值的余量随 CLOSE 一起作废，不需要按时间补发)
+  - 中继结束后把通道交给关闭线程，中继线程 / 事件循环立即返回；关闭线程一次取走积压的全部通道，
+    同一传输套接字上的多条通道在 TCP_CORK 下连续关闭后再解除，EOF/CLOSE 合并成少数几个 TCP 段
+    (非 Linux 时只是批量)
+  - 按通道估算本端发出的控制报文数: OPEN 1 + WINDOW_ADJUST (下行字节 / 阈值) + EOF/CLOSE 2
+本地套接字 (共享会话从实例、性能测试替身) 没有 SSH 控制报文，直接关闭、计 0。
+"""
+import logging
+import queue
+import socket
+import threading
+from typing import Optional
+
+logger = logging.getLogger(__name__)
+
+TCP_CORK = getattr(socket, "TCP_CORK", None)
+
+# 关闭后恢复 paramiko 默认行为 (默认阈值、在调用线程里同步关闭)，供性能测试对比
+ENABLED = True
+
+# 窗口调整阈值占窗口的比例 (paramiko 默认 1/10)
+WINDOW_ADJUST_FRACTION = 2
+
+
+def tune_channel(channel):
+    """新打开的 paramiko 通道：提高窗口调整阈值"""
+    size = getattr(channel, "in_window_size", None)
+    if ENABLED and size and hasattr(channel, "in_window_threshold"):
+        channel.in_window_threshold = size // WINDOW_ADJUST_FRACTION
+
+
+def control_packets(channel, bytes_down: int) -> int:
+    """估算本端为该通道发出的控制报文数 (本地套接字为 0)"""
+    threshold = getattr(channel, "in_window_threshold", None)
+    if not threshold:
+        return 0
+    return 1 + bytes_down // (threshold + 1) + 2
+
+
+def _cork(sock, on: bool):
+    try:
+        sock.setsockopt(socket.IPPROTO_TCP, TCP_CORK, 1 if on else 0)
+    except (OSError, AttributeError):
+        pass
+
+
+class ChannelCloser:
+    """后台关闭线程 (队列为空时阻塞等待，不轮询)"""
+
+    def __init__(self):
+        self._queue = queue.SimpleQueue()
+        self._lock = threading.Lock()
+        self._thread: Optional[threading.Thread] = None
+        self.closed = 0
+        self.batches = 0
+
+    def close(self, channel):
+        if not ENABLED or not hasattr(channel, "get_transport"):
+            # 本地套接字没有控制报文，直接关闭 (未启用时 paramiko 通道也同步关闭)
+            try:
+                channel.close()
+            except Exception:
+                pass
+            return
+        with self._lock:
+            if self._thread is None:
+                self._thread = threading.Thread(target=self._loop, name="channel-closer", daemon=True)
+                self._thread.start()
+        self._queue.put(channel)
+
+    def _loop(self):
+        while True:
+            batch = [self._queue.get()]
+            while True:
+                try:
+                    batch.append(self._queue.get_nowait())
+                except queue.Empty:
+                    break
+            self._close_batch(batch)
+
+    def _close_batch(self, batch: list):
+        groups = {}
+        for channel in batch:
+            try:
+                sock = getattr(channel.get_transport(), "sock", None)
+            except Exception:
+                sock = None
+            groups.setdefault(id(sock), (sock, []))[1].append(channel)
+
+        for sock, channels in groups.values():
+            cork = TCP_CORK is not None and len(channels) > 1 and isinstance(sock, socket.socket)
+            if cork:
+                _cork(sock, True)
+            try:
+                for channel in channels:
+                    try:
+                        channel.close()
+                    except Exception as e:
+                        logger.debug(f"通道关闭失败: {e}")
+            finally:
+                if cork:
+                    _cork(sock, False)
+        self.closed += len(batch)
+        self.batches += 1
+
+
+_closer = ChannelCloser()
+
+
+def close_channel(channel):
+    """交给关闭线程异步关闭通道"""
+    _closer.close(channel)
@@ -3,8 +3,9 @@
 """
 import json
 import os
-from dataclasses import dataclass, asdict
+from dataclasses import dataclass, asdict, fields
 from pathlib import Path
+from typing import List
 
 CONFIG_DIR = Path(os.environ.get("APPDATA", Path.home() / ".config")) / "SSHTunnelVPN"
 CONFIG_FILE = CONFIG_DIR / "config.json"
@@ -12,6 +13,7 @@ CONFIG_FILE = CONFIG_DIR / "config.json"
 
 @dataclass
 class ServerConfig:
+    name: str = ""
     host: str = ""
     port: int = 22
     username: str = ""
@@ -30,24 +32,67 @@ class ServerConfig:
     socks_port: int = 10800
     http_port: int = 10801
     auto_set_proxy: bool = True
+    control_path: str = ""
+    sniff: bool = False
+    remote_helper: bool = False
+    tuning: str = "balanced"
+    placement: str = ""
+    stats_path: str = ""
+    ledger_path: str = ""
+    trace_path: str = ""
+    engine: str = "thread"
+    udp_transport: bool = False
+    pool_size: int = 1
+    tickless: bool = False
+    drain_timeout: float = 0.0
+
+
+def _from_dict(data: dict) -> ServerConfig:
+    """忽略未知字段，兼容新旧版本配置文件"""
+    known = {f.name for f in fields(ServerConfig)}
+    return ServerConfig(**{k: v for k, v in data.items() if k in known})
+
+
+def _read_raw() -> dict:
+    try:
+        if CONFIG_FILE.exists():
+            with open(CONFIG_FILE, "r", encoding="utf-8") as f:
+                return json.load(f)
+    except Exception:
+        pass
+    return {}
 
 
 def save_config(config: ServerConfig) -> None:
     CONFIG_DIR.mkdir(parents=True, exist_ok=True)
+    data = asdict(config)
+    # 保留手工维护的多隧道 profile 列表
+    profiles = _read_raw().get("profiles")
+    if profiles is not None:
+        data["profiles"] = profiles
     with open(CONFIG_FILE, "w", encoding="utf-8") as f:
-        json.dump(asdict(config), f, indent=2, ensure_ascii=False)
+        json.dump(data, f, indent=2, ensure_ascii=False)
 
 
 def load_config() -> ServerConfig:
     try:
-        if CONFIG_FILE.exists():
-            with open(CONFIG_FILE, "r", encoding="utf-8") as f:
-                return ServerConfig(**json.load(f))
+        return _from_dict(_read_raw())
     except Exception:
         pass
     return ServerConfig()
 
 
+def load_profiles() -> List[ServerConfig]:
+    """读取配置文件中的 "profiles" 列表 (多隧道模式)，每项字段同 ServerConfig"""
+    profiles = []
+    for i, item in enumerate(_read_raw().get("profiles") or []):
+        cfg = _from_dict(item)
+        if not cfg.name:
+            cfg.name = f"profile{i + 1}"
+        profiles.append(cfg)
+    return profiles
+
+
 WINDOW_FILE = CONFIG_DIR / "window.json"
 
 
@@ -0,0 +1,412 @@
+"""
+共享 SSH 会话 (ControlMaster 模式)
+
+主实例持有 paramiko.Transport，并在本地控制套接字上接受其他实例的通道请求；
+从实例无需再做 TCP 连接 / 密钥交换 / 认证 (以及跳板机那一跳)，直接复用主实例的会话。
+
+控制地址:
+  - Unix 域套接字路径，如 /tmp/ssh_tunnel.ctl (支持 AF_UNIX 的平台)
+  - 或本地回环端口，如 127.0.0.1:10899 (Windows 等不支持 AF_UNIX 时)
+
+控制协议 (每条控制连接对应一个 SSH 通道；回环端口先完成下面的口令握手):
+  从 → 主:  b"OPEN <host> <port>\\n"   或   b"PING\\n"   或   b"WATCH\\n"
+  主 → 从:  b"OK\\n" / b"PONG <user@host:port>\\n"   或   b"ERR <原因>\\n"
+  OPEN 的 OK 之后双方透传原始字节，直到任一端关闭；WATCH 的 OK 之后连接保持空闲，
+  主实例停止 (或进程退出) 时关闭，从实例据此得知会话结束而不必定时 PING
+
+访问控制 (控制连接能借主实例已认证的会话连到任意目标，双方都要确认对端是同一用户):
+  - Unix 套接字 bind 后先 chmod 0600 再 listen (listen 之前谁也连不上)；主实例按 SO_PEERCRED
+    只接受同一 uid，从实例发送任何内容前同样核对对端 uid (不支持时核对套接字文件属主)，
+    路径被其他用户抢先占用时拒绝使用
+  - 回环端口任何本机用户都能连，也可能被他人抢先监听。主实例启动时生成随机口令写入配置目录下
+    的 0600 文件，口令本身不经过连接，双方用 HMAC-SHA256 互相质询:
+      主 → 从:  b"HELLO <主随机数>\\n"
+      从 → 主:  b"AUTH <从随机数> <HMAC(口令, client 主随机数 从随机数)>\\n"
+      主 → 从:  b"AUTH <HMAC(口令, master 从随机数 主随机数)>\\n"   (不符时 b"ERR auth\\n")
+    从实例核对主实例的应答之后才发送请求
+  - PONG 带上主实例连接的 user@host:port，从实例与本次要连的不一致时不复用
+"""
+import hashlib
+import hmac
+import logging
+import os
+import secrets
+import stat
+import struct
+import select
+import socket
+import threading
+from pathlib import Path
+from typing import Optional, Tuple
+
+import paramiko
+
+from .channel_ctl import close_channel, tune_channel
+from .config import CONFIG_DIR
+from .tickless import Waker, accept
+
+logger = logging.getLogger(__name__)
+
+_MAX_HEADER = 512
+
+
+def _parse_control_address(path: str) -> Tuple[int, object]:
+    """解析控制地址，返回 (地址族, 地址)"""
+    host, sep, port = path.rpartition(":")
+    if sep and port.isdigit() and "/" not in path and "\\" not in path:
+        return socket.AF_INET, (host or "127.0.0.1", int(port))
+    if not hasattr(socket, "AF_UNIX"):
+        raise Exception(f"当前平台不支持 Unix 套接字，请使用 127.0.0.1:端口 形式的控制地址: {path}")
+    return socket.AF_UNIX, path
+
+
+def _cookie_path(addr: tuple) -> Path:
+    """回环端口控制地址的口令文件 (按用户的配置目录，其他用户读不到)"""
+    return CONFIG_DIR / f"control-{addr[1]}.cookie"
+
+
+def _write_cookie(path: Path) -> bytes:
+    cookie = secrets.token_hex(32).encode()
+    path.parent.mkdir(parents=True, exist_ok=True)
+    try:
+        path.unlink()
+    except OSError:
+        pass
+    fd = os.open(path, os.O_WRONLY | os.O_CREAT | os.O_EXCL, 0o600)
+    with os.fdopen(fd, "wb") as f:
+        f.write(cookie)
+    return cookie
+
+
+def _peer_uid(conn: socket.socket) -> Optional[int]:
+    """Unix 套接字对端的 uid (Linux SO_PEERCRED)；平台不支持时返回 None"""
+    opt = getattr(socket, "SO_PEERCRED", None)
+    if opt is None:
+        return None
+    creds = conn.getsockopt(socket.SOL_SOCKET, opt, struct.calcsize("3i"))
+    return struct.unpack("3i", creds)[1]
+
+
+def _proof(cookie: bytes, role: bytes, first: bytes, second: bytes) -> bytes:
+    """口令握手的应答: HMAC-SHA256(口令, 角色 随机数 随机数)，十六进制"""
+    return hmac.new(cookie, b" ".join((role, first, second)), hashlib.sha256).hexdigest().encode()
+
+
+def _check_unix_peer(sock: socket.socket, path: str):
+    """确认 Unix 控制套接字的另一端属于当前用户，否则抛出异常"""
+    if not hasattr(os, "getuid"):
+        return
+    uid = _peer_uid(sock)
+    if uid is None:
+        st = os.lstat(path)
+        if not stat.S_ISSOCK(st.st_mode):
+            raise Exception(f"控制地址不是套接字: {path}")
+        uid = st.st_uid
+    if uid != os.getuid():
+        raise Exception(f"控制套接字属于其他用户 (uid {uid})，拒绝使用: {path}")
+
+
+def _client_handshake(sock: socket.socket, cookie: bytes):
+    """回环端口: 回应主实例的质询并核对它的应答，确认对端持有同一口令"""
+    hello = _read_line(sock).split()
+    if len(hello) != 2 or hello[0] != b"HELLO":
+        raise Exception("控制端口上的进程没有发出质询，不是主实例")
+    nonce = secrets.token_hex(16).encode()
+    sock.sendall(b"AUTH " + nonce + b" " + _proof(cookie, b"client", hello[1], nonce) + b"\n")
+    reply = _read_line(sock).split()
+    if len(reply) != 2 or reply[0] != b"AUTH" or \
+            not hmac.compare_digest(reply[1], _proof(cookie, b"master", nonce, hello[1])):
+        raise Exception("控制端口上的进程不持有本用户的口令，拒绝使用")
+
+
+def _connect_control(path: str, timeout: float) -> socket.socket:
+    """连接控制地址并确认对端是本用户的主实例 (确认之前不发送任何请求)"""
+    family, addr = _parse_control_address(path)
+    sock = socket.socket(family, socket.SOCK_STREAM)
+    sock.settimeout(timeout)
+    try:
+        sock.connect(addr)
+        if family == socket.AF_INET:
+            _client_handshake(sock, _cookie_path(addr).read_bytes().strip())
+        else:
+            _check_unix_peer(sock, path)
+    except Exception:
+        sock.close()
+        raise
+    return sock
+
+
+def _read_line(sock: socket.socket) -> bytes:
+    """读取一行控制头 (不越过换行符，避免吞掉后续透传数据)"""
+    data = b""
+    while not data.endswith(b"\n"):
+        if len(data) >= _MAX_HEADER:
+            raise Exception("控制头过长")
+        ch = sock.recv(1)
+        if not ch:
+            break
+        data += ch
+    return data.rstrip(b"\r\n")
+
+
+class ControlMasterServer:
+    """主实例：在控制套接字上为其他实例代开 direct-tcpip 通道
+
+    identity 为本会话连接的 user@host:port，随 PONG 返回给从实例核对。
+    """
+
+    def __init__(self, ssh_transport: paramiko.Transport, path: str, identity: str = ""):
+        self.transport = ssh_transport
+        self.path = path
+        self.identity = identity
+        # 回环端口地址的口令 (Unix 套接字靠文件权限与对端 uid，不用口令)
+        self._cookie: Optional[bytes] = None
+        self.server_socket: Optional[socket.socket] = None
+        self.running = False
+        self._thread: Optional[threading.Thread] = None
+        self._waker: Optional[Waker] = None
+        self._lock = threading.Lock()
+        # 进行中的控制连接 (stop 时 shutdown，让阻塞在 select 上的中继线程立即退出)
+        self._conns = set()
+
+    def start(self):
+        family, addr = _parse_control_address(self.path)
+        if family == socket.AF_UNIX and os.path.exists(self.path):
+            # 残留的套接字文件: 若已无主实例监听则清理掉
+            if ControlClientTransport(self.path).is_active():
+                raise Exception(f"控制套接字已被其他主实例占用: {self.path}")
+            os.unlink(self.path)
+
+        self.server_socket = socket.socket(family, socket.SOCK_STREAM)
+        if family == socket.AF_INET:
+            self.server_socket.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.server_socket.setblocking(False)
+        if family == socket.AF_UNIX:
+            # listen 之前的套接字文件谁也连不上，chmod 在 listen 前完成就没有可连的窗口
+            # (不改进程 umask，以免其他线程同时创建的文件也变成 0600)
+            self.server_socket.bind(addr)
+            os.chmod(self.path, 0o600)
+        else:
+            self.server_socket.bind(addr)
+            self._cookie = _write_cookie(_cookie_path(addr))
+        self.server_socket.listen(128)
+        self._waker = Waker()
+        self.running = True
+
+        self._thread = threading.Thread(target=self._accept_loop, daemon=True)
+        self._thread.start()
+        logger.info(f"共享会话控制套接字已启动: {self.path}")
+
+    def stop(self):
+        self.running = False
+        if self._waker:
+            self._waker.wake()
+        if self._thread:
+            self._thread.join(timeout=3)
+        if self.server_socket:
+            try:
+                self.server_socket.close()
+            except Exception:
+                pass
+        if self._waker:
+            self._waker.close()
+        with self._lock:
+            conns = list(self._conns)
+        for conn in conns:
+            try:
+                conn.shutdown(socket.SHUT_RDWR)
+            except OSError:
+                pass
+        family, addr = _parse_control_address(self.path)
+        try:
+            if family == socket.AF_UNIX:
+                os.unlink(self.path)
+            elif self._cookie is not None:
+                _cookie_path(addr).unlink()
+        except OSError:
+            pass
+        logger.info("共享会话控制套接字已停止")
+
+    def _accept_loop(self):
+        while self.running:
+            try:
+                conn = accept(self.server_socket, self._waker)
+                if conn is None:
+                    break
+                threading.Thread(target=self._handle_client, args=(conn[0],), daemon=True).start()
+            except Exception as e:
+                if self.running:
+                    logger.error(f"控制套接字接受连接错误: {e}")
+                break
+
+    def _handle_client(self, conn: socket.socket):
+        with self._lock:
+            self._conns.add(conn)
+        try:
+            conn.settimeout(10)
+            if not self._authorized(conn):
+                return
+            header = _read_line(conn).decode("utf-8", errors="replace").split()
+            if header == ["PING"]:
+                conn.sendall(f"PONG {self.identity}\n".encode("utf-8"))
+                return
+            if header == ["WATCH"]:
+                # 保持到从实例断开或 stop() 把它 shutdown
+                conn.sendall(b"OK\n")
+                conn.settimeout(None)
+                while self.running and conn.recv(64):
+                    pass
+                return
+            if len(header) != 3 or header[0] != "OPEN" or not header[2].isdigit():
+                conn.sendall(b"ERR bad request\n")
+                return
+
+            dest_addr, dest_port = header[1], int(header[2])
+            try:
+                channel = self.transport.open_channel(
+                    "direct-tcpip",
+                    (dest_addr, dest_port),
+                    ("127.0.0.1", 0),
+                    timeout=10
+                )
+            except Exception as e:
+                logger.debug(f"共享会话通道失败 {dest_addr}:{dest_port}: {e}")
+                conn.sendall(f"ERR {e}\n".encode("utf-8", errors="replace"))
+                return
+
+            tune_channel(channel)
+            conn.sendall(b"OK\n")
+            self._relay(conn, channel)
+
+        except Exception as e:
+            logger.debug(f"控制连接处理错误: {e}")
+        finally:
+            with self._lock:
+                self._conns.discard(conn)
+            try:
+                conn.close()
+            except Exception:
+                pass
+
+    def _authorized(self, conn: socket.socket) -> bool:
+        if self._cookie is None:
+            uid = _peer_uid(conn)
+            if uid is not None and hasattr(os, "getuid") and uid != os.getuid():
+                logger.warning(f"拒绝其他用户 (uid {uid}) 的控制连接")
+                return False
+            return True
+        nonce = secrets.token_hex(16).encode()
+        conn.sendall(b"HELLO " + nonce + b"\n")
+        parts = _read_line(conn).split()
+        if len(parts) != 3 or parts[0] != b"AUTH" or \
+                not hmac.compare_digest(parts[2], _proof(self._cookie, b"client", nonce, parts[1])):
+            logger.warning("拒绝口令不符的控制连接")
+            conn.sendall(b"ERR auth\n")
+            return False
+        conn.sendall(b"AUTH " + _proof(self._cookie, b"master", parts[1], nonce) + b"\n")
+        return True
+
+    def _relay(self, conn: socket.socket, channel: paramiko.Channel):
+        channel.settimeout(None)
+        conn.settimeout(None)
+        try:
+            while self.running:
+                r, _, _ = select.select([conn, channel], [], [])
+                if conn in r:
+                    data = conn.recv(65536)
+                    if not data:
+                        break
+                    channel.sendall(data)
+                if channel in r:
+                    data = channel.recv(65536)
+                    if not data:
+                        break
+                    conn.sendall(data)
+        except Exception:
+            pass
+        finally:
+            close_channel(channel)
+
+
+class ControlClientTransport:
+    """从实例：替代 paramiko.Transport，经主实例的控制套接字打开通道
+
+    open_channel() 返回一个已连接的本地套接字，可直接交给 Socks5Server 的中继使用。
+    identity 非空时只认连接着同一 user@host:port 的主实例 (见 is_active)。
+    """
+
+    def __init__(self, path: str, identity: str = ""):
+        self.path = path
+        self.identity = identity
+        self._watch_sock: Optional[socket.socket] = None
+        self._closed = False
+
+    def watch(self) -> bool:
+        """阻塞到主实例停止或 close()；主实例不支持 WATCH (旧版本) 时立即返回 False"""
+        try:
+            sock = _connect_control(self.path, timeout=2)
+        except Exception:
+            return True
+        self._watch_sock = sock
+        try:
+            if self._closed:
+                return True
+            sock.sendall(b"WATCH\n")
+            if _read_line(sock) != b"OK":
+                return False
+            sock.settimeout(None)
+            while sock.recv(64):
+                pass
+        except Exception:
+            pass
+        finally:
+            self._watch_sock = None
+            sock.close()
+        return True
+
+    def close(self):
+        """结束 watch()"""
+        self._closed = True
+        sock = self._watch_sock
+        if sock is not None:
+            try:
+                sock.shutdown(socket.SHUT_RDWR)
+            except OSError:
+                pass
+
+    def probe(self) -> Optional[str]:
+        """主实例存活时返回它连接的 user@host:port，否则 None"""
+        try:
+            sock = _connect_control(self.path, timeout=2)
+        except Exception:
+            return None
+        try:
+            sock.sendall(b"PING\n")
+            reply = _read_line(sock).decode("utf-8", errors="replace")
+        except Exception:
+            return None
+        finally:
+            sock.close()
+        word, _, identity = reply.partition(" ")
+        return identity if word == "PONG" else None
+
+    def is_active(self) -> bool:
+        identity = self.probe()
+        return identity is not None and (not self.identity or identity == self.identity)
+
+    def open_channel(self, kind: str, dest_addr: tuple, src_addr: tuple = None,
+                     timeout: float = None) -> socket.socket:
+        if kind != "direct-tcpip":
+            raise Exception(f"共享会话不支持的通道类型: {kind}")
+        sock = _connect_control(self.path, timeout=timeout or 10)
+        try:
+            sock.sendall(f"OPEN {dest_addr[0]} {int(dest_addr[1])}\n".encode("utf-8"))
+            reply = _read_line(sock)
+        except Exception:
+            sock.close()
+            raise
+        if reply != b"OK":
+            sock.close()
+            raise Exception(reply.decode("utf-8", errors="replace") or "主实例已关闭连接")
+        sock.settimeout(None)
+        return sock
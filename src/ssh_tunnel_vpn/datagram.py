@@ -0,0 +1,855 @@
+"""
+UDP 数据通道 — 不受单条 TCP 连接队头阻塞影响的多路复用流 (仅依赖 Python 3 标准库)
+
+全部通道承载在 SSH 的一条 TCP 连接上时，丢一个包就让所有通道一起等这一个包重传。
+启用后伴随进程 (remote_agent.py) 另开一个 UDP 端口，会话密钥经 SSH exec 通道的 stdout 下发
+(不出现在命令行里)，之后客户端与伴随进程直接交换 UDP 报文，SSH 会话保留为控制通道与回退:
+  - 加密与认证: 每个方向独立的密钥；密钥流为 SHAKE-256(加密密钥 ‖ 包号) (可扩展输出，
+    一次调用生成整包长度)，密文再做 keyed BLAKE2b-128 认证 (encrypt-then-MAC)。标准库没有 AEAD，
+    服务器端又不能要求安装 cryptography，所以只用 hashlib 的原语组合
+  - 每个包号只用一次，收端按包号去重 (防重放)；认证失败的报文直接丢弃、不回应
+  - 路径验证 (QUIC 式): 对端从新地址发来最新的报文时 (NAT 重新映射)，先向新地址发 PATH_CHALLENGE，
+    收到从该地址回来的 PATH_RESPONSE 才改发到新地址；抢先转发一个截获报文的中间人改不了发送方向
+  - 可靠性按流: STREAM 帧带流内偏移，丢包只让该流后面的数据等待重排，其他流照常交付
+  - 确认按包号 (QUIC 式): ACK 帧列出收到的包号区间；比已确认的包号落后 3 个以上、
+    或超过 9/8 RTT 仍未确认的包判丢，其中的帧放进新包重传；尾部丢包靠 PTO 探测
+  - 拥塞控制: 慢启动 + 线性增长的 cwnd，只在 cwnd 真正受限时增长。2~5% 随机丢包的链路上
+    "丢包即减半" 会把窗口压到几个包 (Mathis 上限)，所以区分丢包原因: RTT 比最小 RTT 明显抬升
+    (排队) 时的丢包按拥塞处理、窗口乘 0.7；RTT 未抬升的丢包只结束慢启动、不减窗；
+    连续 PTO 时减半。流量控制: 按流的接收窗口
+  - 每条流在本地用 socketpair 桥接，上层拿到普通套接字 (与共享会话的 ControlClientTransport 一致)
+只有一个 I/O 线程；没有在途数据时 select 不设超时，空闲不唤醒 (客户端有流打开时每 15 秒
+发一个 PING 保活 NAT 映射)。
+
+报文: 包号 u64 | 密文 | 认证标签 16 字节；明文由若干帧组成:
+  PING 0x01 | ACK 0x02 n [最小包号 u64, 最大包号 u64]*n | STREAM 0x03 流号 u32 偏移 u64 FIN u8 长度 u16 数据
+  RESET 0x04 流号 u32 | WINDOW 0x05 流号 u32 最大偏移 u64 | CLOSE 0x06
+  PATH_CHALLENGE 0x07 随机数 8 字节 | PATH_RESPONSE 0x08 随机数 8 字节 (原样回显，回到质询来的地址)
+客户端打开的流号为奇数；伴随进程收到新流号时建立 socketpair 交给 on_stream。
+"""
+import hashlib
+import hmac
+import logging
+import secrets
+import selectors
+import socket
+import struct
+import threading
+import time
+from collections import deque
+from typing import Callable, Optional
+
+logger = logging.getLogger(__name__)
+
+MAX_PACKET = 1350
+MAX_STREAM_DATA = 1150
+STREAM_WINDOW = 1 << 20
+INITIAL_CWND = 10 * MAX_PACKET
+MIN_CWND = 2 * MAX_PACKET
+INITIAL_RTT = 0.1
+PACKET_THRESHOLD = 3
+TIME_THRESHOLD = 9 / 8
+# RTT 超过 最小 RTT × 1.25 + 4ms 视为链路在排队 (拥塞)
+RTT_INFLATION = 1.25
+RTT_INFLATION_SLACK = 0.004
+LOSS_BETA = 0.7
+MAX_ACK_RANGES = 8
+KEEPALIVE = 15.0
+# 连续这么多次 PTO 没有任何确认即认为对端不可达 (约十几秒)
+DEAD_AFTER_PTO = 6
+SOCKET_BUFFER = 4 << 20
+_RECV_BATCH = 512
+
+_PING, _ACK, _STREAM, _RESET, _WINDOW, _CLOSE, _PATH_CHALLENGE, _PATH_RESPONSE = range(1, 9)
+_PATH_DATA = 8
+_PN = struct.Struct(">Q")
+_STREAM_HDR = struct.Struct(">BIQBH")
+_ACK_RANGE = struct.Struct(">QQ")
+_SID = struct.Struct(">BI")
+_WINDOW_FMT = struct.Struct(">BIQ")
+_TAG = 16
+_OVERHEAD = _PN.size + _TAG
+
+
+def derive_keys(secret: bytes, client: bool) -> tuple:
+    """返回 ((发送加密密钥, 发送认证密钥), (接收加密密钥, 接收认证密钥))"""
+    def k(label: bytes) -> bytes:
+        return hashlib.blake2b(key=secret, digest_size=32, person=label).digest()
+
+    c2s = (k(b"c2s-enc"), k(b"c2s-mac"))
+    s2c = (k(b"s2c-enc"), k(b"s2c-mac"))
+    return (c2s, s2c) if client else (s2c, c2s)
+
+
+def _keystream(key: bytes, nonce: bytes, n: int) -> bytes:
+    return hashlib.shake_256(key + nonce).digest(n)
+
+
+def _xor(data: bytes, stream: bytes) -> bytes:
+    n = len(data)
+    return (int.from_bytes(data, "big") ^ int.from_bytes(stream, "big")).to_bytes(n, "big")
+
+
+def seal(keys: tuple, pn: int, plaintext: bytes) -> bytes:
+    enc, mac = keys
+    header = _PN.pack(pn)
+    ct = _xor(plaintext, _keystream(enc, header, len(plaintext)))
+    return header + ct + hashlib.blake2b(header + ct, key=mac, digest_size=_TAG).digest()
+
+
+def unseal(keys: tuple, datagram: bytes) -> Optional[tuple]:
+    """认证并解密，返回 (包号, 明文)；认证失败返回 None"""
+    if len(datagram) <= _OVERHEAD:
+        return None
+    enc, mac = keys
+    header, ct, tag = datagram[:_PN.size], datagram[_PN.size:-_TAG], datagram[-_TAG:]
+    if not hmac.compare_digest(hashlib.blake2b(header + ct, key=mac, digest_size=_TAG).digest(), tag):
+        return None
+    return _PN.unpack(header)[0], _xor(ct, _keystream(enc, header, len(ct)))
+
+
+class _PacketNumbers:
+    """已收到的包号区间 (按包号降序)，用于去重与生成 ACK 帧"""
+
+    MAX_RANGES = 32
+
+    def __init__(self):
+        self.ranges = []
+        # 低于 floor 的包号一律视为重复 (区间过多时丢弃最老的区间)
+        self.floor = 0
+
+    @property
+    def largest(self) -> int:
+        return self.ranges[0][1] if self.ranges else -1
+
+    def add(self, pn: int) -> bool:
+        if pn < self.floor:
+            return False
+        ranges = self.ranges
+        for i, r in enumerate(ranges):
+            lo, hi = r
+            if lo <= pn <= hi:
+                return False
+            if pn == hi + 1:
+                r[1] = pn
+                if i > 0 and ranges[i - 1][0] == pn + 1:
+                    ranges[i - 1][0] = lo
+                    del ranges[i]
+                return True
+            if pn == lo - 1:
+                r[0] = pn
+                if i + 1 < len(ranges) and ranges[i + 1][1] == pn - 1:
+                    r[0] = ranges[i + 1][0]
+                    del ranges[i + 1]
+                return True
+            if pn > hi:
+                ranges.insert(i, [pn, pn])
+                self._trim()
+                return True
+        ranges.append([pn, pn])
+        self._trim()
+        return True
+
+    def _trim(self):
+        if len(self.ranges) > self.MAX_RANGES:
+            self.floor = self.ranges.pop()[1] + 1
+
+    def ack_frame(self) -> bytes:
+        ranges = self.ranges[:MAX_ACK_RANGES]
+        return bytes((_ACK, len(ranges))) + b"".join(_ACK_RANGE.pack(lo, hi) for lo, hi in ranges)
+
+
+class _Sent:
+    __slots__ = ("time", "size", "frames")
+
+    def __init__(self, t: float, size: int, frames: list):
+        self.time = t
+        self.size = size
+        self.frames = frames
+
+
+class _Stream:
+    """一条流的两端状态；sock 是 socketpair 中 I/O 线程持有的一端 (非阻塞)"""
+
+    __slots__ = ("sid", "sock", "mask", "send_off", "peer_max", "queued", "queued_fin", "local_eof",
+                 "recv_off", "recv_buf", "fin_off", "out", "delivered", "adv_max", "peer_done")
+
+    def __init__(self, sid: int, sock: socket.socket):
+        self.sid = sid
+        self.sock = sock
+        self.mask = 0
+        # 发送方向: 已发出的偏移、对端允许的最大偏移、读出但还没装进报文的一块数据
+        self.send_off = 0
+        self.peer_max = STREAM_WINDOW
+        self.queued: Optional[bytes] = None
+        self.queued_fin = False
+        self.local_eof = False
+        # 接收方向: 按序收到的偏移、乱序到达的帧、对端 FIN 的位置、待写入本地套接字的数据
+        self.recv_off = 0
+        self.recv_buf = {}
+        self.fin_off: Optional[int] = None
+        self.out = bytearray()
+        self.delivered = 0
+        self.adv_max = STREAM_WINDOW
+        self.peer_done = False
+
+
+def _encode(frame: tuple) -> bytes:
+    kind = frame[0]
+    if kind == _STREAM:
+        _, sid, off, fin, data = frame
+        return _STREAM_HDR.pack(_STREAM, sid, off, fin, len(data)) + data
+    if kind == _RESET:
+        return _SID.pack(_RESET, frame[1])
+    if kind == _WINDOW:
+        return _WINDOW_FMT.pack(_WINDOW, frame[1], frame[2])
+    return bytes((kind,))
+
+
+class DatagramSession:
+    """一端的 UDP 会话 (客户端或伴随进程)，由单个 I/O 线程驱动"""
+
+    def __init__(self, sock: socket.socket, secret: bytes, client: bool, peer=None,
+                 on_stream: Optional[Callable[[socket.socket], None]] = None):
+        self.sock = sock
+        self.client = client
+        self.peer = peer
+        self.on_stream = on_stream
+        self._tx, self._rx = derive_keys(secret, client)
+        sock.setblocking(False)
+        for opt in (socket.SO_RCVBUF, socket.SO_SNDBUF):
+            try:
+                sock.setsockopt(socket.SOL_SOCKET, opt, SOCKET_BUFFER)
+            except OSError:
+                pass
+
+        # 客户端收到第一个合法报文后才可用；伴随进程一直可用
+        self.alive = not client
+        self.error = ""
+        self._ready = threading.Event()
+        self._running = False
+        self._closing = False
+        self._thread: Optional[threading.Thread] = None
+        self._sel = selectors.DefaultSelector()
+        self._wake_r, self._wake_w = socket.socketpair()
+        self._wake_r.setblocking(False)
+        self._wake_w.setblocking(False)
+        self._lock = threading.Lock()
+        self._new = []
+        self._next_sid = 1 if client else 2
+        # 对端的流号: 低于 floor 的都已结束，closed 为 floor 之上已结束的 (各流到达顺序不一定按流号)
+        self._peer_floor = 2 if client else 1
+        self._peer_closed = set()
+
+        self._streams = {}
+        self._dirty = set()
+        self._sendq = deque()
+        self._retx = deque()
+        self._control = deque()
+        self._ping_pending = False
+        self._ack_pending = False
+        # 正在验证的新对端地址: (地址, 质询数据, 发出时间)；待回应的质询: [(地址, 质询数据)]
+        self._path_probe: Optional[tuple] = None
+        self._path_responses = []
+
+        self._received = _PacketNumbers()
+        self._next_pn = 0
+        self._sent = {}
+        self._largest_acked = -1
+        self._loss_time: Optional[float] = None
+        self._last_eliciting = 0.0
+        self._last_recv = 0.0
+        self._pto_count = 0
+        self.in_flight = 0
+        self.cwnd = INITIAL_CWND
+        self.ssthresh = 1 << 62
+        self._recovery_start = 0.0
+        self.srtt: Optional[float] = None
+        self.rttvar = 0.0
+        self.latest_rtt = 0.0
+        self.min_rtt: Optional[float] = None
+
+        self.packets_sent = 0
+        self.packets_recv = 0
+        self.lost_packets = 0
+        self.retransmits = 0
+
+    # ---- 对外接口 (任意线程) ----
+
+    @classmethod
+    def connect(cls, host: str, port: int, secret: bytes, timeout: float = 3.0) -> "DatagramSession":
+        """客户端: 向伴随进程的 UDP 端口握手，超时 (防火墙未放行等) 抛出异常"""
+        family, _, _, _, addr = socket.getaddrinfo(host, port, 0, socket.SOCK_DGRAM)[0]
+        session = cls(socket.socket(family, socket.SOCK_DGRAM), secret, client=True, peer=addr)
+        session.start()
+        session.ping()
+        if not session._ready.wait(timeout) or not session.alive:
+            session.close()
+            raise Exception(f"UDP {host}:{port} 无响应 (防火墙 / 安全组未放行?)")
+        return session
+
+    def start(self):
+        self._sel.register(self.sock, selectors.EVENT_READ, None)
+        self._sel.register(self._wake_r, selectors.EVENT_READ, self._wake_r)
+        self._running = True
+        self._thread = threading.Thread(target=self._run, name="datagram", daemon=True)
+        self._thread.start()
+
+    def open_stream(self) -> socket.socket:
+        """打开一条新流，返回本地一端 (阻塞套接字)"""
+        if not self.alive:
+            raise OSError(f"UDP 数据通道不可用: {self.error}")
+        a, b = socket.socketpair()
+        b.setblocking(False)
+        with self._lock:
+            sid = self._next_sid
+            self._next_sid += 2
+            self._new.append(_Stream(sid, b))
+        self._wake()
+        return a
+
+    def ping(self):
+        self._ping_pending = True
+        self._wake()
+
+    def close(self):
+        if not self._running:
+            return
+        self._closing = True
+        self._wake()
+        if self._thread and self._thread is not threading.current_thread():
+            self._thread.join(timeout=3)
+
+    def stats(self) -> dict:
+        return {
+            "streams": len(self._streams),
+            "packets_sent": self.packets_sent,
+            "packets_recv": self.packets_recv,
+            "lost": self.lost_packets,
+            "retransmits": self.retransmits,
+            "srtt_ms": (self.srtt or 0.0) * 1000,
+            "cwnd": self.cwnd,
+        }
+
+    def _wake(self):
+        try:
+            self._wake_w.send(b"\0")
+        except OSError:
+            pass
+
+    # ---- I/O 线程 ----
+
+    def _run(self):
+        try:
+            while self._running and not self._closing:
+                now = time.monotonic()
+                events = self._sel.select(self._timeout(now))
+                now = time.monotonic()
+                for key, mask in events:
+                    obj = key.data
+                    if obj is None:
+                        self._on_udp(now)
+                    elif obj is self._wake_r:
+                        self._on_wake()
+                    else:
+                        if mask & selectors.EVENT_WRITE:
+                            self._write_out(obj)
+                        if mask & selectors.EVENT_READ and obj.sock is not None:
+                            self._read_local(obj)
+                self._on_timers(now)
+                self._flush(now)
+                self._update_interest()
+            if self._closing and self.peer is not None:
+                self._send_packet([bytes((_CLOSE,))], [], time.monotonic())
+        except Exception as e:
+            logger.debug(f"UDP 数据通道异常: {e}")
+            self.error = str(e)
+        finally:
+            self._running = False
+            self.alive = False
+            self._ready.set()
+            self._drop_all()
+            for s in (self.sock, self._wake_r, self._wake_w):
+                try:
+                    s.close()
+                except OSError:
+                    pass
+            self._sel.close()
+
+    def _timeout(self, now: float) -> Optional[float]:
+        deadlines = []
+        if self._loss_time is not None:
+            deadlines.append(self._loss_time)
+        if self._sent:
+            deadlines.append(self._pto_deadline())
+        elif self.client and self._streams and self.alive:
+            deadlines.append(max(self._last_eliciting, self._last_recv) + KEEPALIVE)
+        if not deadlines:
+            return None
+        return max(0.0, min(deadlines) - now)
+
+    def _pto_deadline(self) -> float:
+        if self.srtt is None:
+            pto = 2 * INITIAL_RTT
+        else:
+            pto = self.srtt + max(4 * self.rttvar, 0.001) + 0.01
+        return self._last_eliciting + pto * (1 << self._pto_count)
+
+    def _on_timers(self, now: float):
+        if self._loss_time is not None and now >= self._loss_time:
+            self._detect_loss(now)
+        if self._sent and now >= self._pto_deadline():
+            self._pto_count += 1
+            if self._pto_count >= DEAD_AFTER_PTO:
+                self._die("对端无响应")
+                return
+            # 尾部丢包: 在途的包全部按丢失处理，帧进新包重传；只有 PING 时补发 PING
+            self._on_lost(list(self._sent), now)
+            self.cwnd = max(self.cwnd // 2, MIN_CWND)
+            self.ssthresh = self.cwnd
+            if not self._retx and not self._control:
+                self._ping_pending = True
+        elif (self.client and self._streams and not self._sent
+              and now >= max(self._last_eliciting, self._last_recv) + KEEPALIVE):
+            self._ping_pending = True
+
+    def _on_wake(self):
+        try:
+            while self._wake_r.recv(4096):
+                pass
+        except (BlockingIOError, InterruptedError):
+            pass
+        with self._lock:
+            new, self._new = self._new, []
+        for s in new:
+            if self.alive:
+                self._streams[s.sid] = s
+                self._dirty.add(s)
+            else:
+                s.sock.close()
+
+    # ---- 接收 ----
+
+    def _on_udp(self, now: float):
+        for _ in range(_RECV_BATCH):
+            try:
+                data, addr = self.sock.recvfrom(65536)
+            except (BlockingIOError, InterruptedError):
+                return
+            except OSError:
+                # 已连接地址的 ICMP 错误等，不影响其他报文
+                continue
+            opened = unseal(self._rx, data)
+            if opened is None:
+                continue
+            pn, plain = opened
+            if not self._received.add(pn):
+                continue
+            self.packets_recv += 1
+            self._last_recv = now
+            if self.peer is None:
+                # 伴随进程从第一个合法报文学到客户端地址
+                self.peer = addr
+            elif pn == self._received.largest and addr != self.peer:
+                # 对端换了地址 (NAT 重新映射)：验证新地址能收发之后才切换
+                self._probe_path(addr, now)
+            if not self.alive and self.client:
+                self.alive = True
+                self._ready.set()
+            try:
+                if self._on_frames(plain, now, addr):
+                    self._ack_pending = True
+            except (struct.error, IndexError) as e:
+                logger.debug(f"UDP 报文格式错误: {e}")
+            for to, challenge in self._path_responses:
+                self._send_packet([bytes((_PATH_RESPONSE,)) + challenge], [], now, to)
+            self._path_responses.clear()
+
+    def _probe_path(self, addr, now: float):
+        """向候选地址发 PATH_CHALLENGE；同一地址按 RTT 限速重发同一质询 (先前的回应仍然有效)"""
+        probe = self._path_probe
+        if probe is not None and probe[0] == addr:
+            if now - probe[2] < (self.srtt or INITIAL_RTT):
+                return
+            challenge = probe[1]
+        else:
+            challenge = secrets.token_bytes(_PATH_DATA)
+        self._path_probe = (addr, challenge, now)
+        self._send_packet([bytes((_PATH_CHALLENGE,)) + challenge], [], now, addr)
+
+    def _on_frames(self, buf: bytes, now: float, addr=None) -> bool:
+        """处理一个报文 (来自 addr) 中的全部帧，返回是否需要确认"""
+        pos = 0
+        eliciting = False
+        while pos < len(buf):
+            kind = buf[pos]
+            if kind == _PING:
+                pos += 1
+                eliciting = True
+            elif kind == _ACK:
+                n = buf[pos + 1]
+                pos += 2
+                ranges = [_ACK_RANGE.unpack_from(buf, pos + i * _ACK_RANGE.size) for i in range(n)]
+                pos += n * _ACK_RANGE.size
+                self._on_ack(ranges, now)
+            elif kind == _STREAM:
+                _, sid, off, fin, n = _STREAM_HDR.unpack_from(buf, pos)
+                pos += _STREAM_HDR.size
+                self._on_stream_frame(sid, off, fin, buf[pos:pos + n])
+                pos += n
+                eliciting = True
+            elif kind == _RESET:
+                _, sid = _SID.unpack_from(buf, pos)
+                pos += _SID.size
+                s = self._streams.get(sid)
+                if s is not None:
+                    self._abort(s, notify=False)
+                elif self._is_new_peer_sid(sid):
+                    # RESET 先于该流的首个 STREAM 帧到达: 之后到达的帧不再建流
+                    self._retire_peer_sid(sid)
+                eliciting = True
+            elif kind == _WINDOW:
+                _, sid, max_off = _WINDOW_FMT.unpack_from(buf, pos)
+                pos += _WINDOW_FMT.size
+                s = self._streams.get(sid)
+                if s is not None and max_off > s.peer_max:
+                    s.peer_max = max_off
+                    self._dirty.add(s)
+                eliciting = True
+            elif kind == _CLOSE:
+                self._die("对端已关闭")
+                return False
+            elif kind in (_PATH_CHALLENGE, _PATH_RESPONSE):
+                data = buf[pos + 1:pos + 1 + _PATH_DATA]
+                if len(data) != _PATH_DATA:
+                    break
+                pos += 1 + _PATH_DATA
+                if kind == _PATH_CHALLENGE:
+                    self._path_responses.append((addr, data))
+                else:
+                    probe = self._path_probe
+                    if probe is not None and probe[0] == addr and hmac.compare_digest(probe[1], data):
+                        logger.debug(f"UDP 对端地址已验证，改发到 {addr}")
+                        self.peer = addr
+                        self._path_probe = None
+            else:
+                break
+        return eliciting
+
+    def _on_stream_frame(self, sid: int, off: int, fin: int, data: bytes):
+        s = self._streams.get(sid)
+        if s is None:
+            # 对端新开的流 (已结束的流的重传帧直接忽略)
+            if self.on_stream is None or not self._is_new_peer_sid(sid):
+                return
+            a, b = socket.socketpair()
+            a.setblocking(False)
+            s = self._streams[sid] = _Stream(sid, a)
+            self._dirty.add(s)
+            try:
+                self.on_stream(b)
+            except Exception as e:
+                logger.debug(f"新流处理失败: {e}")
+                b.close()
+        end = off + len(data)
+        if off > s.recv_off:
+            s.recv_buf.setdefault(off, (data, fin))
+            return
+        if end < s.recv_off or (end == s.recv_off and not fin) or s.fin_off is not None:
+            return
+        self._deliver(s, data[s.recv_off - off:], fin)
+        while s.recv_buf and s.fin_off is None:
+            item = s.recv_buf.pop(s.recv_off, None)
+            if item is None:
+                break
+            self._deliver(s, *item)
+        self._write_out(s)
+
+    @staticmethod
+    def _deliver(s: _Stream, data: bytes, fin: int):
+        s.out += data
+        s.recv_off += len(data)
+        if fin:
+            s.fin_off = s.recv_off
+            s.recv_buf.clear()
+
+    def _write_out(self, s: _Stream):
+        if s.sock is None:
+            return
+        if s.out:
+            try:
+                n = s.sock.send(s.out)
+            except (BlockingIOError, InterruptedError):
+                n = 0
+            except OSError:
+                self._abort(s, notify=True)
+                return
+            if n:
+                del s.out[:n]
+                s.delivered += n
+                # 本地消费过半个窗口就放宽对端的发送上限
+                if s.fin_off is None and s.delivered + STREAM_WINDOW - s.adv_max >= STREAM_WINDOW // 2:
+                    s.adv_max = s.delivered + STREAM_WINDOW
+                    self._control.append((_WINDOW, s.sid, s.adv_max))
+        if not s.out and s.fin_off is not None and not s.peer_done:
+            s.peer_done = True
+            try:
+                s.sock.shutdown(socket.SHUT_WR)
+            except OSError:
+                pass
+            self._maybe_finish(s)
+        self._dirty.add(s)
+
+    def _on_ack(self, ranges: list, now: float):
+        if not ranges:
+            return
+        acked = [pn for pn in self._sent if any(lo <= pn <= hi for lo, hi in ranges)]
+        if not acked:
+            return
+        largest = ranges[0][1]
+        # 应用本身发得少 (在途不到半个窗口) 时不增窗，免得空闲后一次性突发
+        limited = self.in_flight >= self.cwnd // 2
+        for pn in acked:
+            p = self._sent.pop(pn)
+            self.in_flight -= p.size
+            if pn == largest:
+                self._update_rtt(now - p.time)
+            if limited and p.time > self._recovery_start:
+                if self.cwnd < self.ssthresh:
+                    self.cwnd += p.size
+                else:
+                    self.cwnd += MAX_PACKET * p.size // self.cwnd
+        if self.cwnd < self.ssthresh and self._queueing():
+            # RTT 开始抬升即结束慢启动，不等丢包
+            self.ssthresh = self.cwnd
+        if largest > self._largest_acked:
+            self._largest_acked = largest
+        self._pto_count = 0
+        self._detect_loss(now)
+
+    def _update_rtt(self, sample: float):
+        self.latest_rtt = sample
+        if self.srtt is None:
+            self.srtt = sample
+            self.rttvar = sample / 2
+        else:
+            self.rttvar = 0.75 * self.rttvar + 0.25 * abs(self.srtt - sample)
+            self.srtt = 0.875 * self.srtt + 0.125 * sample
+        if self.min_rtt is None or sample < self.min_rtt:
+            self.min_rtt = sample
+
+    def _queueing(self) -> bool:
+        return (self.min_rtt is not None
+                and self.latest_rtt > self.min_rtt * RTT_INFLATION + RTT_INFLATION_SLACK)
+
+    def _detect_loss(self, now: float):
+        self._loss_time = None
+        if self._largest_acked < 0:
+            return
+        delay = TIME_THRESHOLD * max(self.srtt or INITIAL_RTT, self.latest_rtt)
+        lost = []
+        for pn, p in self._sent.items():
+            if pn > self._largest_acked:
+                break
+            if self._largest_acked - pn >= PACKET_THRESHOLD or p.time <= now - delay:
+                lost.append(pn)
+            elif self._loss_time is None:
+                self._loss_time = p.time + delay
+        if lost:
+            self._on_lost(lost, now)
+
+    def _on_lost(self, pns: list, now: float):
+        newest = 0.0
+        for pn in pns:
+            p = self._sent.pop(pn)
+            self.in_flight -= p.size
+            self.lost_packets += 1
+            newest = max(newest, p.time)
+            for frame in p.frames:
+                kind = frame[0]
+                if kind == _STREAM:
+                    self._retx.append(frame)
+                    self.retransmits += 1
+                elif kind == _RESET:
+                    self._control.append(frame)
+                elif kind == _WINDOW:
+                    s = self._streams.get(frame[1])
+                    if s is not None and s.fin_off is None:
+                        self._control.append((_WINDOW, s.sid, s.adv_max))
+        # 同一丢包事件 (恢复期开始后发出的包才算新事件) 只处理一次
+        if newest > self._recovery_start:
+            self._recovery_start = now
+            if self._queueing():
+                self.cwnd = max(int(self.cwnd * LOSS_BETA), MIN_CWND)
+                self.ssthresh = self.cwnd
+            else:
+                # 随机丢包: 只结束慢启动
+                self.ssthresh = min(self.ssthresh, self.cwnd)
+
+    # ---- 发送 ----
+
+    def _read_local(self, s: _Stream):
+        room = min(MAX_STREAM_DATA, s.peer_max - s.send_off)
+        if s.queued is not None or s.local_eof or room <= 0:
+            return
+        try:
+            data = s.sock.recv(room)
+        except (BlockingIOError, InterruptedError):
+            return
+        except OSError:
+            self._abort(s, notify=True)
+            return
+        s.queued = data
+        if not data:
+            s.queued_fin = True
+            s.local_eof = True
+        self._sendq.append(s)
+        self._dirty.add(s)
+
+    def _flush(self, now: float):
+        if self.peer is None:
+            return
+        while True:
+            parts = []
+            frames = []
+            size = _OVERHEAD
+            if self._ack_pending and self._received.ranges:
+                ack = self._received.ack_frame()
+                parts.append(ack)
+                size += len(ack)
+                self._ack_pending = False
+            if self.in_flight < self.cwnd:
+                if self._ping_pending:
+                    self._ping_pending = False
+                    parts.append(bytes((_PING,)))
+                    frames.append((_PING,))
+                    size += 1
+                while self._control and size + _WINDOW_FMT.size <= MAX_PACKET:
+                    frame = self._control.popleft()
+                    enc = _encode(frame)
+                    parts.append(enc)
+                    frames.append(frame)
+                    size += len(enc)
+                while self._retx and size + _STREAM_HDR.size + len(self._retx[0][4]) <= MAX_PACKET:
+                    frame = self._retx.popleft()
+                    enc = _encode(frame)
+                    parts.append(enc)
+                    frames.append(frame)
+                    size += len(enc)
+                while self._sendq:
+                    s = self._sendq[0]
+                    if s.sock is None:
+                        self._sendq.popleft()
+                        continue
+                    if size + _STREAM_HDR.size + len(s.queued) > MAX_PACKET:
+                        break
+                    self._sendq.popleft()
+                    frame = (_STREAM, s.sid, s.send_off, int(s.queued_fin), s.queued)
+                    s.send_off += len(s.queued)
+                    s.queued = None
+                    self._dirty.add(s)
+                    enc = _encode(frame)
+                    parts.append(enc)
+                    frames.append(frame)
+                    size += len(enc)
+                    if s.queued_fin:
+                        self._maybe_finish(s)
+            if not parts:
+                return
+            if not self._send_packet(parts, frames, now) or not frames:
+                return
+
+    def _send_packet(self, parts: list, frames: list, now: float, addr=None) -> bool:
+        """发送一个报文 (默认发给当前对端)；需要确认的登记为在途 (发不出去时按丢包处理)，返回套接字是否还能写"""
+        pn = self._next_pn
+        self._next_pn += 1
+        data = seal(self._tx, pn, b"".join(parts))
+        ok = True
+        try:
+            self.sock.sendto(data, addr or self.peer)
+        except (BlockingIOError, InterruptedError):
+            ok = False
+        except OSError as e:
+            logger.debug(f"UDP 发送失败: {e}")
+        self.packets_sent += 1
+        if frames:
+            self._sent[pn] = _Sent(now, len(data), frames)
+            self.in_flight += len(data)
+            self._last_eliciting = now
+        return ok
+
+    def _update_interest(self):
+        for s in self._dirty:
+            if s.sock is None:
+                continue
+            mask = 0
+            if not s.local_eof and s.queued is None and s.send_off < s.peer_max:
+                mask |= selectors.EVENT_READ
+            if s.out:
+                mask |= selectors.EVENT_WRITE
+            if mask != s.mask:
+                if not s.mask:
+                    self._sel.register(s.sock, mask, s)
+                elif not mask:
+                    self._sel.unregister(s.sock)
+                else:
+                    self._sel.modify(s.sock, mask, s)
+                s.mask = mask
+        self._dirty.clear()
+
+    # ---- 流结束 ----
+
+    def _is_new_peer_sid(self, sid: int) -> bool:
+        return (sid & 1) == (self._peer_floor & 1) and sid >= self._peer_floor and sid not in self._peer_closed
+
+    def _retire_peer_sid(self, sid: int):
+        if (sid & 1) != (self._peer_floor & 1):
+            return
+        self._peer_closed.add(sid)
+        while self._peer_floor in self._peer_closed:
+            self._peer_closed.discard(self._peer_floor)
+            self._peer_floor += 2
+
+    def _maybe_finish(self, s: _Stream):
+        if s.local_eof and s.queued is None and s.peer_done:
+            self._release(s)
+
+    def _abort(self, s: _Stream, notify: bool):
+        if notify:
+            self._control.append((_RESET, s.sid))
+        self._release(s)
+
+    def _release(self, s: _Stream):
+        if s.sock is None:
+            return
+        if s.mask:
+            self._sel.unregister(s.sock)
+            s.mask = 0
+        try:
+            s.sock.close()
+        except OSError:
+            pass
+        s.sock = None
+        self._streams.pop(s.sid, None)
+        self._retire_peer_sid(s.sid)
+
+    def _drop_all(self):
+        for s in list(self._streams.values()):
+            self._release(s)
+        self._sendq.clear()
+        self._retx.clear()
+        self._control.clear()
+        self._sent.clear()
+        self.in_flight = 0
+        self._loss_time = None
+
+    def _die(self, reason: str):
+        """对端不可达 / 已关闭: 关闭全部流。客户端停用会话 (之后的连接回退 SSH)，伴随进程继续等待新报文"""
+        logger.debug(f"UDP 数据通道中断: {reason}")
+        self.error = reason
+        self._drop_all()
+        self._pto_count = 0
+        self.cwnd = INITIAL_CWND
+        if self.client:
+            self.alive = False
+            self._running = False
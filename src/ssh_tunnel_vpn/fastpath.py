@@ -0,0 +1,112 @@
+"""
+本地 socket→socket 内核态转发 (Linux splice)
+
+两端都是普通本地套接字的中继 (HTTP 代理 → 本地 SOCKS5、共享会话从实例、本地替身等)
+用 splice(2) 经管道在内核内搬运数据，不再把每个字节拷进 Python 再写回。
+
+只在 Linux 且 Python ≥ 3.10 (os.splice) 时启用；首次 splice 即失败 (EINVAL / ENOSYS 等)
+说明该套接字组合不支持，调用方回退为用户态中继；已读入管道的数据会先用 os.read 写给目标端，不会丢失。
+"""
+import errno
+import os
+import select
+import socket
+import sys
+from typing import Callable, Optional
+
+try:
+    import fcntl
+except ImportError:  # Windows
+    fcntl = None
+
+AVAILABLE = sys.platform.startswith("linux") and hasattr(os, "splice") and fcntl is not None
+
+# fcntl.F_SETPIPE_SZ (Python 3.10+ 才导出)
+_F_SETPIPE_SZ = getattr(fcntl, "F_SETPIPE_SZ", 1031)
+_UNSUPPORTED = (errno.EINVAL, errno.ENOSYS, errno.EOPNOTSUPP)
+
+
+class _Pipe:
+    """单方向的中转管道"""
+
+    def __init__(self, size: int):
+        self.r, self.w = os.pipe()
+        try:
+            fcntl.fcntl(self.w, _F_SETPIPE_SZ, size)
+        except OSError:
+            pass
+        self.size = size
+
+    def close(self):
+        os.close(self.r)
+        os.close(self.w)
+
+
+def _move(src: socket.socket, dst: socket.socket, pipe: _Pipe,
+          on_moved: Optional[Callable[[int], None]] = None) -> int:
+    """src → 管道 → dst，返回本次搬运字节数 (0 表示 src EOF，-1 表示暂无数据)
+
+    管道 → dst 不被支持时，已进管道的数据改用 os.read + sendall 写出后再抛出原异常。
+    """
+    try:
+        n = os.splice(src.fileno(), pipe.w, pipe.size, flags=os.SPLICE_F_MOVE | os.SPLICE_F_NONBLOCK)
+    except BlockingIOError:
+        return -1
+    left = n
+    try:
+        while left:
+            left -= os.splice(pipe.r, dst.fileno(), left, flags=os.SPLICE_F_MOVE)
+    except OSError as e:
+        if e.errno not in _UNSUPPORTED:
+            raise
+        while left:
+            data = os.read(pipe.r, left)
+            dst.sendall(data)
+            left -= len(data)
+        if on_moved:
+            on_moved(n)
+        raise
+    if n > 0 and on_moved:
+        on_moved(n)
+    return n
+
+
+def splice_relay(a: socket.socket, b: socket.socket, chunk: int,
+                 running: Callable[[], bool],
+                 on_a_to_b: Callable[[int], None] = None,
+                 on_b_to_a: Callable[[int], None] = None,
+                 timeout: Optional[float] = None) -> bool:
+    """在内核内双向转发 a ↔ b，直到任一端 EOF / 出错或 running() 为假
+
+    返回 False 表示内核路径不可用 (管道中已有的数据均已写出)，调用方应回退为用户态中继。
+    两端套接字须为阻塞模式：select 保证读端有数据，写端在对端缓冲满时等待。
+    默认不设超时 (空闲时不唤醒)，调用方停止时关闭 (shutdown) 其中一端即可让循环退出。
+    """
+    if not AVAILABLE or not isinstance(a, socket.socket) or not isinstance(b, socket.socket):
+        return False
+
+    a.settimeout(None)
+    b.settimeout(None)
+    a_to_b = _Pipe(chunk)
+    b_to_a = _Pipe(chunk)
+    started = False
+    try:
+        while running():
+            r, _, _ = select.select([a, b], [], [], timeout)
+            if a in r:
+                n = _move(a, b, a_to_b, on_a_to_b)
+                started = True
+                if not n:
+                    break
+            if b in r:
+                n = _move(b, a, b_to_a, on_b_to_a)
+                started = True
+                if not n:
+                    break
+    except OSError as e:
+        if not started and e.errno in _UNSUPPORTED:
+            return False
+    finally:
+        a_to_b.close()
+        b_to_a.close()
+    return True
@@ -6,6 +6,7 @@
   - HTTP  请求: 解析 Host，通过 SOCKS5 连接目标，转发请求和响应
   - HTTPS 请求: 收到 CONNECT 方法后，通过 SOCKS5 建立隧道，双向透传数据
 """
+import asyncio
 import logging
 import select
 import socket
@@ -13,6 +14,13 @@ import struct
 import threading
 from typing import Optional
 
+from . import async_engine
+from .async_engine import BufferPool, LoopThread
+from .fastpath import splice_relay
+from .placement import Placement
+from .tickless import Waker, accept
+from .tuning import TuningProfile, apply_client_socket, get_profile
+
 logger = logging.getLogger(__name__)
 
 
@@ -20,14 +28,18 @@ class HttpProxyServer:
     """本地 HTTP/HTTPS 代理，流量通过 SOCKS5 上游转发"""
 
     def __init__(self, listen_port: int = 10801, socks_port: int = 10800,
-                 socks_host: str = "127.0.0.1"):
+                 socks_host: str = "127.0.0.1", tuning: Optional[TuningProfile] = None,
+                 placement: Optional[Placement] = None):
         self.listen_port = listen_port
         self.socks_port = socks_port
         self.socks_host = socks_host
+        self.tuning = tuning or get_profile(None)
+        self.placement = placement
 
         self._server: Optional[socket.socket] = None
         self._running = False
         self._thread: Optional[threading.Thread] = None
+        self._waker: Optional[Waker] = None
 
         # 流量统计
         self._lock = threading.Lock()
@@ -35,28 +47,46 @@ class HttpProxyServer:
         self._bytes_down = 0
         self._active = 0
         self._total = 0
+        # 进行中的客户端连接 (stop 时 shutdown，让阻塞在 select 上的中继线程立即退出)
+        self._clients = set()
 
     def start(self):
         self._server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
         self._server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
-        self._server.settimeout(1.0)
+        self._server.setblocking(False)
         self._server.bind(("127.0.0.1", self.listen_port))
         self._server.listen(128)
+        self._waker = Waker()
         self._running = True
 
         self._thread = threading.Thread(target=self._accept_loop, daemon=True)
         self._thread.start()
         logger.info(f"HTTP 代理已启动: 127.0.0.1:{self.listen_port} → SOCKS5 {self.socks_host}:{self.socks_port}")
 
-    def stop(self):
-        self._running = False
+    def stop_accepting(self):
+        """关闭监听端口，已建立的连接照常转发 (排空用，见 SshTunnelManager.disconnect)"""
+        if self._waker:
+            self._waker.wake()
+        if self._thread:
+            self._thread.join(timeout=3)
         if self._server:
             try:
                 self._server.close()
             except Exception:
                 pass
-        if self._thread:
-            self._thread.join(timeout=3)
+        if self._waker:
+            self._waker.close()
+
+    def stop(self):
+        self._running = False
+        self.stop_accepting()
+        with self._lock:
+            clients = list(self._clients)
+        for client in clients:
+            try:
+                client.shutdown(socket.SHUT_RDWR)
+            except OSError:
+                pass
         logger.info("HTTP 代理已停止")
 
     def get_stats(self) -> dict:
@@ -69,20 +99,28 @@ class HttpProxyServer:
             }
 
     def _accept_loop(self):
+        if self.placement:
+            self.placement.pin_listener()
+        # 不设超时: 空闲时阻塞在 select 上，stop() 经 waker 唤醒
         while self._running:
             try:
-                client, addr = self._server.accept()
+                conn = accept(self._server, self._waker)
+                if conn is None:
+                    break
+                client, addr = conn
                 client.settimeout(30)
+                apply_client_socket(client, self.tuning)
                 threading.Thread(target=self._handle_client, args=(client,), daemon=True).start()
-            except socket.timeout:
-                continue
             except OSError:
                 break
 
     def _handle_client(self, client: socket.socket):
+        if self.placement:
+            self.placement.pin_worker()
         with self._lock:
             self._active += 1
             self._total += 1
+            self._clients.add(client)
         try:
             # 读取第一行请求
             data = b""
@@ -114,6 +152,7 @@ class HttpProxyServer:
                 pass
             with self._lock:
                 self._active -= 1
+                self._clients.discard(client)
 
     def _handle_connect(self, client: socket.socket, target: str, initial_data: bytes):
         """处理 HTTPS CONNECT 隧道"""
@@ -143,28 +182,7 @@ class HttpProxyServer:
 
     def _handle_http(self, client: socket.socket, method: str, target: str, initial_data: bytes):
         """处理普通 HTTP 请求"""
-        # target 可能是 http://host:port/path 或 /path
-        if target.startswith("http://"):
-            # 绝对形式 — 典型的代理请求
-            url_rest = target[7:]  # 去掉 http://
-            slash_pos = url_rest.find("/")
-            if slash_pos == -1:
-                host_part = url_rest
-                path = "/"
-            else:
-                host_part = url_rest[:slash_pos]
-                path = url_rest[slash_pos:]
-            host, port = self._parse_host_port(host_part, default_port=80)
-        else:
-            # 从 Host 头提取
-            host, port, path = None, 80, target
-            header_str = initial_data.decode("utf-8", errors="replace")
-            for line in header_str.split("\r\n"):
-                if line.lower().startswith("host:"):
-                    host_val = line.split(":", 1)[1].strip()
-                    host, port = self._parse_host_port(host_val, default_port=80)
-                    break
-
+        host, port, path = self._http_target(target, initial_data)
         if not host:
             client.sendall(b"HTTP/1.1 400 Bad Request\r\n\r\n")
             return
@@ -176,11 +194,7 @@ class HttpProxyServer:
             return
 
         # 重写请求行: 把绝对 URL 改为相对路径
-        first_line_end = initial_data.index(b"\r\n")
-        original_first_line = initial_data[:first_line_end]
-        parts = original_first_line.split(b" ", 2)
-        new_first_line = parts[0] + b" " + path.encode("utf-8") + b" " + parts[2]
-        rewritten = new_first_line + initial_data[first_line_end:]
+        rewritten = self._rewrite_request_line(initial_data, path)
 
         # 发送重写后的请求
         remote.sendall(rewritten)
@@ -194,6 +208,7 @@ class HttpProxyServer:
         """通过本地 SOCKS5 代理连接目标"""
         try:
             sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+            apply_client_socket(sock, self.tuning)
             sock.settimeout(15)
             sock.connect((self.socks_host, self.socks_port))
 
@@ -205,10 +220,7 @@ class HttpProxyServer:
                 return None
 
             # SOCKS5 CONNECT 请求
-            # 使用域名方式 (0x03)
-            host_bytes = host.encode("utf-8")
-            req = b"\x05\x01\x00\x03" + bytes([len(host_bytes)]) + host_bytes + struct.pack("!H", port)
-            sock.sendall(req)
+            sock.sendall(self._socks5_request(host, port))
 
             resp = sock.recv(10)
             if len(resp) < 2 or resp[1] != 0x00:
@@ -244,22 +256,37 @@ class HttpProxyServer:
                 pass
             return None
 
+    def _count_up(self, n: int):
+        with self._lock:
+            self._bytes_up += n
+
+    def _count_down(self, n: int):
+        with self._lock:
+            self._bytes_down += n
+
     def _relay(self, client: socket.socket, remote: socket.socket):
         """双向数据中继"""
-        client.setblocking(False)
-        remote.setblocking(False)
+        chunk = self.tuning.relay_chunk
+        # 阻塞模式：select 保证 recv 不阻塞；sendall 在对端缓冲满时等待而不是抛错。
+        # select 不设超时，空闲的长连接不会被周期性唤醒；stop() 通过 shutdown 客户端套接字结束中继
+        client.setblocking(True)
+        remote.setblocking(True)
         try:
+            # 两端都是本地套接字：优先在内核内转发，不支持时回退到下面的用户态循环
+            if splice_relay(client, remote, chunk, lambda: self._running,
+                            self._count_up, self._count_down):
+                return
             while self._running:
-                r, _, _ = select.select([client, remote], [], [], 2.0)
+                r, _, _ = select.select([client, remote], [], [])
                 if client in r:
-                    data = client.recv(65536)
+                    data = client.recv(chunk)
                     if not data:
                         break
                     remote.sendall(data)
                     with self._lock:
                         self._bytes_up += len(data)
                 if remote in r:
-                    data = remote.recv(65536)
+                    data = remote.recv(chunk)
                     if not data:
                         break
                     client.sendall(data)
@@ -273,6 +300,45 @@ class HttpProxyServer:
             except Exception:
                 pass
 
+    @staticmethod
+    def _socks5_request(host: str, port: int) -> bytes:
+        """SOCKS5 CONNECT 请求，使用域名方式 (0x03)"""
+        host_bytes = host.encode("utf-8")
+        return b"\x05\x01\x00\x03" + bytes([len(host_bytes)]) + host_bytes + struct.pack("!H", port)
+
+    @classmethod
+    def _http_target(cls, target: str, initial_data: bytes) -> tuple:
+        """普通 HTTP 请求的 (host, port, path)；target 可能是 http://host:port/path 或 /path"""
+        if target.startswith("http://"):
+            # 绝对形式 — 典型的代理请求
+            host_part, path = cls._split_absolute_url(target)
+            host, port = cls._parse_host_port(host_part, default_port=80)
+            return host, port, path
+        # 从 Host 头提取
+        header_str = initial_data.decode("utf-8", errors="replace")
+        for line in header_str.split("\r\n"):
+            if line.lower().startswith("host:"):
+                host_val = line.split(":", 1)[1].strip()
+                host, port = cls._parse_host_port(host_val, default_port=80)
+                return host, port, target
+        return None, 80, target
+
+    @staticmethod
+    def _split_absolute_url(target: str) -> tuple:
+        """http://host:port/path → (host:port, /path)"""
+        url_rest = target[7:]  # 去掉 http://
+        slash_pos = url_rest.find("/")
+        if slash_pos == -1:
+            return url_rest, "/"
+        return url_rest[:slash_pos], url_rest[slash_pos:]
+
+    @staticmethod
+    def _rewrite_request_line(initial_data: bytes, path: str) -> bytes:
+        """把请求行中的绝对 URL 换成 path，其余字节原样保留"""
+        first_line_end = initial_data.index(b"\r\n")
+        parts = initial_data[:first_line_end].split(b" ", 2)
+        return parts[0] + b" " + path.encode("utf-8") + b" " + parts[2] + initial_data[first_line_end:]
+
     @staticmethod
     def _parse_host_port(addr: str, default_port: int = 80) -> tuple:
         """解析 host:port 格式，支持 IPv6 [::1]:port"""
@@ -296,3 +362,165 @@ class HttpProxyServer:
             except ValueError:
                 return addr, default_port
         return addr, default_port
+
+
+class AsyncHttpProxyServer(HttpProxyServer):
+    """asyncio 引擎的 HTTP 代理 (见 async_engine.py)：单个事件循环线程服务全部连接"""
+
+    def __init__(self, *args, **kwargs):
+        super().__init__(*args, **kwargs)
+        self._loop_thread: Optional[LoopThread] = None
+        self._pool = BufferPool(self.tuning.relay_chunk)
+        self._on_relay_data = self._relay_data
+        self._on_relay_done = self._relay_done
+
+    def start(self):
+        self._server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        self._server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self._server.setblocking(False)
+        self._server.bind(("127.0.0.1", self.listen_port))
+        self._server.listen(128)
+        self._running = True
+
+        self._loop_thread = LoopThread(f"http-{self.listen_port}", self.placement)
+        self._loop_thread.start(self._accept_loop_async())
+        logger.info(f"HTTP 代理已启动: 127.0.0.1:{self.listen_port} → SOCKS5 {self.socks_host}:{self.socks_port} (asyncio)")
+
+    def stop_accepting(self):
+        if self._loop_thread:
+            self._loop_thread.cancel_main()
+        if self._server:
+            try:
+                self._server.close()
+            except Exception:
+                pass
+
+    def stop(self):
+        self._running = False
+        if self._loop_thread:
+            self._loop_thread.stop()
+        if self._server:
+            try:
+                self._server.close()
+            except Exception:
+                pass
+        logger.info("HTTP 代理已停止")
+
+    async def _accept_loop_async(self):
+        loop = asyncio.get_running_loop()
+        while self._running:
+            try:
+                client, _ = await loop.sock_accept(self._server)
+            except OSError:
+                break
+            client.setblocking(False)
+            apply_client_socket(client, self.tuning)
+            self._loop_thread.spawn(self._handle_client_async(client))
+
+    async def _handle_client_async(self, client: socket.socket):
+        loop = asyncio.get_running_loop()
+        remote = None
+        with self._lock:
+            self._active += 1
+            self._total += 1
+        try:
+            # 与线程引擎一致：请求头 30 秒内没读完则放弃
+            data = await asyncio.wait_for(async_engine.recv_until(loop, client, b"", b"\r\n"), 30)
+            parts = data.split(b"\r\n", 1)[0].decode("utf-8", errors="replace").split()
+            if len(parts) < 3:
+                return
+            method = parts[0].upper()
+            target = parts[1]
+
+            if method == "CONNECT":
+                host, port = self._parse_host_port(target, default_port=443)
+                if not host:
+                    await loop.sock_sendall(client, b"HTTP/1.1 400 Bad Request\r\n\r\n")
+                    return
+                if not await asyncio.wait_for(async_engine.recv_until(loop, client, data, b"\r\n\r\n"), 30):
+                    return
+                remote = await self._connect_via_socks5_async(host, port)
+                if remote is None:
+                    await loop.sock_sendall(client, b"HTTP/1.1 502 Bad Gateway\r\n\r\n")
+                    return
+                await loop.sock_sendall(client, b"HTTP/1.1 200 Connection Established\r\n\r\n")
+            else:
+                host, port, path = self._http_target(target, data)
+                if not host:
+                    await loop.sock_sendall(client, b"HTTP/1.1 400 Bad Request\r\n\r\n")
+                    return
+                remote = await self._connect_via_socks5_async(host, port)
+                if remote is None:
+                    await loop.sock_sendall(client, b"HTTP/1.1 502 Bad Gateway\r\n\r\n")
+                    return
+                rewritten = self._rewrite_request_line(data, path)
+                await loop.sock_sendall(remote, rewritten)
+                self._count_up(len(rewritten))
+
+            # 交给事件循环的读写回调，本协程随即结束；收尾在 _relay_done
+            self._loop_thread.start_relay(client, remote, self._pool, self._on_relay_data, self._on_relay_done,
+                                          (client, remote))
+            client = remote = None
+
+        except Exception as e:
+            logger.debug(f"HTTP 代理处理错误: {e}")
+        finally:
+            if client is not None:
+                self._relay_done((client, remote))
+
+    def _relay_data(self, ctx, forward: bool, n: int):
+        if forward:
+            self._count_up(n)
+        else:
+            self._count_down(n)
+
+    def _relay_done(self, ctx):
+        for conn in ctx:
+            if conn is not None:
+                try:
+                    conn.close()
+                except Exception:
+                    pass
+        with self._lock:
+            self._active -= 1
+
+    async def _connect_via_socks5_async(self, host: str, port: int) -> Optional[socket.socket]:
+        """通过本地 SOCKS5 代理连接目标 (非阻塞)"""
+        loop = asyncio.get_running_loop()
+        recv_exact = async_engine.recv_exact
+        sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        ok = False
+        try:
+            apply_client_socket(sock, self.tuning)
+            sock.setblocking(False)
+
+            async def handshake():
+                await loop.sock_connect(sock, (self.socks_host, self.socks_port))
+                await loop.sock_sendall(sock, b"\x05\x01\x00")
+                if await recv_exact(loop, sock, 2) != b"\x05\x00":
+                    return False
+                await loop.sock_sendall(sock, self._socks5_request(host, port))
+                resp = await recv_exact(loop, sock, 4)
+                if resp[1] != 0x00:
+                    return False
+                # 读完回复中的 BND.ADDR / BND.PORT
+                atyp = resp[3]
+                if atyp == 0x01:
+                    await recv_exact(loop, sock, 4 + 2)
+                elif atyp == 0x03:
+                    await recv_exact(loop, sock, (await recv_exact(loop, sock, 1))[0] + 2)
+                elif atyp == 0x04:
+                    await recv_exact(loop, sock, 16 + 2)
+                return True
+
+            ok = await asyncio.wait_for(handshake(), 15)
+        except Exception as e:
+            logger.debug(f"SOCKS5 连接失败 {host}:{port} — {e}")
+            ok = False
+        finally:
+            if not ok:
+                try:
+                    sock.close()
+                except Exception:
+                    pass
+        return sock if ok else None
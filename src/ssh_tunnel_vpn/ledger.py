@@ -0,0 +1,364 @@
+"""
+按目标域名 / 按天的流量账本 — 追加写入的列式文件
+
+get_stats() 的计数在每次重连后清零，账本则跨会话保存"流量去了哪里":
+  - 连接结束时按目标的域名后缀 (如 www.example.co.uk → example.co.uk) 与当天日期
+    累加上行 / 下行字节与连接数，后台线程把聚合结果追加为一个数据块：第一条记录进来后
+    一分钟落盘，没有新记录时不唤醒
+  - 追加块过多时压缩：追加块与本月的整月块重新聚合，按自然月写成整月块后原子替换文件；
+    往月的整月块原样保留，压缩耗时不随历史增长
+  - 读取直接 mmap 文件，按块头的日期范围跳过无关块，只解码命中的列
+
+文件布局 (小端):
+  文件头 16 字节: magic "SSHTLEDG", 版本
+  数据块: 块头 (magic "BLK1" 追加块 / "BLKM" 压缩后的整月块, 行数 n, 最早日, 最晚日, 字符串表长度)
+          日期 u32[n] | 域名编号 u32[n] | 上行 u64[n] | 下行 u64[n] | 连接数 u32[n]
+          | 域名字符串表 (\\0 分隔) | CRC32
+  日期为 date.toordinal()；CRC 不符的块 (磁盘损坏等) 读取与压缩时跳过，不影响其后的块；
+  只有文件末尾长度不完整的残块 (写入中断) 会在打开时截掉。
+"""
+import atexit
+import ipaddress
+import logging
+import mmap
+import os
+import struct
+import sys
+import threading
+import time
+import zlib
+from array import array
+from datetime import date
+from typing import Dict, Iterator, List, Optional, Tuple
+
+try:
+    import fcntl
+except ImportError:  # Windows
+    fcntl = None
+
+logger = logging.getLogger(__name__)
+
+MAGIC = b"SSHTLEDG"
+VERSION = 1
+_FILE_HEADER = struct.Struct("<8sI4x")
+_BLOCK_MAGIC = b"BLK1"
+_MONTH_MAGIC = b"BLKM"
+_BLOCK_HEADER = struct.Struct("<4sIIII")
+
+FLUSH_INTERVAL = 60.0
+# 追加块超过该数目时压缩
+COMPACT_BLOCKS = 32
+
+# 常见的二级公共后缀，如 co.uk / com.cn
+_SECOND_LEVEL = {"co", "com", "net", "org", "gov", "edu", "ac", "or", "ne", "go"}
+
+
+def domain_suffix(host: str) -> str:
+    """取可注册域名作为统计键；IP 地址原样返回"""
+    host = host.strip().rstrip(".").lower()
+    try:
+        ipaddress.ip_address(host.strip("[]"))
+        return host
+    except ValueError:
+        pass
+    labels = host.split(".")
+    if len(labels) <= 2:
+        return host
+    if len(labels[-1]) == 2 and labels[-2] in _SECOND_LEVEL:
+        return ".".join(labels[-3:])
+    return ".".join(labels[-2:])
+
+
+# array 的类型码宽度随平台而定，取 4 / 8 字节的那一个
+_U32 = "I" if array("I").itemsize == 4 else "L"
+_U64 = "Q"
+_BIG_ENDIAN = sys.byteorder == "big"
+
+
+def _col(fmt: str, data, offset: int, n: int) -> Tuple[array, int]:
+    col = array(fmt)
+    size = col.itemsize * n
+    col.frombytes(data[offset:offset + size])
+    if _BIG_ENDIAN:
+        col.byteswap()
+    return col, offset + size
+
+
+def encode_block(rows: List[Tuple[int, str, int, int, int]], magic: bytes = _BLOCK_MAGIC) -> bytes:
+    """rows: [(日期, 域名, 上行, 下行, 连接数)]"""
+    names: Dict[str, int] = {}
+    days, ids, ups, downs, conns = array(_U32), array(_U32), array(_U64), array(_U64), array(_U32)
+    for day, name, up, down, n in rows:
+        days.append(day)
+        ids.append(names.setdefault(name, len(names)))
+        ups.append(up)
+        downs.append(down)
+        conns.append(n)
+    strings = b"\0".join(n.encode("utf-8") for n in names)
+    header = _BLOCK_HEADER.pack(magic, len(rows), min(days), max(days), len(strings))
+    cols = [days, ids, ups, downs, conns]
+    if _BIG_ENDIAN:
+        for c in cols:
+            c.byteswap()
+    body = header + b"".join(c.tobytes() for c in cols) + strings
+    return body + struct.pack("<I", zlib.crc32(body))
+
+
+def scan_blocks(data) -> List[Tuple[int, int, bytes, int, int]]:
+    """按块头遍历文件，返回完整块的 (起始偏移, CRC 偏移, magic, 最早日, 最晚日)；遇到残块停止"""
+    if len(data) < _FILE_HEADER.size or _FILE_HEADER.unpack_from(data, 0) != (MAGIC, VERSION):
+        raise Exception("不是可识别的流量账本文件")
+    blocks = []
+    offset = _FILE_HEADER.size
+    while offset + _BLOCK_HEADER.size <= len(data):
+        magic, n, day_min, day_max, strings_len = _BLOCK_HEADER.unpack_from(data, offset)
+        end = offset + _BLOCK_HEADER.size + n * 28 + strings_len
+        if magic not in (_BLOCK_MAGIC, _MONTH_MAGIC) or end + 4 > len(data):
+            break
+        blocks.append((offset, end, magic, day_min, day_max))
+        offset = end + 4
+    return blocks
+
+
+def decode_block(data, offset: int, end: int) -> Optional[tuple]:
+    """解码一个块，产出 (日期, 域名编号, 上行, 下行, 连接数, 域名表)；CRC 不符时返回 None"""
+    if struct.unpack_from("<I", data, end)[0] != zlib.crc32(data[offset:end]):
+        return None
+    _, n, _, _, strings_len = _BLOCK_HEADER.unpack_from(data, offset)
+    pos = offset + _BLOCK_HEADER.size
+    days, pos = _col(_U32, data, pos, n)
+    ids, pos = _col(_U32, data, pos, n)
+    ups, pos = _col(_U64, data, pos, n)
+    downs, pos = _col(_U64, data, pos, n)
+    conns, pos = _col(_U32, data, pos, n)
+    names = bytes(data[pos:pos + strings_len]).decode("utf-8").split("\0") if strings_len else [""]
+    return days, ids, ups, downs, conns, names
+
+
+def iter_blocks(data, since: int = 0, until: int = 1 << 31) -> Iterator[tuple]:
+    """遍历与 [since, until] 日期范围相交的块；只解码命中的块"""
+    for offset, end, _, day_min, day_max in scan_blocks(data):
+        if day_max < since or day_min > until:
+            continue
+        block = decode_block(data, offset, end)
+        if block is None:
+            continue
+        yield block
+
+
+def _merge(merged: Dict[Tuple[int, str], List[int]], block: tuple):
+    days, ids, ups, downs, conns, names = block
+    for i in range(len(days)):
+        key = (days[i], names[ids[i]])
+        t = merged.get(key)
+        if t is None:
+            t = merged[key] = [0, 0, 0]
+        t[0] += ups[i]
+        t[1] += downs[i]
+        t[2] += conns[i]
+
+
+def query(path: str, since: int = 0, until: int = 1 << 31) -> Dict[str, List[int]]:
+    """按域名汇总 [since, until] 日期范围内的 [上行, 下行, 连接数]"""
+    totals: Dict[str, List[int]] = {}
+    with open(path, "rb") as f:
+        if os.fstat(f.fileno()).st_size == 0:
+            return totals
+        with mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as mm:
+            for days, ids, ups, downs, conns, names in iter_blocks(mm, since, until):
+                for i in range(len(days)):
+                    if since <= days[i] <= until:
+                        t = totals.get(names[ids[i]])
+                        if t is None:
+                            t = totals[names[ids[i]]] = [0, 0, 0]
+                        t[0] += ups[i]
+                        t[1] += downs[i]
+                        t[2] += conns[i]
+    return totals
+
+
+class TrafficLedger:
+    """进程内的账本写者：内存聚合 + 定期追加 + 按需压缩"""
+
+    def __init__(self, path: str, flush_interval: float = FLUSH_INTERVAL):
+        self.path = path
+        self.flush_interval = flush_interval
+        self._lock = threading.Lock()
+        self._file_lock = threading.Lock()
+        self._pending: Dict[Tuple[int, str], List[int]] = {}
+        self._blocks = self._count_blocks()
+        self._stop = threading.Event()
+        # 有待落盘的记录 (落盘截止时间从第一条记录起算)
+        self._dirty = threading.Event()
+        self._thread = threading.Thread(target=self._loop, daemon=True)
+        self._thread.start()
+
+    def record(self, host: str, up: int, down: int):
+        key = (date.today().toordinal(), domain_suffix(host))
+        with self._lock:
+            if not self._pending:
+                self._dirty.set()
+            t = self._pending.get(key)
+            if t is None:
+                t = self._pending[key] = [0, 0, 0]
+            t[0] += up
+            t[1] += down
+            t[2] += 1
+
+    def flush(self):
+        with self._lock:
+            pending, self._pending = self._pending, {}
+        if not pending:
+            return
+        rows = [(day, name, t[0], t[1], t[2]) for (day, name), t in pending.items()]
+        try:
+            with self._file_lock:
+                self._append(encode_block(rows))
+                if self._blocks > COMPACT_BLOCKS:
+                    self._compact()
+        except Exception as e:
+            logger.warning(f"流量账本写入失败: {e}")
+
+    def close(self):
+        self._stop.set()
+        self._dirty.set()
+        self.flush()
+
+    def _loop(self):
+        while True:
+            self._dirty.wait()
+            if self._stop.wait(self.flush_interval):
+                break
+            self._dirty.clear()
+            self.flush()
+
+    def _count_blocks(self) -> int:
+        """统计已有追加块数；截掉上次写入中断留下的残块，保证后续追加可读
+
+        扫描与截断都在文件锁内：其他写者进程的追加 (单次 write) 与压缩替换也持有该锁，
+        不会把别人正在写入的块当成残块截掉。
+        """
+        try:
+            fd = self._open_locked(os.O_RDWR)
+        except OSError:
+            return 0
+        try:
+            with os.fdopen(os.dup(fd), "rb") as f:
+                data = f.read()
+            try:
+                blocks = scan_blocks(data)
+            except Exception:
+                return 0
+            # 只截掉末尾长度不完整的残块；中间 CRC 不符的块保留原位 (读取时跳过，下次压缩时丢弃)，
+            # 不能连带截掉其后完好的块。损坏块也计入追加块数，好让压缩尽快把它清理掉
+            count = sum(magic == _BLOCK_MAGIC for _, _, magic, _, _ in blocks)
+            valid_end = blocks[-1][1] + 4 if blocks else _FILE_HEADER.size
+            bad = sum(decode_block(data, offset, end) is None for offset, end, _, _, _ in blocks)
+            if bad:
+                logger.warning(f"流量账本有 {bad} 个数据块校验失败，读取时跳过")
+            if valid_end < len(data):
+                logger.warning(f"流量账本末尾有 {len(data) - valid_end} 字节残块，已截断")
+                try:
+                    os.ftruncate(fd, valid_end)
+                except OSError:
+                    pass
+            return count
+        finally:
+            os.close(fd)
+
+    def _open_locked(self, flags: int) -> int:
+        """打开并加锁；等锁期间文件被其他进程压缩替换时重新打开"""
+        while True:
+            fd = os.open(self.path, flags | getattr(os, "O_BINARY", 0), 0o600)
+            if not fcntl:
+                return fd
+            fcntl.flock(fd, fcntl.LOCK_EX)
+            try:
+                if os.fstat(fd).st_ino == os.stat(self.path).st_ino:
+                    return fd
+            except OSError:
+                pass
+            os.close(fd)
+
+    def _append(self, block: bytes):
+        os.makedirs(os.path.dirname(self.path), exist_ok=True)
+        fd = self._open_locked(os.O_RDWR | os.O_CREAT | os.O_APPEND)
+        try:
+            if os.fstat(fd).st_size == 0:
+                os.write(fd, _FILE_HEADER.pack(MAGIC, VERSION))
+            # 单次 write 追加整块，读者只会看到完整块或 CRC 不符的残块
+            os.write(fd, block)
+            self._blocks += 1
+        finally:
+            os.close(fd)
+
+    def _compact(self):
+        """追加块与本月整月块重新聚合为整月块，往月整月块原样拷贝，然后原子替换"""
+        t0 = time.perf_counter()
+        today = date.today()
+        month_start = today.replace(day=1).toordinal()
+        fd = self._open_locked(os.O_RDWR)
+        try:
+            with os.fdopen(os.dup(fd), "rb") as f:
+                data = f.read()
+            kept = []
+            merged: Dict[Tuple[int, str], List[int]] = {}
+            for offset, end, magic, _, day_max in scan_blocks(data):
+                if magic == _MONTH_MAGIC and day_max < month_start:
+                    kept.append(data[offset:end + 4])
+                    continue
+                block = decode_block(data, offset, end)
+                if block is None:
+                    # 损坏块无法恢复，压缩后不再保留；其后的块照常合并
+                    logger.warning(f"流量账本压缩时丢弃校验失败的数据块 (偏移 {offset})")
+                    continue
+                _merge(merged, block)
+
+            months: Dict[Tuple[int, int], list] = {}
+            for (day, name), t in sorted(merged.items()):
+                d = date.fromordinal(day)
+                months.setdefault((d.year, d.month), []).append((day, name, t[0], t[1], t[2]))
+
+            tmp = f"{self.path}.{os.getpid()}.tmp"
+            # 与账本本身一样只有本人可读 (替换后就是账本)；残留的旧临时文件可能权限更宽，先删掉
+            try:
+                os.unlink(tmp)
+            except OSError:
+                pass
+            out_fd = os.open(tmp, os.O_WRONLY | os.O_CREAT | os.O_EXCL | getattr(os, "O_BINARY", 0), 0o600)
+            with os.fdopen(out_fd, "wb") as out:
+                out.write(_FILE_HEADER.pack(MAGIC, VERSION))
+                for raw in kept:
+                    out.write(raw)
+                for rows in months.values():
+                    out.write(encode_block(rows, _MONTH_MAGIC))
+            os.replace(tmp, self.path)
+            self._blocks = 0
+        finally:
+            os.close(fd)
+        logger.debug(f"流量账本已压缩: 重新聚合 {len(merged)} 行，保留 {len(kept)} 个整月块，"
+                     f"{(time.perf_counter() - t0) * 1000:.0f} ms")
+
+
+_ledgers: Dict[str, TrafficLedger] = {}
+_ledgers_lock = threading.Lock()
+
+
+def get_ledger(path: str) -> Optional[TrafficLedger]:
+    """按路径取得进程内共享的账本 (多隧道 / 多出口写同一文件时只有一个写者)"""
+    if not path:
+        return None
+    key = os.path.abspath(path)
+    with _ledgers_lock:
+        ledger = _ledgers.get(key)
+        if ledger is None:
+            ledger = _ledgers[key] = TrafficLedger(key)
+        return ledger
+
+
+@atexit.register
+def _flush_all():
+    with _ledgers_lock:
+        ledgers = list(_ledgers.values())
+    for ledger in ledgers:
+        ledger.close()
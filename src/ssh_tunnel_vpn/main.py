@@ -27,9 +27,11 @@ import threading
 import time
 from datetime import datetime
 
-from .config import ServerConfig, load_config, save_config, load_window_geometry, save_window_geometry
+from .config import CONFIG_DIR, CONFIG_FILE, ServerConfig, load_config, load_profiles, save_config, load_window_geometry, save_window_geometry
+from .ledger import query as query_ledger
 from .proxy_settings import clear_system_proxy, set_system_proxy
-from .ssh_tunnel import SshTunnelManager
+from .stats_page import COUNTER, OPEN_BUCKET_PREFIX, StatsPageReader, histogram_quantile
+from .ssh_tunnel import SshTunnelManager, TunnelGroup
 
 logging.basicConfig(level=logging.INFO, format="%(asctime)s [%(levelname)s] %(message)s", datefmt="%H:%M:%S")
 logger = logging.getLogger(__name__)
@@ -81,6 +83,7 @@ class SSHTunnelApp:
         self.is_connected = False
         self.proxy_enabled = False
         self._stats_job = None
+        self._stats_last = None
         self._inputs_enabled = True
 
         self._build_ui()
@@ -787,6 +790,7 @@ class SSHTunnelApp:
 
     def _start_stats(self):
         self._stop_stats()
+        self._stats_last = None
         self._update_stats()
 
     def _stop_stats(self):
@@ -795,15 +799,30 @@ class SSHTunnelApp:
             self._stats_job = None
 
     def _update_stats(self):
+        self._stats_job = None
         if not self.is_connected:
             return
         stats = self.tunnel.get_stats()
+        key = _stats_key(stats)
+        if key == self._stats_last:
+            # 没有变化: 不再定时刷新，下一次转发活动时 (在转发线程里) 排回主循环
+            self.tunnel.activity.notify_next(lambda: self.root.after(0, self._resume_stats))
+            if _stats_key(self.tunnel.get_stats()) == key:
+                return
+        self._stats_last = key
         up_mb = stats["bytes_up"] / (1024 * 1024)
         down_mb = stats["bytes_down"] / (1024 * 1024)
         active = stats["active"]
-        self.stats_label.configure(text=f"↑ {up_mb:.1f} MB   ↓ {down_mb:.1f} MB   活跃连接: {active}")
+        text = f"↑ {up_mb:.1f} MB   ↓ {down_mb:.1f} MB   活跃连接: {active}"
+        if stats["tcp"]:
+            text += f"   {_fmt_tcp(stats['tcp'])}"
+        self.stats_label.configure(text=text)
         self._stats_job = self.root.after(3000, self._update_stats)
 
+    def _resume_stats(self):
+        if self._stats_job is None:
+            self._update_stats()
+
     def _append_log(self, msg: str):
         ts = datetime.now().strftime("%H:%M:%S")
         self.log_box.configure(state="normal")
@@ -895,6 +914,20 @@ class SSHTunnelCLI:
         jump_key_passphrase: str = "",
         set_proxy: bool = True,
         save: bool = True,
+        control_path: str = "",
+        exits=None,
+        sniff: bool = False,
+        remote_helper: bool = False,
+        tuning: str = "balanced",
+        placement: str = "",
+        stats_path: str = "",
+        ledger_path: str = "",
+        trace_path: str = "",
+        engine: str = "thread",
+        udp_transport: bool = False,
+        pool_size: int = 1,
+        tickless: bool = False,
+        drain_timeout: float = 0,
     ):
         self.host = host
         self.port = port
@@ -919,12 +952,27 @@ class SSHTunnelCLI:
 
         self.set_proxy = set_proxy
         self.save = save
+        self.control_path = control_path
+        self.exits = exits or []
+        self.sniff = sniff
+        self.remote_helper = remote_helper
+        self.tuning = tuning
+        self.placement = placement
+        self.stats_path = stats_path
+        self.ledger_path = ledger_path
+        self.trace_path = trace_path
+        self.engine = engine
+        self.udp_transport = udp_transport
+        self.pool_size = pool_size
+        self.tickless = tickless
+        self.drain_timeout = drain_timeout
 
         self.tunnel = SshTunnelManager()
         self.tunnel.on_log = self._on_log
         self.tunnel.on_status_changed = self._on_status
 
         self._running = threading.Event()
+        self._stopping = False
         self._proxy_set = False
 
     def start(self):
@@ -943,6 +991,28 @@ class SSHTunnelCLI:
         print(f"  SOCKS端口: 127.0.0.1:{self.socks_port}")
         print(f"  HTTP端口:  127.0.0.1:{self.http_port}")
         print(f"  系统代理:  {'自动设置' if self.set_proxy else '不设置'}")
+        print(f"  调优档位:  {self.tuning}")
+        print(f"  中继引擎:  {self.engine}")
+        if self.udp_transport:
+            print("  数据通道:  UDP (SSH 回退)")
+        if self.pool_size > 1:
+            print(f"  会话池:    1 ~ {self.pool_size} 条 (自动增减)")
+        if self.tickless:
+            print("  空闲唤醒:  tickless (TCP keepalive 代替 SSH 保活)")
+        if self.drain_timeout > 0:
+            print(f"  断开排空:  最多 {self.drain_timeout:g} 秒 (再按 Ctrl+C 立即断开)")
+        if self.placement:
+            print(f"  线程放置:  {self.placement}")
+        if self.stats_path:
+            print(f"  统计页:    {self.stats_path}")
+        if self.ledger_path:
+            print(f"  流量账本:  {self.ledger_path}")
+        if self.trace_path:
+            print(f"  轨迹采集:  {self.trace_path}")
+        if self.control_path:
+            print(f"  共享会话:  {self.control_path}")
+        for ex in self.exits:
+            print(f"  附加出口:  [{ex.name}] SOCKS {ex.socks_port} / HTTP {ex.http_port} → {ex.host}:{ex.port}")
         print(f"{'=' * 56}\n")
 
         if self.save:
@@ -967,6 +1037,18 @@ class SSHTunnelCLI:
                         socks_port=self.socks_port,
                         http_port=self.http_port,
                         auto_set_proxy=self.set_proxy,
+                        control_path=self.control_path,
+                        sniff=self.sniff,
+                        remote_helper=self.remote_helper,
+                        tuning=self.tuning,
+                        placement=self.placement,
+                        stats_path=self.stats_path,
+                        ledger_path=self.ledger_path,
+                        engine=self.engine,
+                        udp_transport=self.udp_transport,
+                        pool_size=self.pool_size,
+                        tickless=self.tickless,
+                        drain_timeout=self.drain_timeout,
                     )
                 )
                 logger.info("配置已保存")
@@ -992,11 +1074,30 @@ class SSHTunnelCLI:
                 jump_use_key=self.jump_use_key,
                 jump_key_path=self.jump_key_path,
                 jump_key_passphrase=self.jump_key_passphrase,
+                control_path=self.control_path,
+                sniff=self.sniff,
+                remote_helper=self.remote_helper,
+                tuning=self.tuning,
+                placement=self.placement,
+                stats_path=self.stats_path,
+                ledger_path=self.ledger_path,
+                trace_path=self.trace_path,
+                engine=self.engine,
+                udp_transport=self.udp_transport,
+                pool_size=self.pool_size,
+                tickless=self.tickless,
+                drain_timeout=self.drain_timeout,
             )
         except Exception as e:
             logger.error(f"连接失败: {e}")
             sys.exit(1)
 
+        for ex in self.exits:
+            try:
+                self.tunnel.add_exit(ex.name, ex)
+            except Exception as e:
+                logger.warning(f"附加出口不可用: {e}")
+
         if self.set_proxy:
             if set_system_proxy(self.http_port, self.socks_port):
                 self._proxy_set = True
@@ -1008,15 +1109,29 @@ class SSHTunnelCLI:
 
         self._running.set()
         try:
+            last = None
             while self._running.is_set():
-                time.sleep(5)
                 if self.tunnel.is_connected:
                     stats = self.tunnel.get_stats()
+                    key = _stats_key(stats)
+                    if key == last:
+                        # 没有变化: 等下一次转发活动 / 状态变化 / 退出信号，不定时唤醒
+                        token = self.tunnel.activity.arm()
+                        if self._running.is_set() and _stats_key(self.tunnel.get_stats()) == key:
+                            self.tunnel.activity.wait(token)
+                        continue
+                    last = key
                     up = stats["bytes_up"] / (1024 * 1024)
                     down = stats["bytes_down"] / (1024 * 1024)
                     active = stats["active"]
-                    sys.stdout.write(f"\r  ↑ {up:.1f} MB  ↓ {down:.1f} MB  活跃连接: {active}    ")
+                    line = f"\r  ↑ {up:.1f} MB  ↓ {down:.1f} MB  活跃连接: {active}"
+                    if stats["control_packets"] and stats["total"]:
+                        line += f"  控制报文/请求: {stats['control_packets'] / stats['total']:.1f}"
+                    if stats["tcp"]:
+                        line += f"  {_fmt_tcp(stats['tcp'])}"
+                    sys.stdout.write(line + "    ")
                     sys.stdout.flush()
+                    time.sleep(5)
                 else:
                     logger.warning("连接已断开")
                     break
@@ -1026,8 +1141,14 @@ class SSHTunnelCLI:
             self._cleanup()
 
     def _handle_signal(self, signum, frame):
+        if self._stopping:
+            # 排空期间再次收到信号: 不再等进行中的连接
+            self.tunnel.abort_drain()
+            return
+        self._stopping = True
         print("\n\n⏹  收到终止信号，正在断开...")
         self._running.clear()
+        self.tunnel.activity.poke()
 
     def _cleanup(self):
         if self._proxy_set:
@@ -1051,6 +1172,100 @@ class SSHTunnelCLI:
             logger.info(f"[已断开] {msg}")
 
 
+class SSHTunnelProfilesCLI:
+    """CLI 多隧道模式 — 同一进程内运行配置文件中的全部 profile"""
+
+    def __init__(self, profiles, set_proxy: bool = True):
+        self.profiles = profiles
+        self.set_proxy = set_proxy
+
+        self.group = TunnelGroup()
+        self.group.on_log = SSHTunnelCLI._on_log
+        self.group.on_status_changed = self._on_status
+
+        self._running = threading.Event()
+        self._stopping = False
+        self._proxy_set = False
+
+    def start(self):
+        signal.signal(signal.SIGINT, self._handle_signal)
+        signal.signal(signal.SIGTERM, self._handle_signal)
+
+        print(f"\n{'=' * 56}")
+        print(f"  SSH Tunnel VPN  — 多隧道模式 ({len(self.profiles)} 个)")
+        print(f"{'=' * 56}")
+        for p in self.profiles:
+            via = f" (经 {p.jump_host})" if p.use_jump else ""
+            print(f"  [{p.name}] {p.host}:{p.port}{via}  SOCKS {p.socks_port}  HTTP {p.http_port}")
+        print(f"{'=' * 56}\n")
+
+        try:
+            self.group.connect_all(self.profiles)
+        except Exception as e:
+            logger.error(f"连接失败: {e}")
+            sys.exit(1)
+
+        first = self.profiles[0]
+        if self.set_proxy:
+            if set_system_proxy(first.http_port, first.socks_port):
+                self._proxy_set = True
+                logger.info(f"系统代理 → [{first.name}] HTTP=127.0.0.1:{first.http_port}  SOCKS=127.0.0.1:{first.socks_port}")
+            else:
+                logger.warning("设置系统代理失败")
+
+        print("\n✅ 全部隧道已建立！按 Ctrl+C 断开\n")
+
+        self._running.set()
+        try:
+            last = None
+            while self._running.is_set():
+                if not self.group.is_connected:
+                    logger.warning("全部连接已断开")
+                    break
+                all_stats = self.group.get_stats()
+                key = tuple(_stats_key(st) for st in all_stats.values())
+                if key == last:
+                    token = self.group.activity.arm()
+                    if self._running.is_set() and \
+                            tuple(_stats_key(st) for st in self.group.get_stats().values()) == key:
+                        self.group.activity.wait(token)
+                    continue
+                last = key
+                parts = []
+                for name, stats in all_stats.items():
+                    up = stats["bytes_up"] / (1024 * 1024)
+                    down = stats["bytes_down"] / (1024 * 1024)
+                    parts.append(f"[{name}] ↑ {up:.1f} MB ↓ {down:.1f} MB 活跃 {stats['active']}")
+                sys.stdout.write("\r  " + "  ".join(parts) + "    ")
+                sys.stdout.flush()
+                time.sleep(5)
+        except KeyboardInterrupt:
+            pass
+        finally:
+            self._cleanup()
+
+    def _handle_signal(self, signum, frame):
+        if self._stopping:
+            self.group.abort_drain()
+            return
+        self._stopping = True
+        print("\n\n⏹  收到终止信号，正在断开...")
+        self._running.clear()
+        self.group.activity.poke()
+
+    def _cleanup(self):
+        if self._proxy_set:
+            clear_system_proxy()
+            self._proxy_set = False
+            logger.info("系统代理已清除")
+        self.group.disconnect_all()
+        print("\n🔌 已断开全部连接，再见！\n")
+
+    @staticmethod
+    def _on_status(name: str, status: str, msg: str):
+        SSHTunnelCLI._on_status(status, f"[{name}] {msg}")
+
+
 def _run_uninstall():
     """卸载：还原系统代理、删除配置文件、清理临时目录"""
     import winreg
@@ -1181,6 +1396,106 @@ def _remove_shortcuts():
             print(f"      已删除 {p}")
 
 
+def _fmt_bytes(n: float) -> str:
+    for unit in ("B", "KB", "MB", "GB"):
+        if n < 1024:
+            return f"{n:.1f} {unit}"
+        n /= 1024
+    return f"{n:.1f} TB"
+
+
+def _stats_key(stats: dict) -> tuple:
+    """刷新显示的依据: 这几项都没变时 CLI / GUI 不再定时刷新，等下一次转发活动"""
+    return stats["bytes_up"], stats["bytes_down"], stats["active"], stats["total"]
+
+
+def _fmt_tcp(tcp: dict) -> str:
+    """传输套接字 TCP_INFO 的一行摘要 (见 tcp_info.py)"""
+    text = f"RTT {tcp['rtt_ms']:.0f} ms  cwnd {tcp['cwnd']}"
+    if "retrans_per_s" in tcp:
+        text += f"  重传 {tcp['retrans_per_s']:.1f}/s"
+    if tcp["bottleneck"]:
+        text += f"  瓶颈: {tcp['bottleneck']}"
+    return text
+
+
+def _run_stats(path: str, watch: float):
+    """读取统计页并打印；watch > 0 时按间隔持续刷新并显示速率"""
+    try:
+        reader = StatsPageReader(path)
+    except Exception as e:
+        print(f"❌ 无法打开统计页 {path}: {e}")
+        sys.exit(1)
+
+    prev = None
+    try:
+        while True:
+            updated, values = reader.read()
+            age = time.time() - updated
+            lines = [f"统计页 {path}  (pid {reader.pid}，{age:.1f} 秒前更新)"]
+            for kind, name in reader.fields:
+                if kind == COUNTER and name.startswith("bytes_"):
+                    line = f"  {name:<20}{_fmt_bytes(values[name]):>14}"
+                    if prev:
+                        rate = (values[name] - prev[1][name]) / max(updated - prev[0], 1e-6)
+                        line += f"  {_fmt_bytes(max(rate, 0))}/s"
+                    lines.append(line)
+                elif not name.startswith(OPEN_BUCKET_PREFIX):
+                    lines.append(f"  {name:<20}{values[name]:>14}")
+            opened = sum(v for k, v in values.items() if k.startswith(OPEN_BUCKET_PREFIX))
+            if opened:
+                p50 = histogram_quantile(values, 0.5)
+                p99 = histogram_quantile(values, 0.99)
+                mean = values["open_us_sum"] / opened / 1000
+                lines.append(f"  通道建立耗时  均值 {mean:.1f} ms  p50 ≤{p50} ms  p99 ≤{p99} ms")
+            if values.get("control_packets") and values.get("connections_total"):
+                per_req = values["control_packets"] / values["connections_total"]
+                lines.append(f"  每请求控制报文  {per_req:.1f} 个 (OPEN + WINDOW_ADJUST + EOF/CLOSE，估算)")
+            if values.get("tcp_rtt_us"):
+                line = (f"  传输层  RTT {values['tcp_rtt_us'] / 1000:.1f} ms (最小 {values['tcp_min_rtt_us'] / 1000:.1f})"
+                        f"  cwnd {values['tcp_cwnd']}  投递速率 {_fmt_bytes(values['tcp_delivery_rate'])}/s")
+                if prev:
+                    busy = values["tcp_busy_us"] - prev[1].get("tcp_busy_us", 0)
+                    retrans = values["tcp_retrans"] - prev[1].get("tcp_retrans", 0)
+                    line += f"  重传 {retrans / max(updated - prev[0], 1e-6):.1f}/s"
+                    if busy > 0:
+                        rwnd = (values["tcp_rwnd_limited_us"] - prev[1].get("tcp_rwnd_limited_us", 0)) / busy
+                        sndbuf = (values["tcp_sndbuf_limited_us"] - prev[1].get("tcp_sndbuf_limited_us", 0)) / busy
+                        line += f"  受限: 接收窗口 {rwnd:.0%} 发送缓冲 {sndbuf:.0%}"
+                lines.append(line)
+            print("\n".join(lines))
+            if watch <= 0:
+                break
+            prev = (updated, values)
+            time.sleep(watch)
+            print()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        reader.close()
+
+
+def _run_report(path: str, days: int, top: int):
+    """按目标域名汇总最近 days 天的流量，打印前 top 名"""
+    today = datetime.now().date().toordinal()
+    t0 = time.perf_counter()
+    try:
+        totals = query_ledger(path, since=today - days + 1, until=today)
+    except FileNotFoundError:
+        print(f"❌ 流量账本不存在: {path}")
+        sys.exit(1)
+    except Exception as e:
+        print(f"❌ 无法读取流量账本 {path}: {e}")
+        sys.exit(1)
+    elapsed = (time.perf_counter() - t0) * 1000
+
+    rows = sorted(totals.items(), key=lambda kv: kv[1][0] + kv[1][1], reverse=True)
+    print(f"最近 {days} 天流量前 {min(top, len(rows))} 名 (共 {len(rows)} 个目标，查询 {elapsed:.1f} ms)")
+    print(f"  {'目标':<36}{'下行':>12}{'上行':>12}{'连接数':>10}")
+    for name, (up, down, conns) in rows[:top]:
+        print(f"  {name:<36}{_fmt_bytes(down):>12}{_fmt_bytes(up):>12}{conns:>10}")
+
+
 def main():
     parser = argparse.ArgumentParser(
         description="SSH Tunnel VPN — 安全加密隧道",
@@ -1193,6 +1508,15 @@ def main():
     sub.add_parser("install", help="创建桌面和开始菜单快捷方式")
     sub.add_parser("uninstall", help="卸载：清理配置、还原系统代理、删除快捷方式")
 
+    stats_p = sub.add_parser("stats", help="读取运行中隧道的统计页")
+    stats_p.add_argument("path", nargs="?", default=None, help="统计页文件 (默认取配置中的 stats_path)")
+    stats_p.add_argument("-w", "--watch", type=float, default=0, metavar="SEC", help="按间隔持续刷新 (秒)")
+
+    report_p = sub.add_parser("report", help="按目标域名汇总流量账本")
+    report_p.add_argument("path", nargs="?", default=None, help="流量账本文件 (默认取配置中的 ledger_path)")
+    report_p.add_argument("--days", type=int, default=7, help="统计最近几天 (默认 7)")
+    report_p.add_argument("--top", type=int, default=20, help="显示前几名 (默认 20)")
+
     cli_p = sub.add_parser("cli", help="命令行模式")
     cli_p.add_argument("-H", "--host", type=str, default=None, help="服务器 IP / 域名")
     cli_p.add_argument("-P", "--port", type=int, default=22, help="SSH 端口 (默认 22)")
@@ -1213,6 +1537,37 @@ def main():
     cli_p.add_argument("--proxy", dest="proxy", action="store_true", default=True, help="自动设置系统代理 (默认)")
     cli_p.add_argument("--no-proxy", dest="proxy", action="store_false", help="不设置系统代理")
     cli_p.add_argument("--no-save", dest="save_cfg", action="store_false", default=True, help="不保存配置")
+    cli_p.add_argument("--all-profiles", action="store_true", default=False,
+                       help="同时运行配置文件 profiles 列表中的全部隧道 (共用一个进程)")
+    cli_p.add_argument("--exit", dest="exits", action="append", default=[], metavar="NAME",
+                       help="附加出口: 按名称引用配置文件 profiles 中的服务器及其 SOCKS/HTTP 端口 (可重复)")
+    cli_p.add_argument("--sniff", dest="sniff", action="store_true", default=None,
+                       help="以 IP 发起的连接按 TLS SNI / HTTP Host 改用域名，由服务器端解析")
+    cli_p.add_argument("--remote-helper", dest="remote_helper", action="store_true", default=None,
+                       help="在服务器上启动伴随进程代为建连 (DNS 缓存 + Happy Eyeballs，需服务器有 python3)")
+    cli_p.add_argument("--udp", dest="udp_transport", action="store_true", default=None,
+                       help="连接数据改走伴随进程的加密 UDP 通道 (隐含 --remote-helper，UDP 不通时回退 SSH)")
+    cli_p.add_argument("--pool", dest="pool_size", type=int, default=None, metavar="N",
+                       help="SSH 会话池上限: >1 时按吞吐 / 重传自动增开会话，空闲后排空关闭 (默认 1，不启用)")
+    cli_p.add_argument("--tickless", dest="tickless", action="store_true", default=None,
+                       help="空闲零唤醒: SSH 传输线程不再每 0.1 秒轮询，保活改用内核 TCP keepalive")
+    cli_p.add_argument("--drain", dest="drain_timeout", type=float, default=None, metavar="SECONDS",
+                       help="断开 / 重连前先排空: 停止接受新连接，进行中的连接最多再转发 SECONDS 秒 (默认 0，立即断开)")
+    cli_p.add_argument("--tuning", choices=["latency", "balanced", "bulk"], default=None,
+                       help="套接字调优档位: latency 交互低延迟 / balanced 系统默认套接字选项 (默认) / bulk 大流量吞吐")
+    cli_p.add_argument("--engine", choices=["thread", "asyncio"], default=None,
+                       help="本地中继引擎: thread 每连接一个线程 (默认) / asyncio 单事件循环服务全部连接")
+    cli_p.add_argument("--placement", type=str, default=None,
+                       help="CPU 绑核 (Linux): CPU 列表如 0-3 / node:N / nic:网卡 / irq:网卡 / auto")
+    cli_p.add_argument("--stats-file", dest="stats_path", type=str, default=None,
+                       help="把计数器与通道建立耗时直方图发布到该内存映射文件，供 stats 命令等外部进程读取")
+    cli_p.add_argument("--ledger", dest="ledger_path", type=str, default=None, nargs="?",
+                       const=str(CONFIG_DIR / "ledger.bin"),
+                       help=f"按目标域名 / 按天记录流量到账本文件 (不带路径时为 {CONFIG_DIR / 'ledger.bin'})")
+    cli_p.add_argument("--trace", dest="trace_path", type=str, default=None, metavar="PATH",
+                       help="采集每条连接的匿名时间线 (JSONL)，供 benchmarks/bench_replay.py 回放；不保存到配置")
+    cli_p.add_argument("--control", type=str, default=None,
+                       help="共享会话控制地址 (Unix 套接字路径或 127.0.0.1:端口)，已有主实例时直接复用其 SSH 会话")
 
     args = parser.parse_args()
 
@@ -1232,6 +1587,27 @@ def main():
         _run_uninstall()
         return
 
+    if args.mode == "stats":
+        path = args.path or load_config().stats_path
+        if not path:
+            print("❌ 错误: 请指定统计页文件 (或在配置中设置 stats_path)")
+            sys.exit(1)
+        _run_stats(path, args.watch)
+        return
+
+    if args.mode == "report":
+        path = args.path or load_config().ledger_path or str(CONFIG_DIR / "ledger.bin")
+        _run_report(path, max(args.days, 1), args.top)
+        return
+
+    if args.all_profiles:
+        profiles = load_profiles()
+        if not profiles:
+            print(f"❌ 错误: 配置文件中没有 profiles 列表: {CONFIG_FILE}")
+            sys.exit(1)
+        SSHTunnelProfilesCLI(profiles, set_proxy=args.proxy).start()
+        return
+
     saved = load_config()
 
     host = args.host or saved.host
@@ -1275,6 +1651,15 @@ def main():
         print("❌ 错误: CLI 模式需要提供 --host 和 --user (或已保存过配置)")
         sys.exit(1)
 
+    exits = []
+    if args.exits:
+        by_name = {p.name: p for p in load_profiles()}
+        for name in args.exits:
+            if name not in by_name:
+                print(f"❌ 错误: 配置文件 profiles 中没有名为 {name} 的出口")
+                sys.exit(1)
+            exits.append(by_name[name])
+
     if not use_key and not pwd:
         print("❌ 错误: 请提供 --password 或 --key")
         sys.exit(1)
@@ -1299,6 +1684,20 @@ def main():
         jump_key_passphrase=jump_key_pass or "",
         set_proxy=args.proxy,
         save=args.save_cfg,
+        control_path=args.control if args.control is not None else saved.control_path,
+        exits=exits,
+        sniff=args.sniff if args.sniff is not None else saved.sniff,
+        remote_helper=args.remote_helper if args.remote_helper is not None else saved.remote_helper,
+        tuning=args.tuning or saved.tuning,
+        placement=args.placement if args.placement is not None else saved.placement,
+        stats_path=args.stats_path if args.stats_path is not None else saved.stats_path,
+        ledger_path=args.ledger_path if args.ledger_path is not None else saved.ledger_path,
+        trace_path=args.trace_path or "",
+        engine=args.engine or saved.engine,
+        udp_transport=args.udp_transport if args.udp_transport is not None else saved.udp_transport,
+        pool_size=args.pool_size if args.pool_size is not None else saved.pool_size,
+        tickless=args.tickless if args.tickless is not None else saved.tickless,
+        drain_timeout=args.drain_timeout if args.drain_timeout is not None else saved.drain_timeout,
     )
     cli.start()
 
@@ -0,0 +1,164 @@
+"""
+CPU 亲和性 / NUMA 感知的线程放置 (Linux)
+
+多路服务器上不绑核时，中继线程与 SSH 传输线程 (加解密) 在不同 CPU 插槽间迁移，
+缓存行来回失效。放置规格决定一组 CPU:
+  - 0-3,8         显式 CPU 列表
+  - node:N        NUMA 节点 N 的全部 CPU
+  - nic:IFACE     网卡 IFACE 所在 NUMA 节点的 CPU (local_cpulist)
+  - irq:IFACE     网卡 IFACE 各收发队列中断所绑定的 CPU
+  - auto          默认路由网卡的 local_cpulist，读不到时退回其中断 CPU
+
+多于一个 CPU 时，首个 CPU 留给 SSH 传输线程，其余按连接轮转分给中继线程；
+中继缓冲在绑核之后才首次分配，按内核的 first-touch 策略落在本地 NUMA 节点。
+结果与进程允许的 CPU (sched_getaffinity) 取交集；非 Linux 平台不支持。
+"""
+import logging
+import os
+import threading
+from pathlib import Path
+from typing import List, Optional
+
+logger = logging.getLogger(__name__)
+
+SUPPORTED = hasattr(os, "sched_setaffinity")
+
+
+def parse_cpu_list(text: str) -> List[int]:
+    """解析内核 cpulist 格式，如 "0-3,8,10-11" """
+    cpus = set()
+    for part in text.strip().split(","):
+        part = part.strip()
+        if not part:
+            continue
+        lo, sep, hi = part.partition("-")
+        if not lo.isdigit() or (sep and not hi.isdigit()):
+            raise ValueError(f"无效的 CPU 列表: {text}")
+        cpus.update(range(int(lo), int(hi) + 1) if sep else (int(lo),))
+    return sorted(cpus)
+
+
+def _read_cpu_list(path: Path) -> List[int]:
+    try:
+        return parse_cpu_list(path.read_text())
+    except (OSError, ValueError):
+        return []
+
+
+def node_cpus(node: int) -> List[int]:
+    return _read_cpu_list(Path(f"/sys/devices/system/node/node{node}/cpulist"))
+
+
+def nic_cpus(iface: str) -> List[int]:
+    return _read_cpu_list(Path(f"/sys/class/net/{iface}/device/local_cpulist"))
+
+
+def irq_cpus(iface: str) -> List[int]:
+    """网卡中断 (名称含 IFACE，如 eth0-TxRx-0) 实际生效的 CPU"""
+    cpus = set()
+    try:
+        lines = Path("/proc/interrupts").read_text().splitlines()[1:]
+    except OSError:
+        return []
+    for line in lines:
+        irq, sep, rest = line.partition(":")
+        irq = irq.strip()
+        names = rest.split()
+        if not sep or not irq.isdigit() or not any(n == iface or n.startswith(iface + "-") for n in names):
+            continue
+        for name in ("effective_affinity_list", "smp_affinity_list"):
+            found = _read_cpu_list(Path(f"/proc/irq/{irq}/{name}"))
+            if found:
+                cpus.update(found)
+                break
+    return sorted(cpus)
+
+
+def default_route_iface() -> str:
+    try:
+        lines = Path("/proc/net/route").read_text().splitlines()[1:]
+    except OSError:
+        return ""
+    for line in lines:
+        fields = line.split()
+        if len(fields) > 1 and fields[1] == "00000000":
+            return fields[0]
+    return ""
+
+
+class Placement:
+    """按放置规格绑核：传输线程独占首个 CPU，中继线程轮转其余 CPU"""
+
+    def __init__(self, spec: str, cpus: List[int]):
+        self.spec = spec
+        self.cpus = cpus
+        self.transport_cpu = cpus[0]
+        self.worker_cpus = cpus[1:] or cpus
+        self._lock = threading.Lock()
+        self._next = 0
+
+    def describe(self) -> str:
+        workers = ",".join(str(c) for c in self.worker_cpus)
+        return f"{self.spec}: 传输线程 CPU {self.transport_cpu}，中继线程 CPU {workers}"
+
+    def pin_transport(self, transport) -> bool:
+        """把 paramiko.Transport 的收发线程绑到传输 CPU (须在线程启动后调用)"""
+        tid = getattr(transport, "native_id", None)
+        if not tid:
+            return False
+        try:
+            os.sched_setaffinity(tid, {self.transport_cpu})
+            return True
+        except OSError as e:
+            logger.debug(f"传输线程绑核失败: {e}")
+            return False
+
+    def pin_listener(self):
+        """监听线程绑到全部中继 CPU，新建的连接线程继承该亲和性"""
+        try:
+            os.sched_setaffinity(0, set(self.worker_cpus))
+        except OSError as e:
+            logger.debug(f"监听线程绑核失败: {e}")
+
+    def pin_worker(self):
+        """当前 (连接) 线程绑到下一个中继 CPU"""
+        with self._lock:
+            cpu = self.worker_cpus[self._next % len(self.worker_cpus)]
+            self._next += 1
+        try:
+            os.sched_setaffinity(0, {cpu})
+        except OSError as e:
+            logger.debug(f"中继线程绑核失败: {e}")
+
+
+def get_placement(spec: Optional[str]) -> Optional[Placement]:
+    """解析放置规格；空规格返回 None (不绑核)，规格无效或无可用 CPU 时抛出异常"""
+    spec = (spec or "").strip()
+    if not spec:
+        return None
+    if not SUPPORTED:
+        raise Exception("当前平台不支持 CPU 绑核 (仅 Linux)")
+
+    kind, sep, arg = spec.partition(":")
+    if spec == "auto":
+        iface = default_route_iface()
+        cpus = (nic_cpus(iface) or irq_cpus(iface)) if iface else []
+        if not cpus:
+            raise Exception("auto: 无法确定默认路由网卡的本地 CPU，请改用 node:N 或 CPU 列表")
+    elif sep and kind == "node" and arg.isdigit():
+        cpus = node_cpus(int(arg))
+    elif sep and kind == "nic":
+        cpus = nic_cpus(arg)
+    elif sep and kind == "irq":
+        cpus = irq_cpus(arg)
+    else:
+        try:
+            cpus = parse_cpu_list(spec)
+        except ValueError:
+            raise Exception(f"无效的放置规格: {spec} (可选: CPU 列表 / node:N / nic:网卡 / irq:网卡 / auto)")
+
+    allowed = os.sched_getaffinity(0)
+    cpus = [c for c in cpus if c in allowed]
+    if not cpus:
+        raise Exception(f"放置规格 {spec} 没有本进程可用的 CPU")
+    return Placement(spec, cpus)
@@ -0,0 +1,336 @@
+"""
+远端伴随进程 (在 SSH 服务器上运行，仅依赖 Python 3 标准库)
+
+由客户端经 exec 通道以 `python3 -c ...` 启动，替代 sshd 自身处理 direct-tcpip 连接：
+  - 进程内 DNS 缓存，同一域名不再每次阻塞 getaddrinfo
+  - Happy Eyeballs (RFC 8305)：A/AAAA 地址交错排列并错峰竞速连接，坏掉的 IPv6 不再拖慢连接
+  - 只有单个候选地址时启用 TCP Fast Open (Linux TCP_FASTOPEN_CONNECT)
+  - 中继两端都是本地套接字，Linux 上用 splice(2) 在内核内转发
+
+启动后在远端 127.0.0.1 的随机端口监听，并在 stdout 打印一行 "PORT <端口> <口令 hex>"。
+口令每次启动随机生成，只经 exec 通道 (SSH 加密) 交给客户端：服务器上的其他用户也能连到
+该端口，不带口令的连接一律拒绝，否则等于绕过 sshd 的 AllowTcpForwarding / PermitOpen 开放中继。
+客户端经 direct-tcpip 连到该端口，每条连接:
+  客户端 → 伴随进程:  b"CONNECT <口令> <host> <port>\\n"
+  伴随进程 → 客户端:  b"OK\\n" 或 b"ERR <原因>\\n"，OK 之后透传原始字节
+带 --udp 参数时另开一个 UDP 端口 (datagram.py)，再打印一行 "UDP <端口> <会话密钥 hex>"
+(失败时为 "UDPERR <原因>")；UDP 上的每条流与上面的连接走同样的 CONNECT 协议。
+stdin 关闭 (exec 通道关闭 / SSH 会话断开) 时进程退出。
+"""
+import errno
+import hmac
+import os
+import select
+import socket
+import sys
+import threading
+import time
+
+DNS_TTL = 60.0
+DNS_MAX_ENTRIES = 4096
+# RFC 8305 推荐的 Connection Attempt Delay
+ATTEMPT_DELAY = 0.25
+CONNECT_TIMEOUT = 10.0
+MAX_HEADER = 512
+# 请求头须在这么多秒内发完，防止空连接一直占住处理线程
+HEADER_TIMEOUT = 10.0
+# Linux: include/uapi/linux/tcp.h
+TCP_FASTOPEN_CONNECT = 30
+_IN_PROGRESS = (0, errno.EINPROGRESS, errno.EWOULDBLOCK, errno.EAGAIN, 10035)  # 10035: WSAEWOULDBLOCK
+_SPLICE_UNSUPPORTED = (errno.EINVAL, errno.ENOSYS, errno.EOPNOTSUPP)
+
+
+class DnsCache:
+    """按主机名缓存解析结果，TTL 到期后重新解析"""
+
+    def __init__(self, ttl: float = DNS_TTL):
+        self.ttl = ttl
+        self._lock = threading.Lock()
+        self._entries = {}
+        self.hits = 0
+        self.misses = 0
+
+    def resolve(self, host: str, port: int) -> list:
+        now = time.monotonic()
+        with self._lock:
+            entry = self._entries.get(host)
+            if entry and entry[0] > now:
+                self.hits += 1
+                return [(family, addr[:1] + (port,) + addr[2:]) for family, addr in entry[1]]
+            self.misses += 1
+
+        infos = socket.getaddrinfo(host, port, 0, socket.SOCK_STREAM, socket.IPPROTO_TCP)
+        addrs = _interleave([(info[0], info[4]) for info in infos])
+        with self._lock:
+            if len(self._entries) >= DNS_MAX_ENTRIES:
+                self._entries.clear()
+            self._entries[host] = (now + self.ttl, addrs)
+        return addrs
+
+
+def _interleave(addrs: list) -> list:
+    """RFC 8305 §4: 去重后按地址族交错排列，以首个结果的地址族开头"""
+    seen = set()
+    unique = []
+    for family, addr in addrs:
+        if addr[:2] not in seen:
+            seen.add(addr[:2])
+            unique.append((family, addr))
+    if not unique:
+        return unique
+    first = unique[0][0]
+    primary = [a for a in unique if a[0] == first]
+    secondary = [a for a in unique if a[0] != first]
+    result = []
+    for i in range(max(len(primary), len(secondary))):
+        if i < len(primary):
+            result.append(primary[i])
+        if i < len(secondary):
+            result.append(secondary[i])
+    return result
+
+
+def happy_eyeballs_connect(addrs: list, timeout: float = CONNECT_TIMEOUT) -> socket.socket:
+    """按顺序错峰发起连接，第一个成功的胜出，其余关闭"""
+    if not addrs:
+        raise OSError("no address")
+
+    if len(addrs) == 1 and sys.platform.startswith("linux"):
+        family, addr = addrs[0]
+        sock = socket.socket(family, socket.SOCK_STREAM)
+        try:
+            sock.setsockopt(socket.IPPROTO_TCP, TCP_FASTOPEN_CONNECT, 1)
+        except OSError:
+            pass
+        sock.settimeout(timeout)
+        try:
+            sock.connect(addr)
+        except Exception:
+            sock.close()
+            raise
+        sock.settimeout(None)
+        return sock
+
+    deadline = time.monotonic() + timeout
+    pending = {}
+    queue = list(addrs)
+    next_start = 0.0
+    last_error = None
+    try:
+        while True:
+            now = time.monotonic()
+            if queue and (now >= next_start or not pending):
+                family, addr = queue.pop(0)
+                sock = socket.socket(family, socket.SOCK_STREAM)
+                sock.setblocking(False)
+                err = sock.connect_ex(addr)
+                if err in _IN_PROGRESS:
+                    pending[sock] = addr
+                    next_start = now + ATTEMPT_DELAY
+                else:
+                    last_error = OSError(err, os.strerror(err))
+                    sock.close()
+                continue
+            if not pending:
+                raise last_error or OSError("connect failed")
+            if now >= deadline:
+                raise socket.timeout("connect timed out")
+
+            wait = deadline - now
+            if queue:
+                wait = min(wait, max(0.0, next_start - now))
+            _, writable, _ = select.select([], list(pending), [], wait)
+            for sock in writable:
+                err = sock.getsockopt(socket.SOL_SOCKET, socket.SO_ERROR)
+                pending.pop(sock)
+                if err == 0:
+                    sock.setblocking(True)
+                    return sock
+                last_error = OSError(err, os.strerror(err))
+                sock.close()
+                # 失败后立即尝试下一个地址
+                next_start = 0.0
+    finally:
+        for sock in pending:
+            sock.close()
+
+
+def _read_header(sock: socket.socket) -> tuple:
+    """读取请求头，返回 (头部行, 换行之后已读到的数据)"""
+    data = b""
+    while b"\n" not in data:
+        if len(data) >= MAX_HEADER:
+            raise OSError("header too long")
+        chunk = sock.recv(MAX_HEADER)
+        if not chunk:
+            break
+        data += chunk
+    line, _, rest = data.partition(b"\n")
+    return line.rstrip(b"\r"), rest
+
+
+def _splice_relay(a: socket.socket, b: socket.socket) -> bool:
+    """splice(2) 经管道在内核内转发；首次调用即不支持时返回 False，调用方回退为用户态中继
+
+    管道 → 目标端不被支持时，已进管道的数据先用 os.read + sendall 写出，不会丢失。
+    """
+    if not (sys.platform.startswith("linux") and hasattr(os, "splice")):
+        return False
+    pipes = {a: os.pipe(), b: os.pipe()}
+    started = False
+    try:
+        while True:
+            r, _, _ = select.select([a, b], [], [])
+            for src in r:
+                dst = b if src is a else a
+                pr, pw = pipes[src]
+                try:
+                    n = os.splice(src.fileno(), pw, 65536, flags=os.SPLICE_F_MOVE | os.SPLICE_F_NONBLOCK)
+                except BlockingIOError:
+                    continue
+                if not n:
+                    return True
+                try:
+                    while n:
+                        n -= os.splice(pr, dst.fileno(), n, flags=os.SPLICE_F_MOVE)
+                except OSError as e:
+                    if e.errno not in _SPLICE_UNSUPPORTED:
+                        raise
+                    while n:
+                        data = os.read(pr, n)
+                        dst.sendall(data)
+                        n -= len(data)
+                    raise
+                # 管道 → 目标端至少成功过一次之后才算内核路径可用
+                started = True
+    except OSError as e:
+        return started or e.errno not in _SPLICE_UNSUPPORTED
+    finally:
+        for fds in pipes.values():
+            os.close(fds[0])
+            os.close(fds[1])
+
+
+def _relay(a: socket.socket, b: socket.socket):
+    try:
+        if _splice_relay(a, b):
+            return
+        while True:
+            r, _, _ = select.select([a, b], [], [])
+            if a in r:
+                data = a.recv(65536)
+                if not data:
+                    break
+                b.sendall(data)
+            if b in r:
+                data = b.recv(65536)
+                if not data:
+                    break
+                a.sendall(data)
+    except OSError:
+        pass
+    finally:
+        a.close()
+        b.close()
+
+
+def _handle(conn: socket.socket, cache: DnsCache, token: str):
+    try:
+        conn.settimeout(HEADER_TIMEOUT)
+        header, rest = _read_header(conn)
+        conn.settimeout(None)
+        parts = header.decode("utf-8", "replace").split()
+        if len(parts) != 4 or parts[0] != "CONNECT" or \
+                not hmac.compare_digest(parts[1].encode("utf-8"), token.encode("ascii")):
+            conn.sendall(b"ERR auth\n")
+            conn.close()
+            return
+        # isdigit() 也认 "²" 之类的 Unicode 数字，须同时限定 ASCII
+        port = int(parts[3]) if parts[3].isascii() and parts[3].isdigit() else 0
+        if not 0 < port < 65536:
+            conn.sendall(b"ERR bad request\n")
+            conn.close()
+            return
+        host = parts[2]
+        try:
+            remote = happy_eyeballs_connect(cache.resolve(host, port))
+        except Exception as e:
+            conn.sendall(f"ERR {e}\n".encode("utf-8", "replace"))
+            conn.close()
+            return
+        remote.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        conn.sendall(b"OK\n")
+        if rest:
+            remote.sendall(rest)
+        _relay(conn, remote)
+    except (OSError, ValueError):
+        conn.close()
+
+
+def _watch_stdin():
+    try:
+        while sys.stdin.buffer.read(4096):
+            pass
+    finally:
+        os._exit(0)
+
+
+def _load_datagram():
+    """datagram.py: 经 exec 通道启动时客户端已预先放进 sys.modules，本地运行时在同一目录"""
+    try:
+        from . import datagram
+    except ImportError:
+        import datagram
+    return datagram
+
+
+def start_datagram(cache: DnsCache, token: str, bind_port: int = 0) -> str:
+    """开启 UDP 数据通道，返回要打印给客户端的一行"""
+    try:
+        datagram = _load_datagram()
+        try:
+            # 双栈: 客户端经 IPv4 或 IPv6 连来都能收到
+            sock = socket.socket(socket.AF_INET6, socket.SOCK_DGRAM)
+            sock.setsockopt(socket.IPPROTO_IPV6, socket.IPV6_V6ONLY, 0)
+            sock.bind(("::", bind_port))
+        except (OSError, AttributeError):
+            sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+            sock.bind(("0.0.0.0", bind_port))
+        secret = os.urandom(32)
+
+        def on_stream(conn):
+            threading.Thread(target=_handle, args=(conn, cache, token), daemon=True).start()
+
+        datagram.DatagramSession(sock, secret, client=False, on_stream=on_stream).start()
+    except Exception as e:
+        return f"UDPERR {e}\n"
+    return f"UDP {sock.getsockname()[1]} {secret.hex()}\n"
+
+
+def main(bind_host: str = "127.0.0.1", bind_port: int = 0, udp: bool = False):
+    server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server.bind((bind_host, bind_port))
+    server.listen(512)
+    cache = DnsCache()
+    token = os.urandom(16).hex()
+    sys.stdout.write(f"PORT {server.getsockname()[1]} {token}\n")
+    if udp:
+        sys.stdout.write(start_datagram(cache, token))
+    sys.stdout.flush()
+
+    threading.Thread(target=_watch_stdin, daemon=True).start()
+    serve(server, cache, token)
+
+
+def serve(server: socket.socket, cache: DnsCache, token: str):
+    while True:
+        conn, _ = server.accept()
+        threading.Thread(target=_handle, args=(conn, cache, token), daemon=True).start()
+
+
+if __name__ == "__main__":
+    # 可选参数: 监听端口 (默认随机，本地替身测试时使用)；--udp 开启 UDP 数据通道
+    args = sys.argv[1:]
+    ports = [a for a in args if a.isdigit()]
+    main(bind_port=int(ports[0]) if ports else 0, udp="--udp" in args)
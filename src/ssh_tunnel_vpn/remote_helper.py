@@ -0,0 +1,232 @@
+"""
+远端伴随进程的客户端 — 经 exec 通道启动 remote_agent.py，并由它代为建立出站连接
+
+RemoteHelper 提供与 paramiko.Transport 相同的 open_channel() 接口，可直接交给
+Socks5Server / ControlMasterServer 使用：
+  - 预先打开若干条到伴随进程的空闲通道，新连接取用时省去通道建立的往返
+  - 伴随进程带 DNS 缓存与 Happy Eyeballs，远端建连比 sshd 的串行 getaddrinfo + connect 更快
+  - 伴随进程不可用 (服务器无 python3、进程退出等) 时自动回退为 sshd 的 direct-tcpip
+  - 指定 udp_host 时另开 UDP 数据通道 (datagram.py)：新连接优先走 UDP 上的独立流，
+    丢包只影响所在的流；UDP 不通或中断时回退到上面的 SSH 通道
+"""
+import base64
+import logging
+import threading
+import time
+import zlib
+from collections import deque
+from pathlib import Path
+from typing import Optional
+
+import paramiko
+
+from .datagram import DatagramSession
+
+logger = logging.getLogger(__name__)
+
+_AGENT_SOURCE = Path(__file__).with_name("remote_agent.py")
+_DATAGRAM_SOURCE = Path(__file__).with_name("datagram.py")
+_MAX_HEADER = 512
+
+
+def _pack(path: Path) -> str:
+    return base64.b64encode(zlib.compress(path.read_bytes(), 9)).decode("ascii")
+
+
+def _agent_command(udp: bool = False) -> str:
+    code = _pack(_AGENT_SOURCE)
+    if not udp:
+        return f'python3 -c "import base64,zlib;exec(zlib.decompress(base64.b64decode(\'{code}\')))"'
+    # 先把 datagram.py 放进 sys.modules，伴随进程里 import datagram 直接取到
+    dgram = _pack(_DATAGRAM_SOURCE)
+    return ('python3 -c "import base64,sys,types,zlib;m=types.ModuleType(\'datagram\');'
+            f"exec(zlib.decompress(base64.b64decode('{dgram}')),m.__dict__);sys.modules['datagram']=m;"
+            f'exec(zlib.decompress(base64.b64decode(\'{code}\')))" --udp')
+
+
+def _read_line(channel: paramiko.Channel) -> bytes:
+    data = b""
+    while not data.endswith(b"\n"):
+        if len(data) >= _MAX_HEADER:
+            raise Exception("伴随进程响应过长")
+        ch = channel.recv(1)
+        if not ch:
+            break
+        data += ch
+    return data.rstrip(b"\r\n")
+
+
+class RemoteHelper:
+    """远端伴随进程客户端，替代 Transport.open_channel 建立 direct-tcpip 连接"""
+
+    # 预热的空闲通道数
+    WARM_CHANNELS = 4
+
+    def __init__(self, transport: paramiko.Transport, udp_host: str = ""):
+        self.transport = transport
+        self.udp_host = udp_host
+        self.datagram: Optional[DatagramSession] = None
+        self.udp_error = ""
+        self.agent_port = 0
+        # 伴随进程每次启动生成的口令，每条连接的 CONNECT 行都要带上 (见 remote_agent.py)
+        self._token = ""
+        self._exec: Optional[paramiko.Channel] = None
+        self._warm = deque()
+        self._warm_lock = threading.Lock()
+        self._refill = threading.Event()
+        self._running = False
+        self._thread: Optional[threading.Thread] = None
+
+        self.helper_opens = 0
+        self.fallback_opens = 0
+        self.udp_opens = 0
+
+    def start(self, timeout: float = 10):
+        """启动伴随进程并等待其报告监听端口；失败抛出异常"""
+        chan = self.transport.open_session(timeout=timeout)
+        chan.settimeout(timeout)
+        chan.exec_command(_agent_command(bool(self.udp_host)))
+        try:
+            line = _read_line(chan).decode("utf-8", errors="replace").split()
+        except Exception as e:
+            chan.close()
+            raise Exception(f"伴随进程启动超时: {e}")
+        if len(line) != 3 or line[0] != "PORT" or not line[1].isdigit():
+            err = b""
+            try:
+                while chan.recv_stderr_ready():
+                    err += chan.recv_stderr(4096)
+            except Exception:
+                pass
+            chan.close()
+            raise Exception(f"伴随进程启动失败: {err.decode('utf-8', errors='replace').strip() or line}")
+
+        self._exec = chan
+        self.agent_port = int(line[1])
+        self._token = line[2]
+        if self.udp_host:
+            try:
+                self._start_datagram(chan, timeout)
+            except Exception as e:
+                self.udp_error = str(e)
+                logger.info(f"UDP 数据通道不可用，数据走 SSH: {e}")
+        self._running = True
+        self._thread = threading.Thread(target=self._refill_loop, daemon=True)
+        self._thread.start()
+        self._refill.set()
+        logger.info(f"远端伴随进程已启动: 127.0.0.1:{self.agent_port}")
+
+    def _start_datagram(self, chan: paramiko.Channel, timeout: float):
+        """读取伴随进程下发的 UDP 端口与会话密钥 (经 SSH 加密传输)，握手后启用"""
+        line = _read_line(chan).decode("utf-8", errors="replace").split()
+        if len(line) != 3 or line[0] != "UDP" or not line[1].isdigit():
+            raise Exception(" ".join(line[1:]) if line and line[0] == "UDPERR" else f"伴随进程响应异常: {line}")
+        self.datagram = DatagramSession.connect(self.udp_host, int(line[1]), bytes.fromhex(line[2]),
+                                                timeout=min(timeout, 3.0))
+        logger.info(f"UDP 数据通道已建立: {self.udp_host}:{line[1]}")
+
+    @property
+    def udp_alive(self) -> bool:
+        return self.datagram is not None and self.datagram.alive
+
+    def stop(self):
+        self._running = False
+        self._refill.set()
+        if self.datagram:
+            self.datagram.close()
+        with self._warm_lock:
+            warm, self._warm = list(self._warm), deque()
+        for ch in warm:
+            try:
+                ch.close()
+            except Exception:
+                pass
+        if self._exec:
+            try:
+                self._exec.close()
+            except Exception:
+                pass
+            self._exec = None
+
+    @property
+    def agent_alive(self) -> bool:
+        return self._running and self._exec is not None and not self._exec.exit_status_ready()
+
+    def is_active(self) -> bool:
+        return self.transport.is_active()
+
+    def open_channel(self, kind: str, dest_addr: tuple, src_addr: tuple = None,
+                     timeout: float = None, **kwargs):
+        if kind != "direct-tcpip" or not self.agent_alive:
+            self.fallback_opens += 1
+            return self.transport.open_channel(kind, dest_addr, src_addr, timeout=timeout, **kwargs)
+
+        if self.udp_alive:
+            sock = None
+            try:
+                sock = self.datagram.open_stream()
+                sock.settimeout(timeout or 10)
+                sock.sendall(f"CONNECT {self._token} {dest_addr[0]} {int(dest_addr[1])}\n".encode("utf-8"))
+                reply = _read_line(sock)
+            except Exception as e:
+                logger.debug(f"UDP 数据通道建流失败，回退 SSH: {e}")
+                if sock is not None:
+                    sock.close()
+            else:
+                if reply != b"OK":
+                    sock.close()
+                    # 空响应是 UDP 会话中断 (流被关闭)，回退 SSH；否则是目标不可达
+                    if reply:
+                        raise Exception(reply.decode("utf-8", errors="replace"))
+                else:
+                    sock.settimeout(None)
+                    self.udp_opens += 1
+                    return sock
+
+        try:
+            channel = self._take_warm() or self._open_agent_channel(timeout)
+            channel.settimeout(timeout or 10)
+            channel.sendall(f"CONNECT {self._token} {dest_addr[0]} {int(dest_addr[1])}\n".encode("utf-8"))
+            reply = _read_line(channel)
+        except Exception as e:
+            # 伴随进程不可用：回退为 sshd 直接建连
+            logger.debug(f"伴随进程通道失败，回退 direct-tcpip: {e}")
+            self.fallback_opens += 1
+            return self.transport.open_channel(kind, dest_addr, src_addr, timeout=timeout, **kwargs)
+
+        if reply != b"OK":
+            channel.close()
+            raise Exception(reply.decode("utf-8", errors="replace") or "伴随进程已关闭连接")
+        channel.settimeout(None)
+        self.helper_opens += 1
+        return channel
+
+    def _open_agent_channel(self, timeout: float = None) -> paramiko.Channel:
+        return self.transport.open_channel(
+            "direct-tcpip", ("127.0.0.1", self.agent_port), ("127.0.0.1", 0), timeout=timeout or 10
+        )
+
+    def _take_warm(self) -> Optional[paramiko.Channel]:
+        with self._warm_lock:
+            channel = self._warm.popleft() if self._warm else None
+        self._refill.set()
+        if channel is not None and (channel.closed or channel.eof_received):
+            return None
+        return channel
+
+    def _refill_loop(self):
+        while self._running:
+            self._refill.wait()
+            self._refill.clear()
+            while self._running and self.agent_alive:
+                with self._warm_lock:
+                    if len(self._warm) >= self.WARM_CHANNELS:
+                        break
+                try:
+                    channel = self._open_agent_channel()
+                except Exception as e:
+                    logger.debug(f"预热伴随进程通道失败: {e}")
+                    time.sleep(1)
+                    break
+                with self._warm_lock:
+                    self._warm.append(channel)
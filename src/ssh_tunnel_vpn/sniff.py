@@ -0,0 +1,127 @@
+"""
+首包主机名嗅探 — 从客户端发出的第一段数据中提取目标域名
+
+客户端以 IP 地址发起 SOCKS5 CONNECT (ATYP=0x01/0x04) 时，
+可从 TLS ClientHello 的 SNI 扩展或明文 HTTP 请求的 Host 头中还原域名，
+再用域名作为 SSH 通道目标，由远端解析 (绕开本地被污染的 DNS 结果)。
+
+解析器只在给定缓冲区内按偏移量读取，有界且不复制数据，任何越界或格式不符都返回 None。
+"""
+from typing import Optional
+
+# 嗅探只看首段数据，最多这么多字节 (一条完整 TLS 记录: 5 字节头 + 16 KiB 载荷)
+MAX_SNIFF_BYTES = 5 + 16384
+
+_HTTP_METHODS = (b"GET ", b"POST ", b"HEAD ", b"PUT ", b"DELETE ", b"OPTIONS ", b"PATCH ", b"TRACE ")
+
+
+def _u16(buf, pos: int) -> int:
+    return (buf[pos] << 8) | buf[pos + 1]
+
+
+def _valid_hostname(name: bytes) -> bool:
+    if not name or len(name) > 253:
+        return False
+    for c in name:
+        # 字母、数字、'-'、'.'、'_'
+        if not (48 <= c <= 57 or 65 <= c <= 90 or 97 <= c <= 122 or c in (45, 46, 95)):
+            return False
+    return True
+
+
+def first_data_complete(data: bytes) -> bool:
+    """首段数据是否已足够嗅探: TLS 记录按头部长度收齐，HTTP 收到头部结束，其他协议不再等待"""
+    n = len(data)
+    if n >= MAX_SNIFF_BYTES:
+        return True
+    if n == 0:
+        return False
+    if data[0] == 0x16:
+        # ClientHello 可能被拆成多个 TCP 段，按记录头里的长度收齐
+        return n >= 5 and n >= min(MAX_SNIFF_BYTES, 5 + _u16(data, 3))
+    if any(m.startswith(data[:len(m)]) for m in _HTTP_METHODS):
+        return b"\r\n\r\n" in data
+    return True
+
+
+def parse_tls_sni(data: bytes) -> Optional[str]:
+    """从 TLS ClientHello 中提取 SNI (server_name) 扩展的主机名"""
+    buf = memoryview(data)[:MAX_SNIFF_BYTES]
+    n = len(buf)
+    # TLS 记录头: type(1)=0x16 handshake, version(2), length(2)
+    if n < 5 or buf[0] != 0x16 or buf[1] != 0x03:
+        return None
+    end = min(n, 5 + _u16(buf, 3))
+    # Handshake 头: type(1)=0x01 ClientHello, length(3)
+    pos = 5
+    if end < pos + 4 or buf[pos] != 0x01:
+        return None
+    # client_version(2) + random(32)
+    pos += 4 + 2 + 32
+    if pos + 1 > end:
+        return None
+    pos += 1 + buf[pos]                     # session_id
+    if pos + 2 > end:
+        return None
+    pos += 2 + _u16(buf, pos)               # cipher_suites
+    if pos + 1 > end:
+        return None
+    pos += 1 + buf[pos]                     # compression_methods
+    if pos + 2 > end:
+        return None
+    ext_end = min(end, pos + 2 + _u16(buf, pos))
+    pos += 2
+
+    while pos + 4 <= ext_end:
+        ext_type = _u16(buf, pos)
+        ext_len = _u16(buf, pos + 2)
+        pos += 4
+        if ext_type == 0x0000:
+            # server_name_list: list_len(2), [name_type(1), name_len(2), name]...
+            p = pos + 2
+            list_end = min(ext_end, pos + ext_len)
+            while p + 3 <= list_end:
+                name_type = buf[p]
+                name_len = _u16(buf, p + 1)
+                p += 3
+                if p + name_len > list_end:
+                    return None
+                if name_type == 0x00:
+                    name = bytes(buf[p:p + name_len])
+                    return name.decode("ascii").lower() if _valid_hostname(name) else None
+                p += name_len
+            return None
+        pos += ext_len
+    return None
+
+
+def parse_http_host(data: bytes) -> Optional[str]:
+    """从明文 HTTP 请求头中提取 Host (去掉端口)"""
+    if not data.startswith(_HTTP_METHODS):
+        return None
+    head_end = data.find(b"\r\n\r\n", 0, MAX_SNIFF_BYTES)
+    if head_end == -1:
+        head_end = min(len(data), MAX_SNIFF_BYTES)
+    pos = data.find(b"\r\n", 0, head_end)
+    while pos != -1 and pos < head_end:
+        line_start = pos + 2
+        line_end = data.find(b"\r\n", line_start, head_end)
+        if line_end == -1:
+            line_end = head_end
+        if line_end - line_start > 5 and data[line_start:line_start + 5].lower() == b"host:":
+            value = data[line_start + 5:line_end].strip()
+            if value.startswith(b"["):
+                return None  # IPv6 字面量，没有可用的域名
+            host = value.split(b":", 1)[0]
+            return host.decode("ascii").lower() if _valid_hostname(host) else None
+        pos = line_end if line_end < head_end else -1
+    return None
+
+
+def sniff_hostname(data: bytes) -> Optional[str]:
+    """依次尝试 TLS SNI 和 HTTP Host，返回嗅探到的主机名或 None"""
+    if not data:
+        return None
+    if data[0] == 0x16:
+        return parse_tls_sni(data)
+    return parse_http_host(data)
@@ -4,6 +4,8 @@ SSH隧道管理器 + SOCKS5代理服务器
   1. 纯Python实现 (默认)
   2. C引擎加速的中继 (如果编译了C库)
 """
+import asyncio
+import functools
 import logging
 import socket
 import select
@@ -13,62 +15,186 @@ import time
 import subprocess
 import sys
 import os
-from typing import Optional, Callable
+from typing import Callable, Dict, List, Optional
 
 import paramiko
 
-from .http_proxy import HttpProxyServer
+from . import async_engine, keycache
+from .async_engine import BufferPool, LoopThread, check_engine
+from .channel_ctl import close_channel, control_packets, tune_channel
+from .config import ServerConfig
+from .control_master import ControlClientTransport, ControlMasterServer
+from .fastpath import splice_relay
+from .http_proxy import AsyncHttpProxyServer, HttpProxyServer
+from .ledger import TrafficLedger, get_ledger
+from .placement import Placement, get_placement
+from .remote_helper import RemoteHelper
+from .sniff import MAX_SNIFF_BYTES, first_data_complete, sniff_hostname
+from .stats_page import OPEN_BUCKET_PREFIX, OPEN_LATENCY_BUCKETS_MS, StatsPublisher, bucket_index
+from .tcp_info import TcpInfoSampler, transport_socket
+from .tickless import Activity, Waker, accept, close_session, quiet_transport, watch
+from .transport_pool import TransportPool
+from .trace import DOWN, UP, ConnTrace, TraceRecorder, open_recorder
+from .tuning import TuningProfile, apply_client_socket, apply_transport, get_profile
 
 logger = logging.getLogger(__name__)
 
 
+def _is_ip_literal(addr: str) -> bool:
+    for family in (socket.AF_INET, socket.AF_INET6):
+        try:
+            socket.inet_pton(family, addr)
+            return True
+        except (OSError, ValueError):
+            pass
+    return False
+
+
+def _decode_socks5_address(addr_type: int, addr_bytes: bytes) -> str:
+    """SOCKS5 请求中的 DST.ADDR → 字符串 (IPv4 / 域名 / IPv6)"""
+    if addr_type == 0x01:
+        return socket.inet_ntoa(addr_bytes)
+    if addr_type == 0x04:
+        return socket.inet_ntop(socket.AF_INET6, addr_bytes)
+    return addr_bytes.decode("utf-8")
+
+
+class _ConnTally:
+    """单条连接的字节数 (结束时记入流量账本) 与可选的轨迹"""
+
+    __slots__ = ("up", "down", "trace")
+
+    def __init__(self, trace: Optional[ConnTrace] = None):
+        self.up = 0
+        self.down = 0
+        self.trace = trace
+
+
 class Socks5Server:
-    """本地SOCKS5代理服务器 - 将请求通过SSH通道转发"""
+    """本地SOCKS5代理服务器 - 将请求通过SSH通道转发
+
+    sniff=True 时，对以 IP 地址发起的 CONNECT 先回复成功，再读取客户端首包，
+    从 TLS SNI / HTTP Host 中取得域名作为通道目标 (由远端解析)。
+    """
 
-    def __init__(self, ssh_transport: paramiko.Transport, bind_port: int = 10800):
+    # 等待客户端首包的时间；服务端先发言的协议 (SSH/SMTP 等) 超时后按原 IP 连接
+    SNIFF_TIMEOUT = 0.3
+
+    def __init__(self, ssh_transport: paramiko.Transport, bind_port: int = 10800, sniff: bool = False,
+                 tuning: Optional[TuningProfile] = None, placement: Optional[Placement] = None,
+                 ledger: Optional[TrafficLedger] = None, trace: Optional[TraceRecorder] = None,
+                 activity: Optional[Activity] = None):
         self.transport = ssh_transport
         self.bind_port = bind_port
+        self.sniff = sniff
+        self.tuning = tuning or get_profile(None)
+        self.placement = placement
+        self.ledger = ledger
+        self.trace = trace
+        # 计数 / 连接增减时通知统计的消费者 (见 tickless.Activity)
+        self.activity = activity or Activity()
         self.server_socket: Optional[socket.socket] = None
         self.running = False
         self._thread: Optional[threading.Thread] = None
+        self._waker: Optional[Waker] = None
+
+        # 流量统计
+        self._lock = threading.Lock()
+        self._bytes_up = 0
+        self._bytes_down = 0
+        self._active = 0
+        self._total = 0
+        # 进行中的客户端连接 (stop 时 shutdown，让阻塞在 select 上的中继线程立即退出)
+        self._clients = set()
+        # 通道建立耗时直方图 (桶见 stats_page.OPEN_LATENCY_BUCKETS_MS)
+        self._open_hist = [0] * (len(OPEN_LATENCY_BUCKETS_MS) + 1)
+        self._open_sum = 0.0
+        self._open_failed = 0
+        # 本端发出的 SSH 控制报文数 (估算，见 channel_ctl.py)
+        self._control_packets = 0
 
     def start(self):
         self.server_socket = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
         self.server_socket.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
-        self.server_socket.settimeout(1.0)
+        self.server_socket.setblocking(False)
         self.server_socket.bind(("127.0.0.1", self.bind_port))
         self.server_socket.listen(128)
+        self._waker = Waker()
         self.running = True
 
         self._thread = threading.Thread(target=self._accept_loop, daemon=True)
         self._thread.start()
         logger.info(f"SOCKS5代理已启动: 127.0.0.1:{self.bind_port}")
 
-    def stop(self):
-        self.running = False
+    def stop_accepting(self):
+        """关闭监听端口，已建立的连接照常转发 (排空用，见 SshTunnelManager.disconnect)"""
+        if self._waker:
+            self._waker.wake()
+        if self._thread:
+            self._thread.join(timeout=3)
         if self.server_socket:
             try:
                 self.server_socket.close()
             except Exception:
                 pass
-        if self._thread:
-            self._thread.join(timeout=3)
+        if self._waker:
+            self._waker.close()
+
+    def stop(self):
+        self.running = False
+        self.stop_accepting()
+        self._shutdown_clients()
         logger.info("SOCKS5代理已停止")
 
+    def _shutdown_clients(self):
+        with self._lock:
+            clients = list(self._clients)
+        for client in clients:
+            try:
+                client.shutdown(socket.SHUT_RDWR)
+            except OSError:
+                pass
+
+    def get_stats(self) -> dict:
+        with self._lock:
+            return {
+                "bytes_up": self._bytes_up,
+                "bytes_down": self._bytes_down,
+                "active": self._active,
+                "total": self._total,
+                "control_packets": self._control_packets,
+            }
+
+    def get_open_latency(self) -> dict:
+        with self._lock:
+            return {"buckets": list(self._open_hist), "sum": self._open_sum, "failed": self._open_failed}
+
     def _accept_loop(self):
+        if self.placement:
+            self.placement.pin_listener()
+        # 不设超时: 空闲时阻塞在 select 上，stop() 经 waker 唤醒
         while self.running:
             try:
-                client_socket, addr = self.server_socket.accept()
+                conn = accept(self.server_socket, self._waker)
+                if conn is None:
+                    break
+                client_socket, addr = conn
+                apply_client_socket(client_socket, self.tuning)
                 t = threading.Thread(target=self._handle_client, args=(client_socket,), daemon=True)
                 t.start()
-            except socket.timeout:
-                continue
             except Exception as e:
                 if self.running:
                     logger.error(f"接受连接错误: {e}")
                 break
 
     def _handle_client(self, client: socket.socket):
+        if self.placement:
+            self.placement.pin_worker()
+        with self._lock:
+            self._active += 1
+            self._total += 1
+            self._clients.add(client)
+        self.activity.poke()
         try:
             # SOCKS5 握手
             header = client.recv(2)
@@ -91,22 +217,34 @@ class Socks5Server:
 
             if addr_type == 0x01:  # IPv4
                 addr_bytes = client.recv(4)
-                dest_addr = socket.inet_ntoa(addr_bytes)
             elif addr_type == 0x03:  # 域名
                 addr_len = client.recv(1)[0]
-                dest_addr = client.recv(addr_len).decode("utf-8")
+                addr_bytes = client.recv(addr_len)
             elif addr_type == 0x04:  # IPv6
                 addr_bytes = client.recv(16)
-                dest_addr = socket.inet_ntop(socket.AF_INET6, addr_bytes)
             else:
                 client.sendall(b"\x05\x08\x00\x01" + b"\x00" * 6)
                 client.close()
                 return
+            dest_addr = _decode_socks5_address(addr_type, addr_bytes)
 
             port_bytes = client.recv(2)
             dest_port = struct.unpack("!H", port_bytes)[0]
 
+            reply = b"\x05\x00\x00\x01" + socket.inet_aton("0.0.0.0") + struct.pack("!H", 0)
+            first_data = b""
+            sniffing = self.sniff and (addr_type != 0x03 or _is_ip_literal(dest_addr))
+            if sniffing:
+                # 先回复成功，拿到客户端首包后再决定通道目标
+                client.sendall(reply)
+                first_data = self._read_first_data(client)
+                sniffed = sniff_hostname(first_data)
+                if sniffed:
+                    logger.debug(f"嗅探到主机名 {dest_addr}:{dest_port} → {sniffed}")
+                    dest_addr = sniffed
+
             # 通过SSH通道连接
+            t0 = time.perf_counter()
             try:
                 channel = self.transport.open_channel(
                     "direct-tcpip",
@@ -115,17 +253,39 @@ class Socks5Server:
                     timeout=10
                 )
             except Exception as e:
+                with self._lock:
+                    self._open_failed += 1
                 logger.debug(f"SSH通道失败 {dest_addr}:{dest_port}: {e}")
-                client.sendall(b"\x05\x05\x00\x01" + b"\x00" * 6)
+                if not sniffing:
+                    client.sendall(b"\x05\x05\x00\x01" + b"\x00" * 6)
                 client.close()
                 return
+            elapsed = time.perf_counter() - t0
+            with self._lock:
+                self._open_hist[bucket_index(elapsed * 1000)] += 1
+                self._open_sum += elapsed
+            tune_channel(channel)
+
+            tally = _ConnTally(self.trace.begin(dest_addr, dest_port, elapsed * 1000) if self.trace else None)
+            if sniffing:
+                if first_data:
+                    channel.sendall(first_data)
+                    self._count_up(len(first_data), tally)
+            else:
+                # 回复成功
+                client.sendall(reply)
 
-            # 回复成功
-            reply = b"\x05\x00\x00\x01" + socket.inet_aton("0.0.0.0") + struct.pack("!H", 0)
-            client.sendall(reply)
-
-            # 数据中继
-            self._relay_python(client, channel)
+            # 数据中继：共享会话从实例拿到的是本地套接字，可走内核态转发
+            if splice_relay(client, channel, self.tuning.relay_chunk, lambda: self.running,
+                            lambda n: self._count_up(n, tally), lambda n: self._count_down(n, tally)):
+                channel.close()
+            else:
+                self._relay_python(client, channel, tally)
+            self._count_control(channel, tally)
+            if self.ledger:
+                self.ledger.record(dest_addr, tally.up, tally.down)
+            if tally.trace:
+                tally.trace.close()
 
         except Exception as e:
             logger.debug(f"SOCKS5处理错误: {e}")
@@ -134,35 +294,418 @@ class Socks5Server:
                 client.close()
             except Exception:
                 pass
-
-    def _relay_python(self, client: socket.socket, channel: paramiko.Channel):
+            with self._lock:
+                self._active -= 1
+                self._clients.discard(client)
+            self.activity.poke()
+
+    def _read_first_data(self, client: socket.socket) -> bytes:
+        """在 SNIFF_TIMEOUT 内读取客户端首包，直到 TLS 记录/HTTP 头收齐；客户端不先发言时返回空串"""
+        deadline = time.monotonic() + self.SNIFF_TIMEOUT
+        data = b""
+        while not first_data_complete(data):
+            left = deadline - time.monotonic()
+            if left <= 0:
+                break
+            r, _, _ = select.select([client], [], [], left)
+            if not r:
+                break
+            chunk = client.recv(MAX_SNIFF_BYTES - len(data))
+            if not chunk:
+                break
+            data += chunk
+        return data
+
+    def _count_up(self, n: int, tally: _ConnTally):
+        tally.up += n
+        if tally.trace:
+            tally.trace.add(UP, n)
+        with self._lock:
+            self._bytes_up += n
+        self.activity.poke()
+
+    def _count_down(self, n: int, tally: _ConnTally):
+        tally.down += n
+        if tally.trace:
+            tally.trace.add(DOWN, n)
+        with self._lock:
+            self._bytes_down += n
+        self.activity.poke()
+
+    def _count_control(self, channel, tally: _ConnTally):
+        n = control_packets(channel, tally.down)
+        if n:
+            with self._lock:
+                self._control_packets += n
+
+    def _relay_python(self, client: socket.socket, channel: paramiko.Channel, tally: _ConnTally):
         """Python实现的双向数据中继"""
-        channel.settimeout(0.0)
-        client.settimeout(0.0)
+        chunk = self.tuning.relay_chunk
+        # 阻塞模式：select 保证 recv 不阻塞；sendall 在对端/通道窗口满时等待而不是抛错。
+        # select 不设超时，空闲的长连接不会被周期性唤醒；stop() 通过 shutdown 客户端套接字结束中继
+        channel.settimeout(None)
+        client.settimeout(None)
         try:
             while self.running:
-                r, _, _ = select.select([client, channel], [], [], 1.0)
+                r, _, _ = select.select([client, channel], [], [])
                 if client in r:
-                    data = client.recv(65536)
+                    data = client.recv(chunk)
                     if not data:
                         break
                     channel.sendall(data)
+                    self._count_up(len(data), tally)
                 if channel in r:
-                    data = channel.recv(65536)
+                    data = channel.recv(chunk)
                     if not data:
                         break
                     client.sendall(data)
+                    self._count_down(len(data), tally)
         except Exception:
             pass
         finally:
+            # EOF/CLOSE 由关闭线程批量发出，中继线程不等待传输层写锁
+            close_channel(channel)
+
+
+class AsyncSocks5Server(Socks5Server):
+    """asyncio 引擎的 SOCKS5 服务器 (见 async_engine.py)
+
+    全部连接由一个事件循环线程服务，协议与统计和线程引擎一致；不走内核态转发。
+    """
+
+    def __init__(self, *args, **kwargs):
+        super().__init__(*args, **kwargs)
+        self._loop_thread: Optional[LoopThread] = None
+        self._pool = BufferPool(self.tuning.relay_chunk)
+        # 绑定方法只建一次，各条中继共享引用
+        self._on_relay_data = self._relay_data
+        self._on_relay_done = self._relay_done
+
+    def start(self):
+        self.server_socket = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        self.server_socket.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.server_socket.setblocking(False)
+        self.server_socket.bind(("127.0.0.1", self.bind_port))
+        self.server_socket.listen(128)
+        self.running = True
+
+        self._loop_thread = LoopThread(f"socks5-{self.bind_port}", self.placement)
+        self._loop_thread.start(self._accept_loop_async())
+        logger.info(f"SOCKS5代理已启动: 127.0.0.1:{self.bind_port} (asyncio)")
+
+    def stop_accepting(self):
+        if self._loop_thread:
+            self._loop_thread.cancel_main()
+        if self.server_socket:
             try:
-                channel.close()
+                self.server_socket.close()
+            except Exception:
+                pass
+
+    def stop(self):
+        self.running = False
+        if self._loop_thread:
+            self._loop_thread.stop()
+        if self.server_socket:
+            try:
+                self.server_socket.close()
             except Exception:
                 pass
+        logger.info("SOCKS5代理已停止")
+
+    async def _accept_loop_async(self):
+        loop = asyncio.get_running_loop()
+        while self.running:
+            try:
+                client, _ = await loop.sock_accept(self.server_socket)
+            except Exception as e:
+                if self.running:
+                    logger.error(f"接受连接错误: {e}")
+                break
+            client.setblocking(False)
+            apply_client_socket(client, self.tuning)
+            self._loop_thread.spawn(self._handle_client_async(client))
+
+    async def _read_first_data_async(self, loop, client: socket.socket) -> bytes:
+        """异步版首包读取：同样按 TLS 记录长度收齐，总时长受 SNIFF_TIMEOUT 限制"""
+        deadline = loop.time() + self.SNIFF_TIMEOUT
+        data = b""
+        try:
+            while not first_data_complete(data):
+                chunk = await asyncio.wait_for(loop.sock_recv(client, MAX_SNIFF_BYTES - len(data)),
+                                               max(0.0, deadline - loop.time()))
+                if not chunk:
+                    break
+                data += chunk
+        except asyncio.TimeoutError:
+            pass
+        return data
+
+    async def _handle_client_async(self, client: socket.socket):
+        loop = asyncio.get_running_loop()
+        recv_exact = async_engine.recv_exact
+        channel = None
+        with self._lock:
+            self._active += 1
+            self._total += 1
+        self.activity.poke()
+        try:
+            # SOCKS5 握手
+            header = await recv_exact(loop, client, 2)
+            if header[0] != 0x05:
+                return
+            await recv_exact(loop, client, header[1])
+            await loop.sock_sendall(client, b"\x05\x00")
+
+            # 连接请求
+            request = await recv_exact(loop, client, 4)
+            if request[0] != 0x05 or request[1] != 0x01:
+                await loop.sock_sendall(client, b"\x05\x07\x00\x01" + b"\x00" * 6)
+                return
+
+            addr_type = request[3]
+            if addr_type == 0x01:  # IPv4
+                addr_bytes = await recv_exact(loop, client, 4)
+            elif addr_type == 0x03:  # 域名
+                addr_len = (await recv_exact(loop, client, 1))[0]
+                addr_bytes = await recv_exact(loop, client, addr_len)
+            elif addr_type == 0x04:  # IPv6
+                addr_bytes = await recv_exact(loop, client, 16)
+            else:
+                await loop.sock_sendall(client, b"\x05\x08\x00\x01" + b"\x00" * 6)
+                return
+            dest_addr = _decode_socks5_address(addr_type, addr_bytes)
+            dest_port = struct.unpack("!H", await recv_exact(loop, client, 2))[0]
+
+            reply = b"\x05\x00\x00\x01" + socket.inet_aton("0.0.0.0") + struct.pack("!H", 0)
+            first_data = b""
+            sniffing = self.sniff and (addr_type != 0x03 or _is_ip_literal(dest_addr))
+            if sniffing:
+                await loop.sock_sendall(client, reply)
+                first_data = await self._read_first_data_async(loop, client)
+                sniffed = sniff_hostname(first_data)
+                if sniffed:
+                    logger.debug(f"嗅探到主机名 {dest_addr}:{dest_port} → {sniffed}")
+                    dest_addr = sniffed
+
+            # 通道建立会阻塞等待服务器回复，放到线程池
+            t0 = time.perf_counter()
+            try:
+                channel = await self._loop_thread.run_blocking(
+                    self.transport.open_channel, "direct-tcpip", (dest_addr, dest_port), ("127.0.0.1", 0),
+                    timeout=10)
+            except Exception as e:
+                with self._lock:
+                    self._open_failed += 1
+                logger.debug(f"SSH通道失败 {dest_addr}:{dest_port}: {e}")
+                if not sniffing:
+                    await loop.sock_sendall(client, b"\x05\x05\x00\x01" + b"\x00" * 6)
+                return
+            elapsed = time.perf_counter() - t0
+            with self._lock:
+                self._open_hist[bucket_index(elapsed * 1000)] += 1
+                self._open_sum += elapsed
+            tune_channel(channel)
+
+            tally = _ConnTally(self.trace.begin(dest_addr, dest_port, elapsed * 1000) if self.trace else None)
+            async_engine.prepare(channel)
+            if sniffing:
+                if first_data:
+                    await async_engine.send_all(loop, channel, first_data)
+                    self._count_up(len(first_data), tally)
+            else:
+                await loop.sock_sendall(client, reply)
+
+            # 交给事件循环的读写回调，本协程随即结束；收尾在 _relay_done
+            self._loop_thread.start_relay(client, channel, self._pool, self._on_relay_data, self._on_relay_done,
+                                          (client, channel, dest_addr, tally))
+            client = channel = None
+
+        except Exception as e:
+            logger.debug(f"SOCKS5处理错误: {e}")
+        finally:
+            if client is not None:
+                self._release(client, channel)
+
+    def _relay_data(self, ctx, forward: bool, n: int):
+        if forward:
+            self._count_up(n, ctx[3])
+        else:
+            self._count_down(n, ctx[3])
+
+    def _relay_done(self, ctx):
+        client, channel, dest_addr, tally = ctx
+        self._count_control(channel, tally)
+        if self.ledger:
+            self.ledger.record(dest_addr, tally.up, tally.down)
+        if tally.trace:
+            tally.trace.close()
+        self._release(client, channel)
+
+    def _release(self, client: socket.socket, channel):
+        # paramiko 通道的 close() 要拿传输层写锁，交给关闭线程，不阻塞事件循环
+        if channel is not None:
+            close_channel(channel)
+        try:
+            client.close()
+        except Exception:
+            pass
+        with self._lock:
+            self._active -= 1
+        self.activity.poke()
+
+
+def _precheck_key(path: str, label: str):
+    if not path:
+        return
+    if path.lower().endswith(".pub"):
+        raise Exception(f"{label}选择的是公钥(.pub)，请改选私钥文件")
+    try:
+        with open(path, "rb") as f:
+            head = f.read(256)
+    except Exception as e:
+        raise Exception(f"{label}无法读取私钥文件: {e}")
+
+    if b"PuTTY-User-Key-File-" in head:
+        raise Exception(f"{label}是 PuTTY .ppk 格式，Paramiko 不一定可用；请转换为 OpenSSH 私钥")
+
+    if (
+        b"BEGIN OPENSSH PRIVATE KEY" in head
+        or b"BEGIN RSA PRIVATE KEY" in head
+        or b"BEGIN EC PRIVATE KEY" in head
+        or b"BEGIN DSA PRIVATE KEY" in head
+    ):
+        return
+
+    if head.startswith(b"ssh-") or head.startswith(b"ecdsa-"):
+        raise Exception(f"{label}文件看起来像公钥文本，请选择私钥文件")
+
+
+def _load_pkey(path: str, passphrase: str, label: str,
+               log: Optional[Callable[[str], None]] = None) -> paramiko.PKey:
+    """按文件内容识别类型后只解析一次，结果进程内缓存 (见 keycache.py)"""
+    pkey, elapsed, hit = keycache.load_key(path, passphrase, label)
+    if log:
+        if hit:
+            log(f"私钥 ({label}): 缓存命中，省去解析 {elapsed * 1000:.0f} ms")
+        else:
+            log(f"私钥 ({label}): 解析 {elapsed * 1000:.0f} ms ({pkey.get_name()})，已缓存")
+    return pkey
+
+
+def _connect_ssh(
+    ssh_client: paramiko.SSHClient,
+    *, hostname: str, port: int, username: str,
+    password: str, use_key: bool, key_path: str, key_passphrase: str,
+    sock=None, log: Optional[Callable[[str], None]] = None,
+):
+    kwargs = dict(
+        hostname=hostname,
+        port=port,
+        username=username,
+        timeout=20,
+        look_for_keys=False,
+        allow_agent=False,
+        banner_timeout=20,
+    )
+    if sock is not None:
+        kwargs["sock"] = sock
+
+    if use_key:
+        pkey = _load_pkey(key_path, key_passphrase, hostname, log)
+        kwargs["password"] = None
+        kwargs["pkey"] = pkey
+    else:
+        kwargs["password"] = password
+
+    ssh_client.connect(**kwargs)
+
+
+def _check_login(username: str, password: str,
+                 use_key: bool, key_path: str, key_passphrase: str,
+                 use_jump: bool, jump_username: str, jump_password: str,
+                 jump_use_key: bool, jump_key_path: str, jump_key_passphrase: str) -> tuple:
+    """认证参数校验与补全 (跳板机留空时复用目标机用户名/密码/私钥)"""
+    if use_jump:
+        jump_username = jump_username or username
+        jump_password = jump_password or password
+
+    # 目标机认证校验
+    if use_key:
+        if not key_path:
+            raise Exception("目标机已选择私钥登录，但未提供私钥文件")
+        if not os.path.exists(key_path):
+            raise Exception(f"目标机私钥文件不存在: {key_path}")
+        _precheck_key(key_path, "目标机")
+
+    # 跳板机认证校验
+    if use_jump and jump_use_key:
+        if not jump_key_path:
+            # 若跳板机未填 key，则尝试复用目标机 key
+            jump_key_path = key_path
+            jump_key_passphrase = jump_key_passphrase or key_passphrase
+        if not jump_key_path:
+            raise Exception("跳板机已选择私钥登录，但未提供私钥文件")
+        if not os.path.exists(jump_key_path):
+            raise Exception(f"跳板机私钥文件不存在: {jump_key_path}")
+        _precheck_key(jump_key_path, "跳板机")
+
+    return key_path, key_passphrase, jump_username, jump_password, jump_key_path, jump_key_passphrase
+
+
+class _Exit:
+    """附加出口：独立的 SSH 会话 + 绑定到该会话的 SOCKS5/HTTP 监听端口"""
+
+    def __init__(self, host: str, client: paramiko.SSHClient,
+                 jump_client: Optional[paramiko.SSHClient], jump_channel: Optional[paramiko.Channel]):
+        self.host = host
+        self.client = client
+        self.jump_client = jump_client
+        self.jump_channel = jump_channel
+        self.socks_server: Optional[Socks5Server] = None
+        self.http_proxy: Optional[HttpProxyServer] = None
+        self.remote_helper: Optional[RemoteHelper] = None
+        self.pool: Optional[TransportPool] = None
+        sock = transport_socket(client, jump_client)
+        self.tcp_sampler = TcpInfoSampler(sock) if sock else None
+
+    def is_alive(self) -> bool:
+        transport = self.client.get_transport()
+        if transport is None or not transport.is_active():
+            return False
+        if self.jump_client:
+            jump_transport = self.jump_client.get_transport()
+            if jump_transport is None or not jump_transport.is_active():
+                return False
+        return True
+
+    def close(self):
+        if self.http_proxy:
+            self.http_proxy.stop()
+            self.http_proxy = None
+        if self.socks_server:
+            self.socks_server.stop()
+            self.socks_server = None
+        if self.remote_helper:
+            self.remote_helper.stop()
+            self.remote_helper = None
+        if self.pool:
+            self.pool.close()
+            self.pool = None
+        close_session(self.client, self.jump_channel, self.jump_client)
 
 
 class SshTunnelManager:
-    """SSH隧道管理器"""
+    """SSH隧道管理器
+
+    除主连接外，可通过 add_exit() 为同一管理器挂载附加出口：每个出口连接各自的
+    服务器，并在独立的 SOCKS5/HTTP 端口上监听，例如 10800 走东京、10810 走法兰克福。
+    """
+
+    # SSH 保活间隔 (秒)；tickless 模式下为内核 TCP keepalive 的空闲探测时间
+    KEEPALIVE = 30
+    # 排空时检查剩余连接的最长间隔 (秒)：HTTP 代理的连接结束不发活动信号，靠它兜底
+    DRAIN_CHECK = 1.0
 
     def __init__(self):
         self.ssh_client: Optional[paramiko.SSHClient] = None
@@ -170,8 +713,30 @@ class SshTunnelManager:
         self._jump_channel: Optional[paramiko.Channel] = None
         self.socks_server: Optional[Socks5Server] = None
         self.http_proxy: Optional[HttpProxyServer] = None
+        self.control_master: Optional[ControlMasterServer] = None
+        self.remote_helper: Optional[RemoteHelper] = None
+        self.transport_pool: Optional[TransportPool] = None
+        self._shared_transport: Optional[ControlClientTransport] = None
+        # SSH 传输套接字的 TCP_INFO 采样 (共享会话从实例没有自己的传输套接字)
+        self.tcp_sampler: Optional[TcpInfoSampler] = None
+        self.exits: Dict[str, _Exit] = {}
+        self.sniff = False
+        self.tuning = get_profile(None)
+        self.engine = check_engine(None)
+        self.placement: Optional[Placement] = None
+        self.stats_path = ""
+        self.stats_publisher: Optional[StatsPublisher] = None
+        self.ledger: Optional[TrafficLedger] = None
+        self.trace: Optional[TraceRecorder] = None
+        self._exits_lock = threading.Lock()
         self._connected = False
-        self._monitor_thread: Optional[threading.Thread] = None
+        # 转发活动信号: 统计页 / CLI / GUI 在快照不变时等它，不再定时刷新 (TunnelGroup 共用一个)
+        self.activity = Activity()
+        # tickless 模式: 传输线程不再每 0.1 秒读超时一次，保活交给内核 (见 tickless.py)
+        self.tickless = False
+        # disconnect() 默认的排空期限 (秒)，0 为立即关闭；由 connect() 设定
+        self.drain_timeout = 0.0
+        self._drain_aborted = False
         self._c_proxy_proc: Optional[subprocess.Popen] = None
 
         self.on_status_changed: Optional[Callable[[str, str], None]] = None
@@ -179,7 +744,7 @@ class SshTunnelManager:
 
     @property
     def is_connected(self) -> bool:
-        return self._connected and self.ssh_client is not None
+        return self._connected and (self.ssh_client is not None or self._shared_transport is not None)
 
     def connect(self, host: str, port: int, username: str, password: str,
                 socks_port: int = 10800, http_port: int = 10801,
@@ -187,7 +752,11 @@ class SshTunnelManager:
                 use_jump: bool = False,
                 jump_host: str = "", jump_port: int = 22,
                 jump_username: str = "", jump_password: str = "",
-                jump_use_key: bool = False, jump_key_path: str = "", jump_key_passphrase: str = ""):
+                jump_use_key: bool = False, jump_key_path: str = "", jump_key_passphrase: str = "",
+                control_path: str = "", sniff: bool = False, remote_helper: bool = False,
+                tuning: str = "", placement: str = "", stats_path: str = "", ledger_path: str = "",
+                trace_path: str = "", engine: str = "", udp_transport: bool = False, pool_size: int = 1,
+                tickless: bool = False, drain_timeout: float = 0):
         """连接SSH并启动SOCKS代理 + HTTP代理
 
         认证方式严格独立：
@@ -195,111 +764,73 @@ class SshTunnelManager:
           - 跳板机由 jump_use_key 决定使用密码/私钥
 
         即使 key_path/jump_key_path 有值，也不会自动切到私钥认证。
+
+        control_path 非空时启用共享会话：若该控制地址上已有主实例，则直接复用其
+        SSH 会话 (不再握手/认证)；否则本实例正常连接并成为主实例。
+
+        sniff=True 时，以 IP 发起的连接按首包 TLS SNI / HTTP Host 改用域名作为通道目标。
+
+        remote_helper=True 时在服务器上启动伴随进程 (remote_agent.py) 代为建立出站连接，
+        带 DNS 缓存与 Happy Eyeballs；服务器无 python3 时自动回退为 sshd 直连。
+
+        udp_transport=True 时 (隐含 remote_helper) 伴随进程另开 UDP 数据通道 (见 datagram.py)，
+        连接数据改走 UDP 上的独立流，避免一次丢包阻塞全部连接；SSH 保留为控制与回退通道。
+
+        tuning 为调优档位 (latency / balanced / bulk)，同时作用于本地套接字、SSH 传输套接字、
+        中继块大小与通道窗口。
+
+        placement 为 CPU 放置规格 (见 placement.py)，非空时 SSH 传输线程与中继线程绑核；
+        放置是进程级的，附加出口沿用同一规格。
+
+        stats_path 非空时把计数器 / 瞬时值 / 通道建立耗时直方图定期发布到该内存映射文件
+        (见 stats_page.py)，供外部监控进程读取。
+
+        ledger_path 非空时按目标域名 / 按天把流量记入该账本文件 (见 ledger.py)，跨重连累计。
+
+        trace_path 非空时把每条连接的匿名时间线写入该 JSONL 文件 (见 trace.py)，
+        供 benchmarks/bench_replay.py 回放。
+
+        engine 为本地中继引擎：thread (默认，每连接一个线程，可走内核态转发) 或
+        asyncio (单事件循环线程服务全部连接，见 async_engine.py)；附加出口沿用同一引擎。
+
+        pool_size > 1 时启用传输池 (见 transport_pool.py)：吞吐接近单条会话上限或重传增多时
+        自动增开 SSH 会话 (最多 pool_size 条)，持续空闲后排空并关闭多余的会话。
+
+        tickless=True 时 SSH 传输线程不再按 0.1 秒读超时轮询，SSH 保活改由内核 TCP keepalive
+        承担 (见 tickless.py)；与附加出口、传输池的会话一样作用于本进程建立的全部会话。
+
+        drain_timeout > 0 时断开 (含重连前断开旧连接) 先排空：停止接受新连接，进行中的连接
+        最多再转发 drain_timeout 秒，之后统一关闭 (见 disconnect)。
         """
+        self.sniff = sniff
+        self.tickless = tickless
+        self.drain_timeout = max(0.0, drain_timeout)
+        self._drain_aborted = False
+        self.stats_path = stats_path
+        try:
+            self.tuning = get_profile(tuning)
+            self.engine = check_engine(engine)
+            self.placement = get_placement(placement)
+            self.ledger = get_ledger(ledger_path)
+            self._open_trace(trace_path)
+        except Exception as e:
+            self._log(f"❌ {e}")
+            self._notify_status("disconnected", str(e))
+            raise
         try:
+            identity = f"{username}@{host}:{port}"
+            if control_path and self._attach_shared(control_path, identity, socks_port, http_port):
+                return
+
             use_key = bool(use_key)
             jump_use_key = bool(jump_use_key)
 
-            if use_jump:
-                jump_username = jump_username or username
-                jump_password = jump_password or password
-
-            def _precheck_key(path: str, label: str):
-                if not path:
-                    return
-                if path.lower().endswith(".pub"):
-                    raise Exception(f"{label}选择的是公钥(.pub)，请改选私钥文件")
-                try:
-                    with open(path, "rb") as f:
-                        head = f.read(256)
-                except Exception as e:
-                    raise Exception(f"{label}无法读取私钥文件: {e}")
-
-                if b"PuTTY-User-Key-File-" in head:
-                    raise Exception(f"{label}是 PuTTY .ppk 格式，Paramiko 不一定可用；请转换为 OpenSSH 私钥")
-
-                if (
-                    b"BEGIN OPENSSH PRIVATE KEY" in head
-                    or b"BEGIN RSA PRIVATE KEY" in head
-                    or b"BEGIN EC PRIVATE KEY" in head
-                    or b"BEGIN DSA PRIVATE KEY" in head
-                ):
-                    return
-
-                if head.startswith(b"ssh-") or head.startswith(b"ecdsa-"):
-                    raise Exception(f"{label}文件看起来像公钥文本，请选择私钥文件")
-
-            def _load_pkey(path: str, passphrase: str, label: str) -> paramiko.PKey:
-                key_types = []
-                if hasattr(paramiko, "Ed25519Key"):
-                    key_types.append(paramiko.Ed25519Key)
-                if hasattr(paramiko, "RSAKey"):
-                    key_types.append(paramiko.RSAKey)
-                if hasattr(paramiko, "ECDSAKey"):
-                    key_types.append(paramiko.ECDSAKey)
-                # DSSKey 在新版本可能被移除；存在才加入
-                if hasattr(paramiko, "DSSKey"):
-                    key_types.append(paramiko.DSSKey)
-
-                last_exc = None
-                for kt in key_types:
-                    try:
-                        if passphrase:
-                            return kt.from_private_key_file(path, password=passphrase)
-                        return kt.from_private_key_file(path)
-                    except paramiko.PasswordRequiredException:
-                        raise Exception(f"{label}私钥需要口令，请填写私钥口令")
-                    except Exception as e:
-                        last_exc = e
-
-                raise Exception(f"{label}私钥无法解析/口令错误: {last_exc}")
-
-            # 目标机认证校验
-            if use_key:
-                if not key_path:
-                    raise Exception("目标机已选择私钥登录，但未提供私钥文件")
-                if not os.path.exists(key_path):
-                    raise Exception(f"目标机私钥文件不存在: {key_path}")
-                _precheck_key(key_path, "目标机")
-
-            # 跳板机认证校验
-            if use_jump and jump_use_key:
-                if not jump_key_path:
-                    # 若跳板机未填 key，则尝试复用目标机 key
-                    jump_key_path = key_path
-                    jump_key_passphrase = jump_key_passphrase or key_passphrase
-                if not jump_key_path:
-                    raise Exception("跳板机已选择私钥登录，但未提供私钥文件")
-                if not os.path.exists(jump_key_path):
-                    raise Exception(f"跳板机私钥文件不存在: {jump_key_path}")
-                _precheck_key(jump_key_path, "跳板机")
-
-            def _connect_ssh(
-                ssh_client: paramiko.SSHClient,
-                *, hostname: str, port: int, username: str,
-                password: str, use_key: bool, key_path: str, key_passphrase: str,
-                sock=None,
-            ):
-                kwargs = dict(
-                    hostname=hostname,
-                    port=port,
-                    username=username,
-                    timeout=20,
-                    look_for_keys=False,
-                    allow_agent=False,
-                    banner_timeout=20,
-                )
-                if sock is not None:
-                    kwargs["sock"] = sock
-
-                if use_key:
-                    pkey = _load_pkey(key_path, key_passphrase, hostname)
-                    kwargs["password"] = None
-                    kwargs["pkey"] = pkey
-                else:
-                    kwargs["password"] = password
-
-                ssh_client.connect(**kwargs)
+            (key_path, key_passphrase, jump_username, jump_password,
+             jump_key_path, jump_key_passphrase) = _check_login(
+                username, password, use_key, key_path, key_passphrase,
+                use_jump, jump_username, jump_password,
+                jump_use_key, jump_key_path, jump_key_passphrase,
+            )
 
             if use_jump:
                 self._log(f"正在通过跳板机 {jump_host}:{jump_port} 连接目标 {host}:{port} ...")
@@ -309,114 +840,48 @@ class SshTunnelManager:
 
             self.disconnect()
 
-            client = paramiko.SSHClient()
-            client.set_missing_host_key_policy(paramiko.AutoAddPolicy())
-
-            if use_jump:
-                self._log(f"正在连接跳板机 {jump_host}:{jump_port} ...")
-                jump_client = paramiko.SSHClient()
-                jump_client.set_missing_host_key_policy(paramiko.AutoAddPolicy())
-                try:
-                    _connect_ssh(
-                        jump_client,
-                        hostname=jump_host,
-                        port=jump_port,
-                        username=jump_username,
-                        password=jump_password,
-                        use_key=jump_use_key,
-                        key_path=jump_key_path,
-                        key_passphrase=jump_key_passphrase,
-                    )
-                except paramiko.AuthenticationException:
-                    raise Exception("跳板机认证失败：用户名/密码/私钥不匹配")
-                except Exception as e:
-                    raise Exception(f"跳板机登录失败: {e}")
-
-                jump_transport = jump_client.get_transport()
-                if jump_transport is None or not jump_transport.is_active():
-                    raise Exception("跳板机连接成功但 Transport 不可用")
-                jump_transport.set_keepalive(30)
-                self._log("跳板机会话已建立 ✓")
-
-                self._log("正在通过跳板机建立目标会话...")
-                try:
-                    jump_channel = jump_transport.open_channel(
-                        "direct-tcpip",
-                        (host, port),
-                        ("127.0.0.1", 0),
-                        timeout=20,
-                    )
-                except Exception as e:
-                    raise Exception(f"跳板机到目标机转发失败(请检查跳板机 AllowTcpForwarding): {e}")
-
-                try:
-                    _connect_ssh(
-                        client,
-                        hostname=host,
-                        port=port,
-                        username=username,
-                        password=password,
-                        use_key=use_key,
-                        key_path=key_path,
-                        key_passphrase=key_passphrase,
-                        sock=jump_channel,
-                    )
-                except paramiko.AuthenticationException:
-                    # 这里的认证失败应当按“目标机当前选择的方式”解释
-                    if use_key:
-                        raise Exception("目标机公钥认证失败：请确认目标机用户名正确，且公钥已加入 authorized_keys")
-                    raise Exception("目标机密码认证失败：用户名或密码错误")
-                except Exception as e:
-                    raise Exception(f"目标机登录失败(经跳板机): {e}")
-
-                self.jump_client = jump_client
-                self._jump_channel = jump_channel
-            else:
-                self._log("正在建立SSH会话...")
-                try:
-                    _connect_ssh(
-                        client,
-                        hostname=host,
-                        port=port,
-                        username=username,
-                        password=password,
-                        use_key=use_key,
-                        key_path=key_path,
-                        key_passphrase=key_passphrase,
-                    )
-                except paramiko.AuthenticationException:
-                    if use_key:
-                        raise Exception("公钥认证失败：请确认用户名正确，且公钥已加入 authorized_keys")
-                    raise Exception("密码认证失败：用户名或密码错误")
-            self._log("SSH会话已建立 ✓")
-
+            client, jump_client, jump_channel = self._open_session(
+                host, port, username, password, use_key, key_path, key_passphrase,
+                use_jump, jump_host, jump_port, jump_username, jump_password,
+                jump_use_key, jump_key_path, jump_key_passphrase,
+            )
+            self.jump_client = jump_client
+            self._jump_channel = jump_channel
             transport = client.get_transport()
-            if transport is None:
-                raise Exception("SSH Transport 创建失败")
-            transport.set_keepalive(30)
 
             self.ssh_client = client
-
-            # 启动SOCKS5代理
-            self._log(f"正在启动SOCKS5代理 (端口: {socks_port})...")
-            self.socks_server = Socks5Server(transport, socks_port)
-            self.socks_server.start()
-
-            engine_name = "Python"
-            self._log(f"SOCKS5代理已启动 ✓ ({engine_name})")
-            self._log(f"SOCKS5 地址: 127.0.0.1:{socks_port}")
-
-            # 启动HTTP代理（将HTTP/HTTPS流量通过SOCKS5转发）
-            self._log(f"正在启动HTTP代理 (端口: {http_port})...")
-            self.http_proxy = HttpProxyServer(listen_port=http_port, socks_port=socks_port)
-            self.http_proxy.start()
-            self._log(f"HTTP 代理已启动 ✓")
-            self._log(f"HTTP/HTTPS 地址: 127.0.0.1:{http_port}")
+            sock = transport_socket(client, jump_client)
+            self.tcp_sampler = TcpInfoSampler(sock) if sock else None
+
+            opener = transport
+            if pool_size > 1:
+                self.transport_pool = self._start_pool(client, jump_client, jump_channel, pool_size, functools.partial(
+                    self._open_session, host, port, username, password, use_key, key_path, key_passphrase,
+                    use_jump, jump_host, jump_port, jump_username, jump_password,
+                    jump_use_key, jump_key_path, jump_key_passphrase,
+                ))
+                opener = self.transport_pool
+            if remote_helper or udp_transport:
+                self.remote_helper = self._start_remote_helper(opener, host if udp_transport else "")
+                if self.remote_helper:
+                    opener = self.remote_helper
+
+            self._start_proxies(opener, socks_port, http_port)
+
+            if control_path:
+                try:
+                    self.control_master = ControlMasterServer(opener, control_path, identity)
+                    self.control_master.start()
+                    self._log(f"共享会话主实例已就绪: {control_path}")
+                except Exception as e:
+                    self.control_master = None
+                    self._log(f"⚠️ 共享会话控制套接字启动失败: {e}")
 
             self._connected = True
             self._log(f"连接成功！流量将通过 {host} 转发")
             self._notify_status("connected", f"已连接: {host}")
 
+            self._start_stats()
             self._start_monitor()
 
         except paramiko.AuthenticationException:
@@ -440,9 +905,338 @@ class SshTunnelManager:
             self._notify_status("disconnected", msg)
             raise Exception(msg)
 
-    def disconnect(self):
+    def _open_session(self, host: str, port: int, username: str, password: str,
+                      use_key: bool, key_path: str, key_passphrase: str,
+                      use_jump: bool, jump_host: str, jump_port: int,
+                      jump_username: str, jump_password: str,
+                      jump_use_key: bool, jump_key_path: str, jump_key_passphrase: str,
+                      tuning: Optional[TuningProfile] = None) -> tuple:
+        """建立 SSH 会话 (可经跳板机)，返回 (client, jump_client, jump_channel)"""
+        client = paramiko.SSHClient()
+        client.set_missing_host_key_policy(paramiko.AutoAddPolicy())
+
+        if use_jump:
+            self._log(f"正在连接跳板机 {jump_host}:{jump_port} ...")
+            jump_client = paramiko.SSHClient()
+            jump_client.set_missing_host_key_policy(paramiko.AutoAddPolicy())
+            try:
+                _connect_ssh(
+                    jump_client,
+                    hostname=jump_host,
+                    port=jump_port,
+                    username=jump_username,
+                    password=jump_password,
+                    use_key=jump_use_key,
+                    key_path=jump_key_path,
+                    key_passphrase=jump_key_passphrase,
+                    log=self._log,
+                )
+            except paramiko.AuthenticationException:
+                raise Exception("跳板机认证失败：用户名/密码/私钥不匹配")
+            except Exception as e:
+                raise Exception(f"跳板机登录失败: {e}")
+
+            jump_transport = jump_client.get_transport()
+            if jump_transport is None or not jump_transport.is_active():
+                raise Exception("跳板机连接成功但 Transport 不可用")
+            self._keepalive(jump_transport)
+            # 经跳板机时真实的 TCP 连接在跳板机这一跳，目标会话承载在其通道内
+            apply_transport(jump_transport, tuning or self.tuning)
+            if self.placement:
+                self.placement.pin_transport(jump_transport)
+            self._log("跳板机会话已建立 ✓")
+
+            self._log("正在通过跳板机建立目标会话...")
+            try:
+                jump_channel = jump_transport.open_channel(
+                    "direct-tcpip",
+                    (host, port),
+                    ("127.0.0.1", 0),
+                    timeout=20,
+                )
+            except Exception as e:
+                raise Exception(f"跳板机到目标机转发失败(请检查跳板机 AllowTcpForwarding): {e}")
+
+            try:
+                _connect_ssh(
+                    client,
+                    hostname=host,
+                    port=port,
+                    username=username,
+                    password=password,
+                    use_key=use_key,
+                    key_path=key_path,
+                    key_passphrase=key_passphrase,
+                    sock=jump_channel,
+                    log=self._log,
+                )
+            except paramiko.AuthenticationException:
+                # 这里的认证失败应当按“目标机当前选择的方式”解释
+                if use_key:
+                    raise Exception("目标机公钥认证失败：请确认目标机用户名正确，且公钥已加入 authorized_keys")
+                raise Exception("目标机密码认证失败：用户名或密码错误")
+            except Exception as e:
+                raise Exception(f"目标机登录失败(经跳板机): {e}")
+        else:
+            jump_client, jump_channel = None, None
+            self._log("正在建立SSH会话...")
+            try:
+                _connect_ssh(
+                    client,
+                    hostname=host,
+                    port=port,
+                    username=username,
+                    password=password,
+                    use_key=use_key,
+                    key_path=key_path,
+                    key_passphrase=key_passphrase,
+                    log=self._log,
+                )
+            except paramiko.AuthenticationException:
+                if use_key:
+                    raise Exception("公钥认证失败：请确认用户名正确，且公钥已加入 authorized_keys")
+                raise Exception("密码认证失败：用户名或密码错误")
+        self._log("SSH会话已建立 ✓")
+
+        transport = client.get_transport()
+        if transport is None:
+            raise Exception("SSH Transport 创建失败")
+        self._keepalive(transport)
+
+        applied = apply_transport(transport, tuning or self.tuning)
+        if applied:
+            self._log(f"传输套接字调优 [{(tuning or self.tuning).name}]: {', '.join(applied)}")
+        if self.placement and self.placement.pin_transport(transport):
+            self._log(f"线程放置 {self.placement.describe()}")
+        return client, jump_client, jump_channel
+
+    def _keepalive(self, transport: paramiko.Transport):
+        if not (self.tickless and quiet_transport(transport, self.KEEPALIVE)):
+            transport.set_keepalive(self.KEEPALIVE)
+
+    def _start_pool(self, client, jump_client, jump_channel, size: int, factory) -> TransportPool:
+        pool = TransportPool(client, jump_client, jump_channel, factory, size, log=self._log,
+                             activity=self.activity)
+        pool.start()
+        self._log(f"传输池已启用: 按吞吐 / 重传自动增减 SSH 会话 (1 ~ {size} 条)")
+        return pool
+
+    def _start_remote_helper(self, transport: paramiko.Transport, udp_host: str = "") -> Optional[RemoteHelper]:
+        self._log("正在启动远端伴随进程...")
+        helper = RemoteHelper(transport, udp_host=udp_host)
+        try:
+            helper.start()
+        except Exception as e:
+            self._log(f"⚠️ 远端伴随进程不可用，使用 sshd 直连: {e}")
+            return None
+        self._log("远端伴随进程已就绪 ✓ (DNS 缓存 + Happy Eyeballs)")
+        if udp_host:
+            if helper.udp_alive:
+                self._log(f"UDP 数据通道已就绪 ✓ ({udp_host}:{helper.datagram.peer[1]})")
+            else:
+                self._log(f"⚠️ UDP 数据通道不可用，数据仍走 SSH: {helper.udp_error}")
+        return helper
+
+    def _start_proxies(self, transport, socks_port: int, http_port: int):
+        self.socks_server, self.http_proxy = self._start_listeners(
+            transport, socks_port, http_port, self.sniff, self.tuning)
+
+    def _start_listeners(self, transport, socks_port: int, http_port: int, sniff: bool = False,
+                         tuning: Optional[TuningProfile] = None) -> tuple:
+        # 启动SOCKS5代理
+        self._log(f"正在启动SOCKS5代理 (端口: {socks_port})...")
+        if self.engine == "asyncio":
+            socks_cls, http_cls, engine_name = AsyncSocks5Server, AsyncHttpProxyServer, "Python asyncio"
+        else:
+            socks_cls, http_cls, engine_name = Socks5Server, HttpProxyServer, "Python"
+        socks_server = socks_cls(transport, socks_port, sniff=sniff, tuning=tuning,
+                                 placement=self.placement, ledger=self.ledger, trace=self.trace,
+                                 activity=self.activity)
+        socks_server.start()
+
+        self._log(f"SOCKS5代理已启动 ✓ ({engine_name})")
+        self._log(f"SOCKS5 地址: 127.0.0.1:{socks_port}")
+
+        # 启动HTTP代理（将HTTP/HTTPS流量通过SOCKS5转发）
+        self._log(f"正在启动HTTP代理 (端口: {http_port})...")
+        http_proxy = http_cls(listen_port=http_port, socks_port=socks_port, tuning=tuning,
+                              placement=self.placement)
+        try:
+            http_proxy.start()
+        except Exception:
+            socks_server.stop()
+            raise
+        self._log(f"HTTP 代理已启动 ✓")
+        self._log(f"HTTP/HTTPS 地址: 127.0.0.1:{http_port}")
+        return socks_server, http_proxy
+
+    def add_exit(self, name: str, cfg: ServerConfig):
+        """挂载附加出口：连接 cfg 指定的服务器，并在 cfg 的 SOCKS/HTTP 端口上监听"""
+        with self._exits_lock:
+            if name in self.exits:
+                raise Exception(f"出口已存在: {name}")
+        self._log(f"[{name}] 正在连接出口 {cfg.host}:{cfg.port} ...")
+        try:
+            (key_path, key_passphrase, jump_username, jump_password,
+             jump_key_path, jump_key_passphrase) = _check_login(
+                cfg.username, cfg.password, cfg.use_key, cfg.key_path, cfg.key_passphrase,
+                cfg.use_jump, cfg.jump_username, cfg.jump_password,
+                cfg.jump_use_key, cfg.jump_key_path, cfg.jump_key_passphrase,
+            )
+            client, jump_client, jump_channel = self._open_session(
+                cfg.host, cfg.port, cfg.username, cfg.password,
+                cfg.use_key, key_path, key_passphrase,
+                cfg.use_jump, cfg.jump_host, cfg.jump_port, jump_username, jump_password,
+                cfg.jump_use_key, jump_key_path, jump_key_passphrase,
+                tuning=get_profile(cfg.tuning),
+            )
+            ex = _Exit(cfg.host, client, jump_client, jump_channel)
+            try:
+                opener = client.get_transport()
+                if cfg.pool_size > 1:
+                    ex.pool = self._start_pool(client, jump_client, jump_channel, cfg.pool_size, functools.partial(
+                        self._open_session, cfg.host, cfg.port, cfg.username, cfg.password,
+                        cfg.use_key, key_path, key_passphrase,
+                        cfg.use_jump, cfg.jump_host, cfg.jump_port, jump_username, jump_password,
+                        cfg.jump_use_key, jump_key_path, jump_key_passphrase,
+                        tuning=get_profile(cfg.tuning),
+                    ))
+                    opener = ex.pool
+                if cfg.remote_helper or cfg.udp_transport:
+                    ex.remote_helper = self._start_remote_helper(
+                        opener, cfg.host if cfg.udp_transport else "")
+                    if ex.remote_helper:
+                        opener = ex.remote_helper
+                ex.socks_server, ex.http_proxy = self._start_listeners(
+                    opener, cfg.socks_port, cfg.http_port, cfg.sniff, get_profile(cfg.tuning))
+            except Exception:
+                ex.close()
+                raise
+        except paramiko.AuthenticationException:
+            msg = f"[{name}] 出口认证失败：用户名/密码/私钥不匹配"
+            self._log(f"❌ {msg}")
+            raise Exception(msg)
+        except Exception as e:
+            msg = f"[{name}] 出口连接失败: {e}"
+            self._log(f"❌ {msg}")
+            raise Exception(msg)
+
+        with self._exits_lock:
+            self.exits[name] = ex
+        self._watch_session(client, jump_client)
+        self.activity.poke()
+        self._log(f"[{name}] 出口已就绪 ✓ SOCKS5 127.0.0.1:{cfg.socks_port} / HTTP 127.0.0.1:{cfg.http_port} → {cfg.host}")
+
+    def remove_exit(self, name: str):
+        with self._exits_lock:
+            ex = self.exits.pop(name, None)
+        if ex:
+            ex.close()
+            self.activity.poke()
+            self._log(f"[{name}] 出口已关闭")
+
+    def get_exit_stats(self) -> Dict[str, dict]:
+        """按出口返回流量统计 (不含主连接)；tcp 为该出口传输套接字的 TCP_INFO 采样"""
+        with self._exits_lock:
+            exits = list(self.exits.items())
+        result = {}
+        for name, ex in exits:
+            st = ex.socks_server.get_stats() if ex.socks_server else \
+                {"bytes_up": 0, "bytes_down": 0, "active": 0, "total": 0, "control_packets": 0}
+            st["tcp"] = ex.tcp_sampler.sample() if ex.tcp_sampler else None
+            result[name] = st
+        return result
+
+    def _attach_shared(self, control_path: str, identity: str, socks_port: int, http_port: int) -> bool:
+        """尝试作为从实例复用主实例的 SSH 会话；没有可用主实例，或主实例连接的不是
+        identity (user@host:port) 时返回 False"""
+        shared = ControlClientTransport(control_path, identity)
+        master = shared.probe()
+        if master is None:
+            return False
+        if master != identity:
+            self._log(f"⚠️ 共享会话主实例连接的是 {master or '未知服务器'}，与本次 {identity} 不符，不复用")
+            return False
+
+        self._log(f"发现共享会话主实例: {control_path}，跳过 SSH 握手与认证")
+        self._notify_status("connecting", "正在连接...")
+        self.disconnect()
+
+        self._shared_transport = shared
+        self._start_proxies(shared, socks_port, http_port)
+
+        self._connected = True
+        self._log("已复用共享 SSH 会话 ✓")
+        self._notify_status("connected", f"已连接 (共享会话): {control_path}")
+
+        self._start_stats()
+        self._start_monitor()
+        return True
+
+    def stop_accepting(self):
+        """关闭主连接与全部出口的监听端口，已建立的连接照常转发"""
+        # HTTP 代理先停: 它新接的请求还要经本地 SOCKS5 建立
+        for server in sorted(self._listeners(), key=lambda s: not isinstance(s, HttpProxyServer)):
+            server.stop_accepting()
+
+    def drain(self, timeout: float) -> int:
+        """停止接受新连接并等进行中的连接结束，最多 timeout 秒；返回仍未结束的连接数
+
+        等待挂在活动信号上 (连接结束时 SOCKS5 服务器会 poke)，剩余数变化时记一次日志。
+        """
+        self.stop_accepting()
+        servers = self._listeners()
+        deadline = time.monotonic() + timeout
+        last = None
+        while True:
+            token = self.activity.arm()
+            socks = sum(s.get_stats()["active"] for s in servers if isinstance(s, Socks5Server))
+            http = sum(s.get_stats()["active"] for s in servers if isinstance(s, HttpProxyServer))
+            left = deadline - time.monotonic()
+            if not socks and not http:
+                if last is not None:
+                    self._log("排空完成 ✓")
+                return 0
+            if left <= 0 or self._drain_aborted:
+                why = "已中止" if self._drain_aborted else f"超时 ({timeout:g} 秒)"
+                self._log(f"⚠️ 排空{why}，强制关闭剩余 SOCKS5 {socks} / HTTP {http} 个连接")
+                return max(socks, http)
+            if (socks, http) != last:
+                last = (socks, http)
+                self._log(f"正在排空: 剩余 SOCKS5 {socks} / HTTP {http} 个连接 (最多再等 {left:.0f} 秒)")
+            self.activity.wait(token, min(left, self.DRAIN_CHECK))
+
+    def abort_drain(self):
+        """让进行中与之后的 drain() 立即结束 (如 CLI 第二次 Ctrl+C)，下次 connect() 时复位"""
+        self._drain_aborted = True
+        self.activity.poke()
+
+    def _listeners(self) -> list:
+        with self._exits_lock:
+            exits = list(self.exits.values())
+        servers = [self.socks_server, self.http_proxy]
+        for ex in exits:
+            servers += [ex.socks_server, ex.http_proxy]
+        return [s for s in servers if s is not None]
+
+    def disconnect(self, drain_timeout: Optional[float] = None):
+        """断开全部连接
+
+        drain_timeout (默认取 connect 时设定的值) > 0 且仍连接着时先排空 (见 drain)：
+        计划内的切换 / 退出不打断进行中的下载，耗时不超过该期限。之后一次性关闭:
+        监听与剩余连接、共享会话主端、伴随进程、传输池、附加出口、SSH 会话。
+        """
+        if drain_timeout is None:
+            drain_timeout = self.drain_timeout
+        if drain_timeout > 0 and self.is_connected:
+            self.drain(drain_timeout)
         self._connected = False
 
+        if self.stats_publisher:
+            # 最后一次发布在关闭监听之前，保留断开时的累计值
+            self.stats_publisher.stop()
+            self.stats_publisher = None
+
         if self._c_proxy_proc:
             try:
                 self._c_proxy_proc.terminate()
@@ -459,62 +1253,218 @@ class SshTunnelManager:
             self.socks_server.stop()
             self.socks_server = None
 
-        if self.ssh_client:
-            try:
-                self.ssh_client.close()
-            except Exception:
-                pass
-            self.ssh_client = None
+        if self.control_master:
+            self.control_master.stop()
+            self.control_master = None
 
-        if self._jump_channel:
-            try:
-                self._jump_channel.close()
-            except Exception:
-                pass
-            self._jump_channel = None
+        if self.remote_helper:
+            self.remote_helper.stop()
+            self.remote_helper = None
 
-        if self.jump_client:
-            try:
-                self.jump_client.close()
-            except Exception:
-                pass
-            self.jump_client = None
+        if self.transport_pool:
+            self.transport_pool.close()
+            self.transport_pool = None
+
+        for name in list(self.exits):
+            self.remove_exit(name)
+
+        if self.ledger:
+            self.ledger.flush()
+
+        if self._shared_transport:
+            self._shared_transport.close()
+            self._shared_transport = None
+        self.tcp_sampler = None
+
+        close_session(self.ssh_client, self._jump_channel, self.jump_client)
+        self.ssh_client = None
+        self._jump_channel = None
+        self.jump_client = None
 
         self._log("已断开连接")
         self._notify_status("disconnected", "未连接")
 
     def get_stats(self) -> dict:
-        """获取流量统计"""
-        return {"bytes_up": 0, "bytes_down": 0, "active": 0, "total": 0}
+        """获取流量统计 (HTTP 代理流量也经由 SOCKS5，故以 SOCKS5 计数为准；含全部附加出口)
 
-    def _start_monitor(self):
-        self._monitor_thread = threading.Thread(target=self._monitor_loop, daemon=True)
-        self._monitor_thread.start()
+        tcp 为主连接传输套接字的 TCP_INFO 采样 (见 tcp_info.py)，与应用层流量对照可区分
+        网络瓶颈与本进程瓶颈；平台不支持或没有真实套接字时为 None。
+        """
+        total = {"bytes_up": 0, "bytes_down": 0, "active": 0, "total": 0, "control_packets": 0}
+        parts = list(self.get_exit_stats().values())
+        if self.socks_server:
+            parts.append(self.socks_server.get_stats())
+        for st in parts:
+            for k in total:
+                total[k] += st[k]
+        total["tcp"] = self.tcp_sampler.sample() if self.tcp_sampler else None
+        total["pool"] = self.transport_pool.stats() if self.transport_pool else None
+        return total
+
+    def get_open_latency(self) -> dict:
+        """通道建立耗时直方图 (含全部附加出口)"""
+        total = {"buckets": [0] * (len(OPEN_LATENCY_BUCKETS_MS) + 1), "sum": 0.0, "failed": 0}
+        with self._exits_lock:
+            servers = [ex.socks_server for ex in self.exits.values()]
+        servers.append(self.socks_server)
+        for server in servers:
+            if server is None:
+                continue
+            part = server.get_open_latency()
+            total["buckets"] = [a + b for a, b in zip(total["buckets"], part["buckets"])]
+            total["sum"] += part["sum"]
+            total["failed"] += part["failed"]
+        return total
+
+    def _stats_snapshot(self) -> dict:
+        st = self.get_stats()
+        lat = self.get_open_latency()
+        values = {
+            "bytes_up": st["bytes_up"],
+            "bytes_down": st["bytes_down"],
+            "connections_total": st["total"],
+            "control_packets": st["control_packets"],
+            "open_failed": lat["failed"],
+            "open_us_sum": int(lat["sum"] * 1e6),
+            "active": st["active"],
+            "exits": len(self.exits),
+            "connected": 1 if self.is_connected else 0,
+            "transports": st["pool"]["transports"] if st["pool"] else (1 if self.ssh_client else 0),
+        }
+        tcp = st["tcp"]
+        if tcp:
+            values.update({
+                "tcp_rtt_us": tcp["rtt_ms"] * 1000,
+                "tcp_rttvar_us": tcp["rttvar_ms"] * 1000,
+                "tcp_min_rtt_us": tcp["min_rtt_ms"] * 1000,
+                "tcp_cwnd": tcp["cwnd"],
+                "tcp_unacked": tcp["unacked"],
+                "tcp_notsent_bytes": tcp["notsent_bytes"],
+                "tcp_delivery_rate": tcp["delivery_rate"],
+                "tcp_pacing_rate": tcp["pacing_rate"],
+                "tcp_retrans": tcp["retrans_total"],
+                "tcp_bytes_retrans": tcp["bytes_retrans"],
+                "tcp_busy_us": tcp["busy_us"],
+                "tcp_rwnd_limited_us": tcp["rwnd_limited_us"],
+                "tcp_sndbuf_limited_us": tcp["sndbuf_limited_us"],
+            })
+        for bound, n in zip(OPEN_LATENCY_BUCKETS_MS, lat["buckets"]):
+            values[f"{OPEN_BUCKET_PREFIX}{bound}"] = n
+        values[f"{OPEN_BUCKET_PREFIX}inf"] = lat["buckets"][-1]
+        return values
+
+    def _open_trace(self, path: str):
+        """轨迹文件跨重连保持打开 (同一次采集的时间线连续)；路径变化时换新文件"""
+        if self.trace and self.trace.path == path:
+            return
+        if self.trace:
+            self.trace.close()
+        self.trace = open_recorder(path)
+        if self.trace:
+            self._log(f"轨迹采集已开启: {path}")
+
+    def _start_stats(self):
+        if not self.stats_path:
+            return
+        try:
+            self.stats_publisher = StatsPublisher(self.stats_path, self._stats_snapshot, activity=self.activity)
+            self.stats_publisher.start()
+            self._log(f"统计页已发布: {self.stats_path}")
+        except Exception as e:
+            self.stats_publisher = None
+            self._log(f"⚠️ 统计页创建失败: {e}")
+
+    def connect_config(self, cfg: ServerConfig):
+        """按 ServerConfig 连接"""
+        self.connect(
+            cfg.host, cfg.port, cfg.username, cfg.password,
+            cfg.socks_port, cfg.http_port,
+            use_key=cfg.use_key, key_path=cfg.key_path, key_passphrase=cfg.key_passphrase,
+            use_jump=cfg.use_jump,
+            jump_host=cfg.jump_host, jump_port=cfg.jump_port,
+            jump_username=cfg.jump_username, jump_password=cfg.jump_password,
+            jump_use_key=cfg.jump_use_key, jump_key_path=cfg.jump_key_path,
+            jump_key_passphrase=cfg.jump_key_passphrase,
+            control_path=cfg.control_path,
+            sniff=cfg.sniff,
+            remote_helper=cfg.remote_helper,
+            tuning=cfg.tuning,
+            placement=cfg.placement,
+            stats_path=cfg.stats_path,
+            ledger_path=cfg.ledger_path,
+            trace_path=cfg.trace_path,
+            engine=cfg.engine,
+            udp_transport=cfg.udp_transport,
+            pool_size=cfg.pool_size,
+            tickless=cfg.tickless,
+            drain_timeout=cfg.drain_timeout,
+        )
 
-    def _monitor_loop(self):
-        while self._connected:
+    def _start_monitor(self):
+        """会话结束时才检查：等待线程阻塞在传输线程的 join (共享会话为主实例的 WATCH 连接) 上，
+        空闲时不唤醒；附加出口在 add_exit 中各自登记"""
+        shared = self._shared_transport
+        if shared is not None:
+            watch(functools.partial(self._watch_shared, shared), self._session_ended, "shared-watch")
+        else:
+            self._watch_session(self.ssh_client, self.jump_client)
+
+    def _watch_session(self, client, jump_client):
+        for c in (client, jump_client):
+            transport = c.get_transport() if c is not None else None
+            if transport is not None:
+                watch(transport.join, self._session_ended, "session-watch")
+
+    def _watch_shared(self, shared: ControlClientTransport):
+        if shared.watch():
+            return
+        # 旧版本主实例不支持 WATCH，退回定时检查
+        while self._shared_transport is shared and shared.is_active():
             time.sleep(10)
-            if not self._connected:
-                break
-            try:
-                transport = self.ssh_client.get_transport() if self.ssh_client else None
-                if transport is None or not transport.is_active():
-                    self._log("⚠️ SSH连接已断开")
+
+    def _session_ended(self):
+        if self._connected:
+            self.check_alive()
+
+    def check_alive(self) -> bool:
+        """检查会话是否仍然存活；已断开时更新状态并返回 False
+
+        附加出口单独检查：某个出口断开只关闭该出口，不影响主连接。
+        """
+        with self._exits_lock:
+            dead = [name for name, ex in self.exits.items() if not ex.is_alive()]
+        for name in dead:
+            self._log(f"⚠️ [{name}] 出口连接已断开")
+            self.remove_exit(name)
+
+        try:
+            if self._shared_transport is not None:
+                if not self._shared_transport.is_active():
+                    self._log("⚠️ 共享会话主实例已退出")
                     self._connected = False
-                    self._notify_status("disconnected", "连接已中断")
-                    break
+                    self._notify_status("disconnected", "共享会话已中断")
+                    return False
+                return True
 
-                if self.jump_client:
-                    jump_transport = self.jump_client.get_transport()
-                    if jump_transport is None or not jump_transport.is_active():
-                        self._log("⚠️ 跳板机连接已断开")
-                        self._connected = False
-                        self._notify_status("disconnected", "跳板机连接已中断")
-                        break
-            except Exception:
+            transport = self.ssh_client.get_transport() if self.ssh_client else None
+            if transport is None or not transport.is_active():
+                self._log("⚠️ SSH连接已断开")
                 self._connected = False
                 self._notify_status("disconnected", "连接已中断")
-                break
+                return False
+
+            if self.jump_client:
+                jump_transport = self.jump_client.get_transport()
+                if jump_transport is None or not jump_transport.is_active():
+                    self._log("⚠️ 跳板机连接已断开")
+                    self._connected = False
+                    self._notify_status("disconnected", "跳板机连接已中断")
+                    return False
+        except Exception:
+            self._connected = False
+            self._notify_status("disconnected", "连接已中断")
+            return False
+        return True
 
     def _log(self, message: str):
         logger.info(message)
@@ -522,5 +1472,79 @@ class SshTunnelManager:
             self.on_log(message)
 
     def _notify_status(self, status: str, message: str):
+        self.activity.poke()
         if self.on_status_changed:
             self.on_status_changed(status, message)
+
+
+class TunnelGroup:
+    """在同一进程内同时运行多个隧道配置 (profile)
+
+    各 profile 拥有独立的服务器 / 跳板机 / 端口，但共用一个活动信号 (CLI 按它刷新)，
+    统计按 profile 分别上报。
+    """
+
+    def __init__(self):
+        self.managers: Dict[str, SshTunnelManager] = {}
+        self.activity = Activity()
+        self._drain_aborted = False
+
+        self.on_status_changed: Optional[Callable[[str, str, str], None]] = None
+        self.on_log: Optional[Callable[[str], None]] = None
+
+    def connect_all(self, profiles: List[ServerConfig]):
+        """依次连接所有 profile；任一失败则断开已连接的并抛出异常"""
+        names = [p.name or f"profile{i + 1}" for i, p in enumerate(profiles)]
+        if len(set(names)) != len(names):
+            raise Exception("profile 名称重复")
+        ports = [p.socks_port for p in profiles] + [p.http_port for p in profiles]
+        if len(set(ports)) != len(ports):
+            raise Exception("各 profile 的 SOCKS/HTTP 端口不能重复")
+
+        self._drain_aborted = False
+        try:
+            for name, cfg in zip(names, profiles):
+                mgr = SshTunnelManager()
+                mgr.activity = self.activity
+                mgr.on_log = lambda m, n=name: self._log(f"[{n}] {m}")
+                mgr.on_status_changed = lambda st, m, n=name: self._notify_status(n, st, m)
+                self.managers[name] = mgr
+                mgr.connect_config(cfg)
+        except Exception:
+            self.disconnect_all()
+            raise
+
+    def disconnect_all(self, drain_timeout: Optional[float] = None):
+        """断开全部 profile；排空共用一个期限: 先全部停止接受新连接，再依次等到同一截止时间"""
+        if drain_timeout is None:
+            drain_timeout = max((mgr.drain_timeout for mgr in self.managers.values()), default=0.0)
+        deadline = time.monotonic() + drain_timeout
+        if drain_timeout > 0:
+            for mgr in self.managers.values():
+                if mgr.is_connected:
+                    mgr.stop_accepting()
+        for mgr in self.managers.values():
+            # 中止过排空 (abort_drain) 后其余 profile 不再等待
+            mgr.disconnect(0.0 if self._drain_aborted else max(0.0, deadline - time.monotonic()))
+        self.managers.clear()
+
+    def abort_drain(self):
+        self._drain_aborted = True
+        for mgr in list(self.managers.values()):
+            mgr.abort_drain()
+
+    @property
+    def is_connected(self) -> bool:
+        return any(mgr.is_connected for mgr in self.managers.values())
+
+    def get_stats(self) -> Dict[str, dict]:
+        """按 profile 返回流量统计"""
+        return {name: mgr.get_stats() for name, mgr in self.managers.items()}
+
+    def _log(self, message: str):
+        if self.on_log:
+            self.on_log(message)
+
+    def _notify_status(self, name: str, status: str, message: str):
+        if self.on_status_changed:
+            self.on_status_changed(name, status, message)
@@ -0,0 +1,239 @@
+"""
+共享内存统计页 — 供外部监控进程无锁读取
+
+隧道定期把计数器 / 瞬时值 / 直方图桶写入一个内存映射文件，外部读者 (stats 命令、
+node exporter、另一进程中的 GUI 等) 直接映射该文件读取，读者数量与采样频率
+都不影响转发路径。写入用 seqlock 保护:
+  写者: seq 置为奇数 → 写值 → seq 置为偶数
+  读者: 读 seq → 拷贝值 → 再读 seq，两次相同且为偶数才采用，否则重试
+
+文件布局 (小端):
+  0   头部 64 字节: magic "SSHTSTAT", 版本, 字段数, seq, 写者 pid, 发布间隔 (ms), 更新时间
+  64  字段表: 每项 32 字节，首字节为类型 (c 计数器 / g 瞬时值 / h 直方图桶)，其后为字段名
+      直方图桶 open_ms_bucket_<上界> 为落在 (上一上界, 上界] 的次数，各桶独立计数 (不是 Prometheus
+      le 那样的累积计数)，导出为 Prometheus 直方图时须自行累加
+  ..  值区: 每字段一个 u64
+字段表在创建时写定，读者按字段名取值，新增字段不影响旧读者；布局不兼容时提升版本号。
+
+有活动信号时只在值变化时发布：快照与上次相同就停止定时发布，等下一次转发活动再继续，
+因此空闲时更新时间停在最后一次变化的时刻 (发布间隔是有变化时的刷新周期)。
+"""
+import logging
+import mmap
+import os
+import struct
+import threading
+import time
+from pathlib import Path
+from typing import Callable, Dict, List, Optional, Tuple
+
+logger = logging.getLogger(__name__)
+
+MAGIC = b"SSHTSTAT"
+VERSION = 2
+_HEADER = struct.Struct("<8sIIQIId")
+_HEADER_SIZE = 64
+_SEQ_OFFSET = 16
+_UPDATED_OFFSET = 32
+_NAME_SIZE = 32
+
+PUBLISH_INTERVAL = 0.25
+
+# 通道建立耗时直方图的桶上界 (毫秒)，最后一个桶为 +Inf
+OPEN_LATENCY_BUCKETS_MS = (1, 2, 5, 10, 25, 50, 100, 250, 500, 1000, 2500)
+# 直方图桶的字段名前缀，后接上界或 inf
+OPEN_BUCKET_PREFIX = "open_ms_bucket_"
+
+COUNTER, GAUGE, HISTOGRAM = "c", "g", "h"
+
+FIELDS: List[Tuple[str, str]] = [
+    (COUNTER, "bytes_up"),
+    (COUNTER, "bytes_down"),
+    (COUNTER, "connections_total"),
+    (COUNTER, "open_failed"),
+    (COUNTER, "open_us_sum"),
+    (COUNTER, "control_packets"),
+    (GAUGE, "active"),
+    (GAUGE, "exits"),
+    (GAUGE, "connected"),
+    (GAUGE, "transports"),
+    # 主连接传输套接字的 TCP_INFO (tcp_info.py)；时间单位微秒，速率单位字节/秒
+    (GAUGE, "tcp_rtt_us"),
+    (GAUGE, "tcp_rttvar_us"),
+    (GAUGE, "tcp_min_rtt_us"),
+    (GAUGE, "tcp_cwnd"),
+    (GAUGE, "tcp_unacked"),
+    (GAUGE, "tcp_notsent_bytes"),
+    (GAUGE, "tcp_delivery_rate"),
+    (GAUGE, "tcp_pacing_rate"),
+    (COUNTER, "tcp_retrans"),
+    (COUNTER, "tcp_bytes_retrans"),
+    (COUNTER, "tcp_busy_us"),
+    (COUNTER, "tcp_rwnd_limited_us"),
+    (COUNTER, "tcp_sndbuf_limited_us"),
+]
+FIELDS += [(HISTOGRAM, f"{OPEN_BUCKET_PREFIX}{b}") for b in OPEN_LATENCY_BUCKETS_MS + ("inf",)]
+
+
+def bucket_index(ms: float) -> int:
+    for i, bound in enumerate(OPEN_LATENCY_BUCKETS_MS):
+        if ms <= bound:
+            return i
+    return len(OPEN_LATENCY_BUCKETS_MS)
+
+
+class StatsPageWriter:
+    """统计页写者 (单写者)"""
+
+    def __init__(self, path: str, fields: List[Tuple[str, str]] = FIELDS,
+                 interval: float = PUBLISH_INTERVAL):
+        self.path = path
+        self.fields = fields
+        self._index = {name: i for i, (_, name) in enumerate(fields)}
+        self._values_offset = _HEADER_SIZE + _NAME_SIZE * len(fields)
+        self._seq = 0
+
+        size = self._values_offset + 8 * len(fields)
+        page = bytearray(size)
+        _HEADER.pack_into(page, 0, MAGIC, VERSION, len(fields), 0, os.getpid(),
+                          int(interval * 1000), time.time())
+        for i, (kind, name) in enumerate(fields):
+            entry = (kind + name).encode("ascii")[:_NAME_SIZE]
+            page[_HEADER_SIZE + i * _NAME_SIZE:_HEADER_SIZE + i * _NAME_SIZE + len(entry)] = entry
+
+        # 先写临时文件再替换，读者不会映射到半成品
+        Path(path).parent.mkdir(parents=True, exist_ok=True)
+        tmp = f"{path}.{os.getpid()}.tmp"
+        with open(tmp, "wb") as f:
+            f.write(page)
+        os.replace(tmp, path)
+
+        self._file = open(path, "r+b")
+        self._mm = mmap.mmap(self._file.fileno(), size)
+
+    def publish(self, values: Dict[str, int]):
+        self._seq += 1
+        struct.pack_into("<Q", self._mm, _SEQ_OFFSET, self._seq)
+        for name, value in values.items():
+            i = self._index.get(name)
+            if i is not None:
+                struct.pack_into("<Q", self._mm, self._values_offset + 8 * i, max(0, int(value)))
+        struct.pack_into("<d", self._mm, _UPDATED_OFFSET, time.time())
+        self._seq += 1
+        struct.pack_into("<Q", self._mm, _SEQ_OFFSET, self._seq)
+
+    def close(self):
+        try:
+            self._mm.close()
+            self._file.close()
+        except Exception:
+            pass
+
+
+class StatsPublisher:
+    """后台线程按固定间隔把 snapshot() 的结果写入统计页；给出 activity 时值不变就停下等活动"""
+
+    def __init__(self, path: str, snapshot: Callable[[], Dict[str, int]],
+                 interval: float = PUBLISH_INTERVAL, activity=None):
+        self.writer = StatsPageWriter(path, interval=interval)
+        self.snapshot = snapshot
+        self.interval = interval
+        self.activity = activity
+        self._stop = threading.Event()
+        self._thread = threading.Thread(target=self._loop, daemon=True)
+
+    def start(self):
+        self._thread.start()
+
+    def stop(self):
+        """停止发布，先写入最后一次快照"""
+        self._stop.set()
+        if self.activity:
+            self.activity.poke()
+        self._thread.join(timeout=3)
+        self._publish()
+        self.writer.close()
+
+    def _publish(self) -> Optional[Dict[str, int]]:
+        try:
+            values = self.snapshot()
+            self.writer.publish(values)
+            return values
+        except Exception as e:
+            logger.debug(f"统计页发布失败: {e}")
+            return None
+
+    def _loop(self):
+        last = None
+        while not self._stop.wait(self.interval):
+            values = self._publish()
+            if self.activity and values is not None and values == last:
+                token = self.activity.arm()
+                # 登记之后再确认一次，登记前的最后一次活动不会被漏掉
+                if not self._stop.is_set() and self._snapshot() == values:
+                    self.activity.wait(token)
+            last = values
+
+    def _snapshot(self) -> Optional[Dict[str, int]]:
+        try:
+            return self.snapshot()
+        except Exception:
+            return None
+
+
+class StatsPageReader:
+    """统计页读者：映射文件后按 seqlock 协议取得一致快照"""
+
+    def __init__(self, path: str):
+        self._file = open(path, "rb")
+        try:
+            self._mm = mmap.mmap(self._file.fileno(), 0, access=mmap.ACCESS_READ)
+        except Exception:
+            self._file.close()
+            raise
+        magic, version, count, _, self.pid, interval_ms, _ = _HEADER.unpack_from(self._mm, 0)
+        if magic != MAGIC or version != VERSION:
+            self.close()
+            raise Exception(f"不是可识别的统计页文件: {path}")
+        self.interval = interval_ms / 1000
+        self.fields = []
+        for i in range(count):
+            raw = self._mm[_HEADER_SIZE + i * _NAME_SIZE:_HEADER_SIZE + (i + 1) * _NAME_SIZE].rstrip(b"\0")
+            entry = raw.decode("ascii")
+            self.fields.append((entry[:1], entry[1:]))
+        self._values = struct.Struct(f"<{count}Q")
+        self._values_offset = _HEADER_SIZE + _NAME_SIZE * count
+
+    def read(self, retries: int = 1000) -> Tuple[float, Dict[str, int]]:
+        """返回 (更新时间, {字段名: 值})；写者长时间处于写入中时抛出异常"""
+        for _ in range(retries):
+            seq1 = struct.unpack_from("<Q", self._mm, _SEQ_OFFSET)[0]
+            if seq1 & 1:
+                time.sleep(0)
+                continue
+            values = self._values.unpack_from(self._mm, self._values_offset)
+            updated = struct.unpack_from("<d", self._mm, _UPDATED_OFFSET)[0]
+            if struct.unpack_from("<Q", self._mm, _SEQ_OFFSET)[0] == seq1:
+                return updated, {name: v for (_, name), v in zip(self.fields, values)}
+        raise Exception("统计页一直处于写入中")
+
+    def close(self):
+        try:
+            self._mm.close()
+        finally:
+            self._file.close()
+
+
+def histogram_quantile(values: Dict[str, int], q: float) -> Optional[float]:
+    """按桶上界估计通道建立耗时分位数 (毫秒)；无样本时返回 None"""
+    counts = [values.get(f"{OPEN_BUCKET_PREFIX}{b}", 0) for b in OPEN_LATENCY_BUCKETS_MS + ("inf",)]
+    total = sum(counts)
+    if not total:
+        return None
+    rank = q * total
+    seen = 0
+    for bound, n in zip(OPEN_LATENCY_BUCKETS_MS + (float("inf"),), counts):
+        seen += n
+        if seen >= rank:
+            return bound
+    return float("inf")
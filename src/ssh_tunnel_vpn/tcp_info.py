@@ -0,0 +1,181 @@
+"""
+SSH 传输套接字的 TCP_INFO 采样 — 区分网络瓶颈与本进程瓶颈
+
+吞吐上不去时，应用层计数只能看到"慢"，看不出是链路丢包 / RTT、对端接收窗口、
+本地发送缓冲，还是本进程 (加密 / 中继) 喂不饱连接。这里按 Linux struct tcp_info 的布局
+解析 getsockopt(TCP_INFO)，取出:
+  - RTT / rttvar / 最小 RTT、cwnd / ssthresh、在途 / 未发送字节
+  - 累计重传包数与重传字节、投递速率 (delivery rate)、调步速率 (pacing rate)
+  - 忙碌时间与其中受接收窗口 / 发送缓冲限制的时间 (内核 4.10+，按微秒累计)
+较老的内核返回的结构更短，缺少的字段不出现在结果里；非 Linux 平台或经跳板机时
+拿不到真实套接字则不采样。
+
+采样由统计的使用者驱动 (统计页发布、CLI / GUI 刷新)，不另开线程；区间量 (重传速率、
+受限时间占比) 按两次采样之差计算，两次采样间隔不足 MIN_INTERVAL 时沿用上一区间的结果。
+"""
+import socket
+import struct
+import threading
+import time
+from typing import Optional
+
+TCP_INFO = getattr(socket, "TCP_INFO", 11)
+_INFO_SIZE = 256
+
+# (字段名, 格式, 偏移)，按 include/uapi/linux/tcp.h 的 struct tcp_info
+_LAYOUT = (
+    ("state", "B", 0),
+    ("ca_state", "B", 1),
+    ("retransmits", "B", 2),
+    ("rto", "I", 8),
+    ("snd_mss", "I", 16),
+    ("unacked", "I", 24),
+    ("lost", "I", 32),
+    ("retrans", "I", 36),
+    ("rtt", "I", 68),
+    ("rttvar", "I", 72),
+    ("snd_ssthresh", "I", 76),
+    ("snd_cwnd", "I", 80),
+    ("total_retrans", "I", 100),
+    ("pacing_rate", "Q", 104),
+    ("bytes_acked", "Q", 120),
+    ("bytes_received", "Q", 128),
+    ("notsent_bytes", "I", 144),
+    ("min_rtt", "I", 148),
+    ("delivery_rate", "Q", 160),
+    ("busy_time", "Q", 168),
+    ("rwnd_limited", "Q", 176),
+    ("sndbuf_limited", "Q", 184),
+    ("bytes_sent", "Q", 200),
+    ("bytes_retrans", "Q", 208),
+)
+_FIELDS = tuple((name, struct.Struct("=" + fmt), off) for name, fmt, off in _LAYOUT)
+# 第 8 字节最低位: tcpi_delivery_rate_app_limited (投递速率样本受应用限制)
+_APP_LIMITED_BYTE = 7
+
+# 区间占比的最短采样间隔 (秒)
+MIN_INTERVAL = 1.0
+# 判定瓶颈的阈值: 受限时间占忙碌时间的比例、区间内重传包占发出包的比例
+LIMITED_SHARE = 0.3
+RETRANS_SHARE = 0.01
+
+
+def read_tcp_info(sock) -> Optional[dict]:
+    """读取一次 TCP_INFO，返回原始字段 (时间单位微秒，速率单位字节/秒)；不支持时返回 None"""
+    if not isinstance(sock, socket.socket):
+        return None
+    try:
+        raw = sock.getsockopt(socket.IPPROTO_TCP, TCP_INFO, _INFO_SIZE)
+    except (OSError, ValueError):
+        return None
+    info = {}
+    for name, st, off in _FIELDS:
+        if off + st.size <= len(raw):
+            info[name] = st.unpack_from(raw, off)[0]
+    if len(raw) > _APP_LIMITED_BYTE:
+        info["app_limited"] = raw[_APP_LIMITED_BYTE] & 1
+    return info
+
+
+def transport_socket(client, jump_client=None) -> Optional[socket.socket]:
+    """SSH 会话实际走的 TCP 套接字：经跳板机时是到跳板机的连接 (内层会话跑在通道上)"""
+    outer = jump_client or client
+    try:
+        transport = outer.get_transport() if outer is not None else None
+    except Exception:
+        return None
+    sock = getattr(transport, "sock", None)
+    return sock if isinstance(sock, socket.socket) else None
+
+
+class TcpInfoSampler:
+    """一个传输套接字的 TCP_INFO 采样器 (线程安全)"""
+
+    def __init__(self, sock: socket.socket):
+        self.sock = sock
+        self._lock = threading.Lock()
+        self._base: Optional[tuple] = None
+        self._interval = {}
+
+    def sample(self) -> Optional[dict]:
+        """返回当前值与最近一个区间的速率 / 占比；套接字已关闭或平台不支持时返回 None"""
+        info = read_tcp_info(self.sock)
+        if info is None:
+            return None
+        now = time.monotonic()
+        with self._lock:
+            if self._base is None:
+                self._base = (now, info)
+            elif now - self._base[0] >= MIN_INTERVAL:
+                self._interval = _interval(self._base, now, info)
+                self._base = (now, info)
+            interval = dict(self._interval)
+        return _summarize(info, interval)
+
+
+def _interval(base: tuple, now: float, info: dict) -> dict:
+    t0, prev = base
+    dt_us = (now - t0) * 1e6
+    out = {"interval_s": now - t0}
+    if "total_retrans" in info:
+        out["retrans_per_s"] = (info["total_retrans"] - prev["total_retrans"]) / (now - t0)
+    if "bytes_sent" in info and "bytes_retrans" in info:
+        sent = info["bytes_sent"] - prev["bytes_sent"]
+        out["retrans_share"] = (info["bytes_retrans"] - prev["bytes_retrans"]) / sent if sent > 0 else 0.0
+    if "busy_time" in info:
+        busy = info["busy_time"] - prev["busy_time"]
+        out["busy_share"] = min(busy / dt_us, 1.0)
+        for key in ("rwnd_limited", "sndbuf_limited"):
+            if key in info:
+                out[f"{key}_share"] = (info[key] - prev[key]) / busy if busy > 0 else 0.0
+    if "bytes_acked" in info:
+        out["acked_rate"] = (info["bytes_acked"] - prev["bytes_acked"]) / (now - t0)
+    if "bytes_received" in info:
+        out["received_rate"] = (info["bytes_received"] - prev["bytes_received"]) / (now - t0)
+    return out
+
+
+def _summarize(info: dict, interval: dict) -> dict:
+    out = {
+        "rtt_ms": info.get("rtt", 0) / 1000,
+        "rttvar_ms": info.get("rttvar", 0) / 1000,
+        "min_rtt_ms": info.get("min_rtt", 0) / 1000,
+        "cwnd": info.get("snd_cwnd", 0),
+        "cwnd_bytes": info.get("snd_cwnd", 0) * info.get("snd_mss", 0),
+        "ssthresh": info.get("snd_ssthresh", 0),
+        "unacked": info.get("unacked", 0),
+        "notsent_bytes": info.get("notsent_bytes", 0),
+        "retrans_total": info.get("total_retrans", 0),
+        "bytes_retrans": info.get("bytes_retrans", 0),
+        "delivery_rate": info.get("delivery_rate", 0),
+        "pacing_rate": info.get("pacing_rate", 0),
+        "busy_us": info.get("busy_time", 0),
+        "rwnd_limited_us": info.get("rwnd_limited", 0),
+        "sndbuf_limited_us": info.get("sndbuf_limited", 0),
+        "app_limited": info.get("app_limited", 0),
+    }
+    out.update(interval)
+    out["bottleneck"] = bottleneck(out)
+    return out
+
+
+def bottleneck(s: dict) -> str:
+    """按最近一个区间粗略判断吞吐受谁限制 (无区间数据时为空串)
+
+    受发送缓冲限制: 本地 SO_SNDBUF 不够 (调优档位)；受接收窗口限制: 对端 (sshd) 读得慢或
+    窗口太小；有明显重传: 链路丢包 / 拥塞；投递速率样本受应用限制、连接大部分时间空闲:
+    本进程没有喂满连接 (加密 / 中继 CPU 或上游本身慢)；其余为 cwnd 受限，即网络本身。
+    """
+    if "busy_share" not in s:
+        return ""
+    if s.get("sndbuf_limited_share", 0) >= LIMITED_SHARE:
+        return "发送缓冲"
+    if s.get("rwnd_limited_share", 0) >= LIMITED_SHARE:
+        return "对端接收窗口"
+    if s.get("retrans_share", 0) >= RETRANS_SHARE:
+        return "网络丢包"
+    if s["busy_share"] < 0.05:
+        return "空闲"
+    if s.get("app_limited"):
+        return "本进程"
+    return "网络 (cwnd)"
@@ -0,0 +1,190 @@
+"""
+空闲零唤醒 — 监听、监控、统计全部由事件驱动
+
+没有流量时进程本不该被唤醒，但以前各处都按固定间隔轮询:
+  - SOCKS5 / HTTP / 共享会话控制套接字的 accept 每 1 秒超时一次，只为检查 running
+  - 会话监控每 10 秒检查一次传输是否存活；统计页每 0.25 秒重写一次，GUI 3 秒、CLI 5 秒刷新
+  - paramiko 传输线程的套接字读超时固定 0.1 秒 (Transport._active_check_timeout)，
+    每条会话每秒唤醒 10 次，只为检查关闭标志与发送 SSH 保活
+这里提供替代的事件源:
+  - Waker: 自唤醒套接字对 (同 datagram.py 的 I/O 线程)；accept() 同时等监听套接字与它，
+    stop() 写一个字节即可让阻塞的 accept 返回
+  - Activity: 转发路径上的活动信号。统计的消费者看到快照没有变化时登记等待，
+    下一次计数 / 连接增减 / 状态变化时才被唤醒；没有消费者等待时 poke() 只读一个属性
+  - watch(): 等待线程阻塞在传输线程的 join 上，会话结束时回调，不定时检查
+  - quiet_transport(): 去掉 paramiko 传输线程的读超时，SSH 层保活改由内核 TCP keepalive 发送
+    (只在 tickless 模式下启用，见 SshTunnelManager.connect)。传输线程此时阻塞在 recv 上，
+    关闭会话前须先 shutdown 套接字 (close_session)，否则 close() 唤不醒它
+剩下的只有真正的截止时间: 传输池的缩容截止、流量账本的落盘截止、UDP 数据通道的重传 / 保活，
+都只在有待办时才设定。
+"""
+import logging
+import select
+import socket
+import threading
+from typing import Callable, Optional
+
+logger = logging.getLogger(__name__)
+
+# 内核 TCP keepalive: 空闲多久开始探测由调用方给出 (与原 SSH 保活间隔相同)，之后的探测间隔 / 次数
+KEEPALIVE_INTERVAL = 10
+KEEPALIVE_COUNT = 3
+
+
+class Waker:
+    """自唤醒套接字对：让阻塞在 select 上的线程立即返回"""
+
+    def __init__(self):
+        self._r, self._w = socket.socketpair()
+        self._r.setblocking(False)
+        self._w.setblocking(False)
+
+    def fileno(self) -> int:
+        return self._r.fileno()
+
+    def wake(self):
+        try:
+            self._w.send(b"\0")
+        except OSError:
+            pass
+
+    def close(self):
+        for s in (self._r, self._w):
+            try:
+                s.close()
+            except OSError:
+                pass
+
+
+def accept(server: socket.socket, waker: Waker) -> Optional[tuple]:
+    """阻塞等待新连接 (不设超时)；被 waker 唤醒时返回 None
+
+    监听套接字须为非阻塞：select 报告可读后连接可能已被对端重置，此时 accept 不应再阻塞。
+    """
+    while True:
+        r, _, _ = select.select([server, waker], [], [])
+        if waker in r:
+            return None
+        try:
+            conn, addr = server.accept()
+        except (BlockingIOError, InterruptedError, ConnectionAbortedError):
+            continue
+        conn.setblocking(True)
+        return conn, addr
+
+
+class Activity:
+    """转发活动信号 (线程安全)
+
+    消费者: token = arm()，再确认一次快照确实没变，然后 wait(token)；或 notify_next(回调)。
+    生产者: 每次计数 / 连接增减 / 状态变化调用 poke()，没有消费者登记时不加锁。
+    条件变量用可重入锁：CLI 的信号处理函数会在主线程里 poke()，主线程此时可能正持有它。
+    """
+
+    def __init__(self):
+        self._cond = threading.Condition()
+        self._armed = False
+        self._gen = 0
+        self._callbacks = []
+
+    def poke(self):
+        if not self._armed:
+            return
+        with self._cond:
+            self._armed = False
+            self._gen += 1
+            callbacks, self._callbacks = self._callbacks, []
+            self._cond.notify_all()
+        for cb in callbacks:
+            try:
+                cb()
+            except Exception as e:
+                logger.debug(f"活动回调异常: {e}")
+
+    def arm(self) -> int:
+        with self._cond:
+            self._armed = True
+            return self._gen
+
+    def wait(self, token: int, timeout: Optional[float] = None) -> bool:
+        """等到 arm() 之后的下一次活动；超时返回 False"""
+        with self._cond:
+            return self._cond.wait_for(lambda: self._gen != token, timeout)
+
+    def notify_next(self, callback: Callable[[], None]):
+        """下一次活动时 (在 poke 的线程里) 调用一次 callback"""
+        with self._cond:
+            self._armed = True
+            self._callbacks.append(callback)
+
+
+def watch(wait: Callable[[], object], callback: Callable[[], None], name: str = "session-watch"):
+    """后台线程执行阻塞的 wait() (如 Transport.join)，返回后调用 callback"""
+
+    def run():
+        try:
+            wait()
+        except Exception:
+            pass
+        callback()
+
+    threading.Thread(target=run, name=name, daemon=True).start()
+
+
+def _keepalive(sock: socket.socket, idle: int):
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_KEEPALIVE, 1)
+    # Linux: TCP_KEEPIDLE；macOS: TCP_KEEPALIVE；Windows 只有 SO_KEEPALIVE (系统默认参数)
+    idle_opt = getattr(socket, "TCP_KEEPIDLE", getattr(socket, "TCP_KEEPALIVE", None))
+    for opt, value in ((idle_opt, idle),
+                       (getattr(socket, "TCP_KEEPINTVL", None), KEEPALIVE_INTERVAL),
+                       (getattr(socket, "TCP_KEEPCNT", None), KEEPALIVE_COUNT)):
+        if opt is not None:
+            try:
+                sock.setsockopt(socket.IPPROTO_TCP, opt, value)
+            except OSError:
+                pass
+
+
+def quiet_transport(transport, keepalive: int) -> bool:
+    """去掉 paramiko 传输线程的 0.1 秒读超时 (须在认证完成后调用)
+
+    paramiko 的 SSH 保活只在读超时时检查，读不再超时后改由内核在 TCP 层保活与探测对端:
+    空闲 keepalive 秒后开始探测，对端失联时 recv 出错，传输线程随即结束。
+    经跳板机的内层会话读的是跳板机通道 (没有超时时阻塞在通道缓冲上)，保活由外层 TCP 承担。
+    重新协商密钥仍由收到的报文触发，空闲时本来也不需要。
+    """
+    sock = getattr(transport, "sock", None)
+    if sock is None or not hasattr(sock, "settimeout"):
+        return False
+    transport.set_keepalive(0)
+    if isinstance(sock, socket.socket):
+        try:
+            _keepalive(sock, keepalive)
+        except OSError as e:
+            logger.debug(f"TCP keepalive 设置失败，保留 SSH 保活: {e}")
+            transport.set_keepalive(keepalive)
+            return False
+    sock.settimeout(None)
+    return True
+
+
+def close_session(client, jump_channel=None, jump_client=None):
+    """关闭一条 SSH 会话 (可经跳板机)
+
+    先 shutdown 真实的传输套接字：阻塞在 recv 上的传输线程立即收到 EOF 退出；只 close()
+    时 Linux 不会唤醒另一个线程里阻塞的 recv，线程会一直挂到对端发来数据。
+    """
+    outer = jump_client or client
+    try:
+        transport = outer.get_transport() if outer is not None else None
+        sock = getattr(transport, "sock", None)
+        if isinstance(sock, socket.socket):
+            sock.shutdown(socket.SHUT_RDWR)
+    except Exception:
+        pass
+    for obj in (client, jump_channel, jump_client):
+        if obj is not None:
+            try:
+                obj.close()
+            except Exception:
+                pass
@@ -0,0 +1,125 @@
+"""
+连接级流量轨迹采集 — 供 benchmarks/bench_replay.py 按真实负载形状回放
+
+每条经 SOCKS5 的连接结束时写一行 JSON (JSONL，首行为文件头):
+  {"t": 相对采集开始的打开时刻 (秒), "dst": 目标哈希, "port": 端口, "open_ms": 通道建立耗时,
+   "dur": 持续时间 (秒), "up": 上行字节, "down": 下行字节,
+   "ev": [[相对打开的毫秒数, "u"/"d", 字节数], ...]}
+
+匿名化：目标主机名加每次采集随机生成的盐做 SHA-256，只保留前 12 个十六进制字符；
+盐不落盘，同一次采集内同一目标的哈希相同 (保留复用特征)，无法反推域名。
+同方向 1 毫秒内的数据合并为一个事件，每条连接最多 MAX_EVENTS 个事件，超出后并入最后一个。
+"""
+import hashlib
+import json
+import logging
+import os
+import threading
+import time
+from datetime import datetime
+from typing import Optional
+
+logger = logging.getLogger(__name__)
+
+TRACE_VERSION = 1
+MAX_EVENTS = 4096
+_COALESCE_MS = 1.0
+
+UP, DOWN = "u", "d"
+
+
+class ConnTrace:
+    """单条连接的时间线"""
+
+    __slots__ = ("_recorder", "t", "dst", "port", "open_ms", "_t0", "events", "up", "down")
+
+    def __init__(self, recorder: "TraceRecorder", dst: str, port: int, open_ms: float):
+        self._recorder = recorder
+        self._t0 = time.monotonic()
+        self.t = self._t0 - recorder.start
+        self.dst = dst
+        self.port = port
+        self.open_ms = open_ms
+        self.events = []
+        self.up = 0
+        self.down = 0
+
+    def add(self, direction: str, n: int):
+        ms = (time.monotonic() - self._t0) * 1000
+        if direction == UP:
+            self.up += n
+        else:
+            self.down += n
+        events = self.events
+        if events and events[-1][1] == direction and \
+                (ms - events[-1][0] < _COALESCE_MS or len(events) >= MAX_EVENTS):
+            events[-1][2] += n
+        else:
+            events.append([round(ms, 3), direction, n])
+
+    def close(self):
+        self._recorder._write({
+            "t": round(self.t, 6),
+            "dst": self.dst,
+            "port": self.port,
+            "open_ms": round(self.open_ms, 3),
+            "dur": round(time.monotonic() - self._t0, 6),
+            "up": self.up,
+            "down": self.down,
+            "ev": self.events,
+        })
+
+
+class TraceRecorder:
+    """轨迹文件写者 (线程安全，每条连接结束时追加一行)"""
+
+    def __init__(self, path: str):
+        self.path = path
+        self.start = time.monotonic()
+        self._salt = os.urandom(16)
+        self._lock = threading.Lock()
+        os.makedirs(os.path.dirname(os.path.abspath(path)), exist_ok=True)
+        self._file = open(path, "w", encoding="utf-8")
+        self._file.write(json.dumps({
+            "version": TRACE_VERSION,
+            "started": datetime.now().isoformat(timespec="seconds"),
+        }) + "\n")
+        self._file.flush()
+        self.connections = 0
+
+    def begin(self, host: str, port: int, open_ms: float) -> ConnTrace:
+        digest = hashlib.sha256(self._salt + host.lower().encode("utf-8", "replace")).hexdigest()[:12]
+        return ConnTrace(self, digest, port, open_ms)
+
+    def _write(self, record: dict):
+        line = json.dumps(record, separators=(",", ":")) + "\n"
+        with self._lock:
+            if self._file is None:
+                return
+            try:
+                self._file.write(line)
+                self._file.flush()
+                self.connections += 1
+            except Exception as e:
+                logger.debug(f"轨迹写入失败: {e}")
+
+    def close(self):
+        with self._lock:
+            if self._file is not None:
+                self._file.close()
+                self._file = None
+
+
+def load_trace(path: str) -> tuple:
+    """读取轨迹文件，返回 (文件头, 按打开时刻排序的连接列表)"""
+    with open(path, encoding="utf-8") as f:
+        header = json.loads(f.readline() or "{}")
+        if header.get("version") != TRACE_VERSION:
+            raise Exception(f"不支持的轨迹文件版本: {header.get('version')}")
+        conns = [json.loads(line) for line in f if line.strip()]
+    conns.sort(key=lambda c: c["t"])
+    return header, conns
+
+
+def open_recorder(path: str) -> Optional[TraceRecorder]:
+    return TraceRecorder(path) if path else None
@@ -0,0 +1,295 @@
+"""
+SSH 传输池 — 按利用率与丢包自动增减 SSH 会话
+
+一条 SSH 会话就是一条 TCP 连接加 paramiko 的一个传输线程 (加解密都在这个线程里)，吞吐受
+cwnd / 丢包和单核加密速度限制；固定开多条又在空闲时白占服务器的会话。TransportPool 提供与
+paramiko.Transport 相同的 open_channel() / open_session() / is_active()，可直接交给
+Socks5Server / RemoteHelper / ControlMasterServer:
+  - 新通道分给在途通道最少的会话，正在排空的会话不再分配
+  - 扩容: 全部会话的吞吐 (TCP_INFO 的确认 + 接收字节速率) 连续 GROW_AFTER 次采样接近各自的
+    实测上限 (观测到的最高速率，缓慢衰减)；或某条会话承载多个通道时区间重传占比超过
+    LOSS_SHARE 且连接持续忙碌 (丢包让整条 TCP 的全部通道一起等重传)。新会话在后台建立，
+    完成认证与调优后才加入池接收新通道
+  - 缩容: 池内没有通道或总吞吐低于 IDLE_RATE，持续 IDLE_AFTER 秒后排空最新的一条多余会话:
+    不再分配新通道，已有通道全部结束后才关闭
+  - 滞回: 扩缩容后 COOLDOWN 秒内不再调整；上限 max_size，主会话始终保留 (由管理器关闭)
+采样线程只在有通道时每 SAMPLE_INTERVAL 秒采样一次；没有通道时只等缩容截止时间或新通道唤醒，
+没有多余会话时不唤醒。只有主会话、通道都空闲 (连续 QUIET_AFTER 次采样低于 IDLE_RATE，
+如挂起的长连接) 时也停止采样，等下一次转发活动 (tickless.Activity) 唤醒。
+依赖 TCP_INFO (Linux)，拿不到时不按吞吐 / 丢包扩容。
+"""
+import logging
+import threading
+import time
+from typing import Callable, List, Optional
+
+from .tcp_info import TcpInfoSampler, transport_socket
+from .tickless import Activity, close_session
+
+logger = logging.getLogger(__name__)
+
+SAMPLE_INTERVAL = 2.0
+# 吞吐达到实测上限的这个比例算"接近上限"
+UTILIZATION = 0.8
+# 低于此吞吐 (字节/秒) 不因利用率扩容 (稳定的小流量也会贴着自己的上限)
+GROW_MIN_RATE = 1 << 20
+GROW_AFTER = 3
+LOSS_SHARE = 0.01
+LOSS_BUSY_SHARE = 0.5
+# 实测上限每次采样的衰减系数 (约 5 分钟衰减到一半)
+CEILING_DECAY = 0.995
+IDLE_RATE = 64 * 1024
+IDLE_AFTER = 120.0
+COOLDOWN = 30.0
+# 唤醒后的第一次采样覆盖整个空闲期，须再有一个完整采样区间确认仍空闲才停止采样
+QUIET_AFTER = 2
+
+
+class _Member:
+    """池中的一条 SSH 会话"""
+
+    def __init__(self, client, jump_client=None, jump_channel=None, primary: bool = False):
+        self.client = client
+        self.jump_client = jump_client
+        self.jump_channel = jump_channel
+        self.transport = client.get_transport()
+        self.primary = primary
+        sock = transport_socket(client, jump_client)
+        self.sampler = TcpInfoSampler(sock) if sock else None
+        self.channels: List = []
+        self.ceiling = 0.0
+        self.rate = 0.0
+        self.hot = 0
+        self.draining = False
+
+    def alive(self) -> bool:
+        return self.transport is not None and self.transport.is_active()
+
+    def prune(self) -> int:
+        self.channels = [ch for ch in self.channels if not ch.closed]
+        return len(self.channels)
+
+    def close(self):
+        close_session(self.client, self.jump_channel, self.jump_client)
+
+
+class TransportPool:
+    """主会话 + 按需增减的附加会话
+
+    factory() 建立一条新的已认证会话，返回 (client, jump_client, jump_channel)
+    (即 SshTunnelManager._open_session 的结果)。
+    """
+
+    def __init__(self, client, jump_client, jump_channel, factory: Callable[[], tuple],
+                 max_size: int, log: Optional[Callable[[str], None]] = None,
+                 activity: Optional[Activity] = None):
+        self.factory = factory
+        self.activity = activity
+        self.max_size = max(1, max_size)
+        self._log = log or logger.info
+        self._primary = _Member(client, jump_client, jump_channel, primary=True)
+        self._members: List[_Member] = [self._primary]
+        self._lock = threading.Lock()
+        self._wake = threading.Event()
+        self._idle_wait = True
+        self._running = False
+        self._thread: Optional[threading.Thread] = None
+        self._growing = False
+        self._last_change = 0.0
+        self._last_sample = 0.0
+        self._idle_since: Optional[float] = None
+        self._quiet = 0
+        self.grown = 0
+        self.shrunk = 0
+
+    # ---- Transport 接口 ----
+
+    def open_channel(self, kind, dest_addr=None, src_addr=None, timeout=None, **kwargs):
+        with self._lock:
+            candidates = [m for m in self._members if not m.draining and m.alive()] or [self._primary]
+            member = min(candidates, key=lambda m: len(m.channels))
+        channel = member.transport.open_channel(kind, dest_addr, src_addr, timeout=timeout, **kwargs)
+        with self._lock:
+            member.channels.append(channel)
+            wake = self._idle_wait
+            self._idle_wait = False
+        if wake:
+            self._wake.set()
+        return channel
+
+    def open_session(self, **kwargs):
+        return self._primary.transport.open_session(**kwargs)
+
+    def is_active(self) -> bool:
+        return self._primary.alive()
+
+    # ---- 生命周期 ----
+
+    def start(self):
+        self._running = True
+        self._last_change = time.monotonic()
+        self._thread = threading.Thread(target=self._run, name="transport-pool", daemon=True)
+        self._thread.start()
+
+    def close(self):
+        """停止调度并关闭全部附加会话 (主会话由管理器关闭)"""
+        self._running = False
+        self._wake.set()
+        if self._thread and self._thread is not threading.current_thread():
+            self._thread.join(timeout=3)
+        with self._lock:
+            extras = [m for m in self._members if not m.primary]
+            self._members = [self._primary]
+        for m in extras:
+            m.close()
+
+    def stats(self) -> dict:
+        with self._lock:
+            members = list(self._members)
+        return {
+            "transports": len(members),
+            "draining": sum(1 for m in members if m.draining),
+            "channels": [len(m.channels) for m in members],
+            "rates": [m.rate for m in members],
+            "grown": self.grown,
+            "shrunk": self.shrunk,
+        }
+
+    # ---- 调度 ----
+
+    def _run(self):
+        while self._running:
+            self._wake.wait(self._next_wait(time.monotonic()))
+            self._wake.clear()
+            if not self._running:
+                break
+            try:
+                self._evaluate(time.monotonic())
+            except Exception as e:
+                logger.debug(f"传输池调度异常: {e}")
+
+    def _next_wait(self, now: float) -> Optional[float]:
+        with self._lock:
+            busy = any(m.channels for m in self._members)
+            extras = len(self._members) > 1
+            quiet = busy and not extras and self._quiet >= QUIET_AFTER and self.activity is not None
+            # 没有通道 (或通道都空闲) 时由 open_channel 唤醒
+            self._idle_wait = not busy or quiet
+        if quiet:
+            self._quiet = 0
+            self.activity.notify_next(self._wake.set)
+            return None
+        if busy:
+            return max(0.0, self._last_sample + SAMPLE_INTERVAL - now)
+        if extras:
+            since = self._idle_since if self._idle_since is not None else now
+            return max(0.0, max(since + IDLE_AFTER, self._last_change + COOLDOWN) - now)
+        return None
+
+    def _evaluate(self, now: float):
+        with self._lock:
+            members = list(self._members)
+        live = 0
+        for m in members:
+            n = m.prune()
+            live += n
+            if m.primary:
+                continue
+            if not m.alive():
+                self._remove(m, "连接已断开")
+            elif m.draining and not n:
+                self._remove(m, "已排空")
+
+        with self._lock:
+            members = [m for m in self._members if not m.draining]
+        total = 0.0
+        reason = ""
+        if live and now - self._last_sample >= SAMPLE_INTERVAL:
+            self._last_sample = now
+            all_hot = True
+            for m in members:
+                s = m.sampler.sample() if m.sampler else None
+                if not s or "interval_s" not in s:
+                    all_hot = False
+                    continue
+                m.rate = s["acked_rate"] + s["received_rate"]
+                m.ceiling = max(m.rate, m.ceiling * CEILING_DECAY)
+                total += m.rate
+                saturated = m.rate >= GROW_MIN_RATE and m.rate >= UTILIZATION * m.ceiling
+                lossy = (len(m.channels) > 1 and s.get("retrans_share", 0) >= LOSS_SHARE
+                         and s.get("busy_share", 0) >= LOSS_BUSY_SHARE)
+                m.hot = m.hot + 1 if saturated or lossy else 0
+                if lossy and m.hot >= GROW_AFTER:
+                    reason = f"重传 {s['retrans_share']:.1%}"
+                if m.hot < GROW_AFTER:
+                    all_hot = False
+            if all_hot and not reason:
+                reason = f"吞吐接近上限 ({total / 1e6:.1f} MB/s)"
+            self._quiet = self._quiet + 1 if total < IDLE_RATE else 0
+        elif live:
+            total = sum(m.rate for m in members)
+        else:
+            for m in members:
+                m.rate = 0.0
+                m.hot = 0
+
+        cooled = now - self._last_change >= COOLDOWN
+        if reason and cooled:
+            self._idle_since = None
+            self._maybe_grow(reason, len(members))
+            return
+
+        if live and total >= IDLE_RATE:
+            self._idle_since = None
+            return
+        if self._idle_since is None:
+            self._idle_since = now
+        elif now - self._idle_since >= IDLE_AFTER and cooled:
+            extras = [m for m in members if not m.primary]
+            if extras:
+                victim = extras[-1]
+                victim.draining = True
+                self._last_change = now
+                self._idle_since = now
+                self.shrunk += 1
+                self._log(f"传输池缩容: 空闲 {IDLE_AFTER:.0f} 秒，排空一条会话 "
+                          f"(剩余 {len(members) - 1} 条，{len(victim.channels)} 个通道待结束)")
+                if not victim.prune():
+                    self._remove(victim, "已排空")
+
+    def _maybe_grow(self, reason: str, size: int):
+        if self._growing or size >= self.max_size:
+            return
+        self._growing = True
+        self._last_change = time.monotonic()
+        for m in self._members:
+            m.hot = 0
+        self._log(f"传输池扩容: {reason}，新建第 {size + 1} 条会话 (上限 {self.max_size})")
+        threading.Thread(target=self._grow, daemon=True).start()
+
+    def _grow(self):
+        try:
+            client, jump_client, jump_channel = self.factory()
+            member = _Member(client, jump_client, jump_channel)
+            if not self._running or not member.alive():
+                member.close()
+                return
+            with self._lock:
+                self._members.append(member)
+                n = len(self._members)
+            self.grown += 1
+            self._log(f"传输池扩容完成 ✓ 共 {n} 条会话")
+        except Exception as e:
+            self._log(f"⚠️ 传输池扩容失败: {e}")
+        finally:
+            self._last_change = time.monotonic()
+            self._growing = False
+
+    def _remove(self, member: _Member, why: str):
+        with self._lock:
+            if member not in self._members:
+                return
+            self._members.remove(member)
+            n = len(self._members)
+        member.close()
+        self._log(f"传输池: 关闭一条会话 ({why})，剩余 {n} 条")
@@ -0,0 +1,106 @@
+"""
+套接字调优档位 — 交互延迟 / 均衡 / 大流量吞吐
+
+一个档位同时决定:
+  - 本地客户端套接字 (SOCKS5 / HTTP 监听接入、HTTP→SOCKS5 上游): TCP_NODELAY、TCP_NOTSENT_LOWAT、收发缓冲
+  - SSH 传输套接字: 同上，外加拥塞控制算法 (Linux 可用时选 BBR) 和可选的 busy-poll
+  - 中继单次读写块大小，以及 SSH 通道窗口 / 最大包长
+
+默认档位 balanced 不设置任何套接字选项 (沿用系统默认)，中继块与通道窗口也与 paramiko 默认一致；
+latency / bulk 须显式选择。不支持的选项 (非 Linux、内核未加载 BBR、无 CAP_NET_ADMIN 等) 静默跳过。
+"""
+import logging
+import socket
+from dataclasses import dataclass
+from typing import Optional
+
+logger = logging.getLogger(__name__)
+
+# Linux 常量 (Python 未必导出)
+TCP_CONGESTION = getattr(socket, "TCP_CONGESTION", 13)
+TCP_NOTSENT_LOWAT = getattr(socket, "TCP_NOTSENT_LOWAT", 25)
+SO_BUSY_POLL = getattr(socket, "SO_BUSY_POLL", 46)
+
+
+@dataclass(frozen=True)
+class TuningProfile:
+    name: str
+    nodelay: Optional[bool]  # True 关闭 Nagle / False 由内核合并小包 / None 不设置
+    notsent_lowat: int      # 未发送数据上限 (字节)，0 为不设置
+    sndbuf: int             # 0 为系统默认 (自动调节)
+    rcvbuf: int
+    congestion: str         # 传输套接字拥塞控制算法，空为系统默认
+    busy_poll: int          # 传输套接字 busy-poll 微秒数，0 为关闭
+    relay_chunk: int        # 中继单次 recv 大小
+    window_size: int        # SSH 通道窗口
+    max_packet_size: int    # SSH 通道最大包长
+
+
+PROFILES = {
+    "latency": TuningProfile(
+        name="latency", nodelay=True, notsent_lowat=16 * 1024, sndbuf=0, rcvbuf=0,
+        congestion="bbr", busy_poll=50, relay_chunk=16 * 1024,
+        window_size=1024 * 1024, max_packet_size=16 * 1024,
+    ),
+    "balanced": TuningProfile(
+        name="balanced", nodelay=None, notsent_lowat=0, sndbuf=0, rcvbuf=0,
+        congestion="", busy_poll=0, relay_chunk=64 * 1024,
+        window_size=2 * 1024 * 1024, max_packet_size=32 * 1024,
+    ),
+    "bulk": TuningProfile(
+        name="bulk", nodelay=False, notsent_lowat=0, sndbuf=4 * 1024 * 1024, rcvbuf=4 * 1024 * 1024,
+        congestion="bbr", busy_poll=0, relay_chunk=256 * 1024,
+        window_size=8 * 1024 * 1024, max_packet_size=32 * 1024,
+    ),
+}
+
+DEFAULT_PROFILE = "balanced"
+
+
+def get_profile(name: Optional[str]) -> TuningProfile:
+    profile = PROFILES.get((name or DEFAULT_PROFILE).lower())
+    if profile is None:
+        raise Exception(f"未知的调优档位: {name} (可选: {', '.join(PROFILES)})")
+    return profile
+
+
+def _setsockopt(sock: socket.socket, level: int, opt: int, value) -> bool:
+    try:
+        sock.setsockopt(level, opt, value)
+        return True
+    except (OSError, AttributeError):
+        return False
+
+
+def apply_client_socket(sock: socket.socket, profile: TuningProfile):
+    """本地客户端套接字调优"""
+    if profile.nodelay is not None:
+        _setsockopt(sock, socket.IPPROTO_TCP, socket.TCP_NODELAY, 1 if profile.nodelay else 0)
+    if profile.notsent_lowat:
+        _setsockopt(sock, socket.IPPROTO_TCP, TCP_NOTSENT_LOWAT, profile.notsent_lowat)
+    if profile.sndbuf:
+        _setsockopt(sock, socket.SOL_SOCKET, socket.SO_SNDBUF, profile.sndbuf)
+    if profile.rcvbuf:
+        _setsockopt(sock, socket.SOL_SOCKET, socket.SO_RCVBUF, profile.rcvbuf)
+
+
+def apply_transport_socket(sock, profile: TuningProfile) -> list:
+    """SSH 传输套接字调优，返回实际生效的选项名 (经跳板机时传输层不是真实套接字，跳过)"""
+    if not isinstance(sock, socket.socket):
+        return []
+    applied = []
+    apply_client_socket(sock, profile)
+    if profile.nodelay is not None:
+        applied.append("nodelay" if profile.nodelay else "nagle")
+    if profile.congestion and _setsockopt(sock, socket.IPPROTO_TCP, TCP_CONGESTION, profile.congestion.encode()):
+        applied.append(profile.congestion)
+    if profile.busy_poll and _setsockopt(sock, socket.SOL_SOCKET, SO_BUSY_POLL, profile.busy_poll):
+        applied.append(f"busy_poll={profile.busy_poll}us")
+    return applied
+
+
+def apply_transport(transport, profile: TuningProfile) -> list:
+    """调优 paramiko.Transport：传输套接字 + 后续通道的窗口 / 最大包长"""
+    transport.default_window_size = profile.window_size
+    transport.default_max_packet_size = profile.max_packet_size
+    return apply_transport_socket(getattr(transport, "sock", None), profile)
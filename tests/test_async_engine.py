@@ -0,0 +1,128 @@
+"""async_engine.py 单元测试：socketpair 上的 recv_exact / recv_until 与事件驱动中继"""
+import asyncio
+import socket
+import threading
+
+import pytest
+
+from ssh_tunnel_vpn.async_engine import BufferPool, LoopThread, check_engine, recv_exact, recv_until
+
+
+def _pair():
+    a, b = socket.socketpair()
+    a.setblocking(False)
+    return a, b
+
+
+def _run(coro):
+    return asyncio.run(coro)
+
+
+async def _exact(sock, n):
+    return await recv_exact(asyncio.get_running_loop(), sock, n)
+
+
+async def _until(sock, data, marker, limit=65536):
+    return await recv_until(asyncio.get_running_loop(), sock, data, marker, limit)
+
+
+def test_recv_exact_across_segments():
+    a, b = _pair()
+
+    async def main():
+        loop = asyncio.get_running_loop()
+        loop.call_soon(b.sendall, b"\x05\x01")
+        loop.call_later(0.01, b.sendall, b"\x00\x03rest")
+        head = await recv_exact(loop, a, 4)
+        tail = await recv_exact(loop, a, 4)
+        return head, tail
+
+    try:
+        assert _run(main()) == (b"\x05\x01\x00\x03", b"rest")
+    finally:
+        a.close()
+        b.close()
+
+
+def test_recv_exact_peer_closed():
+    a, b = _pair()
+    b.sendall(b"ab")
+    b.close()
+    try:
+        with pytest.raises(ConnectionError):
+            _run(_exact(a, 3))
+    finally:
+        a.close()
+
+
+def test_recv_until_marker():
+    a, b = _pair()
+    try:
+        b.sendall(b"T / HTTP/1.1\r\nHost: x\r\n")
+        b.sendall(b"\r\nbody")
+        data = _run(_until(a, b"GE", b"\r\n\r\n"))
+        assert data.startswith(b"GET / HTTP/1.1\r\n")
+        assert b"\r\n\r\n" in data
+        # 已有 marker 时不再读取
+        assert _run(_until(a, b"x\r\n\r\n", b"\r\n\r\n")) == b"x\r\n\r\n"
+    finally:
+        a.close()
+        b.close()
+
+
+def test_recv_until_limit_and_eof():
+    a, b = _pair()
+    try:
+        b.sendall(b"x" * 100)
+        assert len(_run(_until(a, b"", b"\r\n\r\n", limit=50))) >= 50
+        b.close()
+        assert _run(_until(a, b"", b"\r\n\r\n")) == b""
+    finally:
+        a.close()
+
+
+def test_relay_forwards_and_finishes():
+    lt = LoopThread("test-loop")
+    lt.start(asyncio.sleep(3600))
+    a, a_peer = socket.socketpair()
+    b, b_peer = socket.socketpair()
+    counts = {True: 0, False: 0}
+    done = threading.Event()
+
+    def on_data(ctx, forward, n):
+        counts[forward] += n
+
+    def on_done(ctx):
+        a.close()
+        b.close()
+        done.set()
+
+    try:
+        lt.loop.call_soon_threadsafe(lt.start_relay, a, b, BufferPool(16), on_data, on_done)
+        a_peer.sendall(b"hello through the relay")
+        got = b""
+        while len(got) < 23:
+            got += b_peer.recv(100)
+        assert got == b"hello through the relay"
+        b_peer.sendall(b"back")
+        assert a_peer.recv(100) == b"back"
+        a_peer.close()
+        assert done.wait(3)
+        assert counts == {True: 23, False: 4}
+        assert b_peer.recv(100) == b""
+    finally:
+        b_peer.close()
+        lt.stop()
+
+
+def test_buffer_pool_and_engine_names():
+    pool = BufferPool(8, keep=1)
+    buf = pool.take()
+    assert len(buf) == 8
+    pool.give(buf)
+    pool.give(bytearray(8))
+    assert pool.take() is buf
+    assert check_engine(None) == "thread"
+    assert check_engine("AsyncIO") == "asyncio"
+    with pytest.raises(Exception):
+        check_engine("uring")
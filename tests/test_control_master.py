@@ -0,0 +1,102 @@
+"""control_master.py 单元测试：回环端口口令握手与 Unix 套接字对端核对"""
+import os
+import socket
+import threading
+
+import pytest
+
+pytest.importorskip("paramiko")
+from ssh_tunnel_vpn import control_master as cm  # noqa: E402
+
+COOKIE = b"c" * 64
+
+
+class _Master(cm.ControlMasterServer):
+    """只做握手的主实例 (不需要 SSH 会话)"""
+
+    def __init__(self, cookie):
+        super().__init__(None, "127.0.0.1:0")
+        self._cookie = cookie
+
+
+def _handshake(master_cookie, client_cookie):
+    a, b = socket.socketpair()
+    result = {}
+
+    def serve():
+        try:
+            result["authorized"] = _Master(master_cookie)._authorized(a)
+        finally:
+            a.close()
+
+    t = threading.Thread(target=serve)
+    t.start()
+    try:
+        b.settimeout(3)
+        cm._client_handshake(b, client_cookie)
+        return result, None
+    except Exception as e:
+        return result, e
+    finally:
+        b.close()
+        t.join()
+
+
+def test_handshake_same_cookie():
+    result, error = _handshake(COOKIE, COOKIE)
+    assert error is None
+    assert result["authorized"] is True
+
+
+def test_handshake_wrong_cookie_rejected_by_master():
+    result, error = _handshake(COOKIE, b"x" * 64)
+    assert error is not None
+    assert result["authorized"] is False
+
+
+def test_impostor_master_learns_nothing():
+    # 抢先监听端口的进程不知道口令：从实例拒绝继续，口令本身也从未发出
+    a, b = socket.socketpair()
+    seen = []
+
+    def impostor():
+        a.sendall(b"HELLO 00\n")
+        seen.append(a.recv(512))
+        a.sendall(b"AUTH " + b"0" * 64 + b"\n")
+
+    t = threading.Thread(target=impostor)
+    t.start()
+    try:
+        b.settimeout(3)
+        with pytest.raises(Exception):
+            cm._client_handshake(b, COOKIE)
+    finally:
+        t.join()
+        a.close()
+        b.close()
+    assert COOKIE not in seen[0]
+    # 没有质询 (例如旧协议或别的服务) 时同样拒绝
+    a, b = socket.socketpair()
+    a.sendall(b"SSH-2.0-OpenSSH\n")
+    b.settimeout(3)
+    with pytest.raises(Exception):
+        cm._client_handshake(b, COOKIE)
+    a.close()
+    b.close()
+
+
+@pytest.mark.skipif(not hasattr(socket, "AF_UNIX") or not hasattr(os, "getuid"), reason="需要 Unix 套接字")
+def test_unix_peer_check(tmp_path, monkeypatch):
+    path = str(tmp_path / "ctl")
+    srv = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    srv.bind(path)
+    srv.listen(1)
+    try:
+        with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as c:
+            c.connect(path)
+            cm._check_unix_peer(c, path)
+            monkeypatch.setattr(cm, "_peer_uid", lambda conn: os.getuid() + 1)
+            with pytest.raises(Exception):
+                cm._check_unix_peer(c, path)
+    finally:
+        srv.close()
@@ -0,0 +1,184 @@
+"""datagram.py 单元测试：报文加解密 / 认证、包号去重、ACK 帧编码、路径验证"""
+import socket
+import struct
+import time
+
+from ssh_tunnel_vpn.datagram import DatagramSession, _PacketNumbers, derive_keys, seal, unseal
+
+SECRET = bytes(range(32))
+
+
+def test_seal_unseal_round_trip():
+    c_send, c_recv = derive_keys(SECRET, client=True)
+    s_send, s_recv = derive_keys(SECRET, client=False)
+    pkt = seal(c_send, 7, b"hello server")
+    assert pkt[:8] == struct.pack(">Q", 7)
+    assert b"hello server" not in pkt
+    assert unseal(s_recv, pkt) == (7, b"hello server")
+    assert unseal(c_recv, seal(s_send, 8, b"hello client")) == (8, b"hello client")
+
+
+def test_tampering_rejected():
+    send, _ = derive_keys(SECRET, client=True)
+    _, recv = derive_keys(SECRET, client=False)
+    pkt = seal(send, 1, b"x" * 40)
+    # 包号 (头部) / 密文 / 认证标签 任一位翻转都认证失败
+    for pos in (0, 7, 8, 20, len(pkt) - 17, len(pkt) - 16, len(pkt) - 1):
+        bad = bytearray(pkt)
+        bad[pos] ^= 0x01
+        assert unseal(recv, bytes(bad)) is None
+    assert unseal(recv, pkt[:-1]) is None
+    assert unseal(recv, pkt[:24]) is None
+
+
+def test_keys_distinct_per_direction():
+    c_send, c_recv = derive_keys(SECRET, client=True)
+    s_send, s_recv = derive_keys(SECRET, client=False)
+    assert c_send == s_recv and c_recv == s_send
+    assert len({*c_send, *c_recv}) == 4
+    # 客户端发出的包不能被反射回客户端自己的接收方向
+    assert unseal(c_recv, seal(c_send, 1, b"reflect")) is None
+    # 不同会话密钥互不认可
+    other_send, _ = derive_keys(bytes(32), client=True)
+    assert unseal(s_recv, seal(other_send, 1, b"x")) is None
+
+
+def test_same_packet_number_same_keystream_only_per_direction():
+    c_send, _ = derive_keys(SECRET, client=True)
+    s_send, _ = derive_keys(SECRET, client=False)
+    assert seal(c_send, 1, bytes(16))[8:24] != seal(s_send, 1, bytes(16))[8:24]
+
+
+def test_duplicate_and_replay_rejected():
+    pns = _PacketNumbers()
+    assert pns.add(0)
+    assert pns.add(1)
+    assert not pns.add(1)
+    assert not pns.add(0)
+    assert pns.add(5)
+    assert not pns.add(5)
+    assert pns.ranges == [[5, 5], [0, 1]]
+    assert pns.largest == 5
+
+
+def test_adjacent_and_out_of_order_ranges_merge():
+    pns = _PacketNumbers()
+    for pn in (10, 12, 14, 11):
+        assert pns.add(pn)
+    assert pns.ranges == [[14, 14], [10, 12]]
+    assert pns.add(13)            # 填补空洞，两段合并
+    assert pns.ranges == [[10, 14]]
+    assert pns.add(9)             # 下沿扩展
+    assert pns.add(15)            # 上沿扩展
+    assert pns.add(7)
+    assert pns.add(8)             # 向下合并
+    assert pns.ranges == [[7, 15]]
+    assert pns.add(3)
+    assert pns.add(20)
+    assert pns.ranges == [[20, 20], [7, 15], [3, 3]]
+
+
+def test_trim_raises_floor():
+    pns = _PacketNumbers()
+    # 偶数包号各成一段，超过 MAX_RANGES 时丢弃最老的区间
+    for i in range(pns.MAX_RANGES + 2):
+        assert pns.add(2 * i)
+    assert len(pns.ranges) == pns.MAX_RANGES
+    assert pns.floor == 3
+    assert pns.ranges[-1] == [4, 4]
+    # floor 以下 (包括从未收到过的 1) 一律视为重复
+    for pn in (0, 1, 2):
+        assert not pns.add(pn)
+    assert pns.add(3)
+    assert pns.ranges[-1] == [3, 4]
+
+
+def test_ack_frame_encoding():
+    pns = _PacketNumbers()
+    assert pns.ack_frame() == b"\x02\x00"
+    for pn in (1, 2, 3, 7):
+        pns.add(pn)
+    assert pns.ack_frame() == bytes.fromhex(
+        "0202"
+        "0000000000000007" "0000000000000007"
+        "0000000000000001" "0000000000000003")
+
+
+def test_ack_frame_caps_ranges():
+    pns = _PacketNumbers()
+    for i in range(12):
+        pns.add(3 * i)
+    frame = pns.ack_frame()
+    assert frame[:2] == b"\x02\x08"
+    assert len(frame) == 2 + 8 * 16
+    # 只带最新的 8 个区间 (降序)
+    assert struct.unpack_from(">QQ", frame, 2) == (33, 33)
+    assert struct.unpack_from(">QQ", frame, 2 + 7 * 16) == (12, 12)
+
+
+def _wait(cond, timeout=3.0):
+    deadline = time.monotonic() + timeout
+    while not cond():
+        if time.monotonic() > deadline:
+            return False
+        time.sleep(0.01)
+    return True
+
+
+def test_peer_switch_requires_path_validation():
+    server_sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    server_sock.bind(("127.0.0.1", 0))
+    server = DatagramSession(server_sock, SECRET, client=False, on_stream=lambda conn: conn.close())
+    server.start()
+    client = DatagramSession.connect("127.0.0.1", server_sock.getsockname()[1], SECRET)
+    attacker = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    attacker.bind(("127.0.0.1", 0))
+    attacker.settimeout(3)
+    try:
+        assert _wait(lambda: server.peer is not None)
+        client_addr = server.peer
+        c_send, c_recv = derive_keys(SECRET, client=True)
+
+        # 中间人抢先从别的地址转发一个 (更新的) 合法报文: 只收到质询，发送方向不变
+        attacker.sendto(seal(c_send, 1000, b"\x01"), server_sock.getsockname())
+        pn, plain = unseal(c_recv, attacker.recv(2048))
+        assert plain[0] == 0x07 and len(plain) == 9
+        time.sleep(0.05)
+        assert server.peer == client_addr
+
+        # 回应不符的质询数据也不切换
+        attacker.sendto(seal(c_send, 1001, b"\x08" + bytes(8)), server_sock.getsockname())
+        time.sleep(0.05)
+        assert server.peer == client_addr
+
+        # 新地址能收到质询并原样回显 (真实的 NAT 重新映射) 才切换
+        attacker.sendto(seal(c_send, 1002, b"\x08" + plain[1:]), server_sock.getsockname())
+        assert _wait(lambda: server.peer == attacker.getsockname())
+    finally:
+        attacker.close()
+        client.close()
+        server.close()
+
+
+def test_path_challenge_answered_to_sender():
+    server_sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    server_sock.bind(("127.0.0.1", 0))
+    server = DatagramSession(server_sock, SECRET, client=False, on_stream=lambda conn: conn.close())
+    server.start()
+    client = DatagramSession.connect("127.0.0.1", server_sock.getsockname()[1], SECRET)
+    probe = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    probe.bind(("127.0.0.1", 0))
+    probe.settimeout(3)
+    try:
+        # 伴随进程发出的质询 (这里由测试代发) 须回到质询来的地址
+        s_send, s_recv = derive_keys(SECRET, client=False)
+        probe.sendto(seal(s_send, 1 << 20, b"\x07" + b"abcdefgh"), client.sock.getsockname())
+        replies = set()
+        while b"\x08abcdefgh" not in replies:
+            # 客户端同时会向这个新地址发自己的质询
+            replies.add(unseal(s_recv, probe.recv(2048))[1])
+        assert client.peer == server_sock.getsockname()
+    finally:
+        probe.close()
+        client.close()
+        server.close()
@@ -0,0 +1,134 @@
+"""ledger.py 单元测试：块编码 / CRC / 残块截断 / 压缩"""
+import os
+from datetime import date
+
+import pytest
+
+from ssh_tunnel_vpn import ledger
+from ssh_tunnel_vpn.ledger import (MAGIC, VERSION, TrafficLedger, decode_block, domain_suffix, encode_block,
+                                   iter_blocks, query, scan_blocks)
+
+ROWS = [(738000, "a.com", 10, 20, 1), (738001, "b.org", 3, 4, 2), (738001, "a.com", 1, 2, 1)]
+
+# encode_block(ROWS) 的固定字节: 块头 | 日期 | 域名编号 | 上行 | 下行 | 连接数 | 字符串表 | CRC32
+BLOCK = bytes.fromhex(
+    "424c4b3103000000d0420b00d1420b000b000000d0420b00d1420b00d1420b00"
+    "0000000001000000000000000a00000000000000030000000000000001000000"
+    "0000000014000000000000000400000000000000020000000000000001000000"
+    "0200000001000000612e636f6d00622e6f7267a129b138")
+
+HEADER = ledger._FILE_HEADER.pack(MAGIC, VERSION)
+
+
+def test_encode_fixed_bytes():
+    assert encode_block(ROWS) == BLOCK
+
+
+def test_decode_round_trip():
+    data = HEADER + BLOCK
+    [(offset, end, magic, day_min, day_max)] = scan_blocks(data)
+    assert (offset, end, magic, day_min, day_max) == (16, 16 + len(BLOCK) - 4, b"BLK1", 738000, 738001)
+    days, ids, ups, downs, conns, names = decode_block(data, offset, end)
+    rows = [(days[i], names[ids[i]], ups[i], downs[i], conns[i]) for i in range(len(days))]
+    assert rows == ROWS
+
+
+def test_crc_mismatch_is_ignored():
+    data = bytearray(HEADER + BLOCK)
+    data[16 + 40] ^= 0x01
+    [(offset, end, _, _, _)] = scan_blocks(data)
+    assert decode_block(data, offset, end) is None
+    assert list(iter_blocks(data)) == []
+
+
+def test_scan_stops_at_torn_tail():
+    data = HEADER + BLOCK + BLOCK[:50]
+    assert len(scan_blocks(data)) == 1
+    with pytest.raises(Exception):
+        scan_blocks(b"NOTLEDGR" + bytes(8))
+
+
+def test_query_date_range(tmp_path):
+    path = tmp_path / "ledger"
+    path.write_bytes(HEADER + BLOCK)
+    assert query(str(path)) == {"a.com": [11, 22, 2], "b.org": [3, 4, 2]}
+    assert query(str(path), since=738001) == {"a.com": [1, 2, 1], "b.org": [3, 4, 2]}
+    assert query(str(path), until=737999) == {}
+
+
+def test_torn_tail_truncated_on_open(tmp_path):
+    path = tmp_path / "ledger"
+    path.write_bytes(HEADER + BLOCK + BLOCK[:50])
+    lg = TrafficLedger(str(path), flush_interval=3600)
+    try:
+        assert lg._blocks == 1
+        assert path.read_bytes() == HEADER + BLOCK
+        # 截断后继续追加的块可读
+        lg.record("www.c.net", 5, 6)
+        lg.flush()
+        assert query(str(path))["c.net"] == [5, 6, 1]
+    finally:
+        lg.close()
+
+
+def _corrupt(block: bytes) -> bytes:
+    bad = bytearray(block)
+    bad[-1] ^= 0xff
+    return bytes(bad)
+
+
+def test_corrupt_block_in_middle_is_skipped(tmp_path, monkeypatch):
+    # 中间一个 CRC 不符的块: 打开时不截断，读取跳过它但保留其后的块，压缩时只丢弃它
+    path = tmp_path / "ledger"
+    later = encode_block([(738002, "c.net", 7, 8, 1)])
+    path.write_bytes(HEADER + BLOCK + _corrupt(BLOCK) + later)
+    expected = {"a.com": [11, 22, 2], "b.org": [3, 4, 2], "c.net": [7, 8, 1]}
+    assert query(str(path)) == expected
+
+    monkeypatch.setattr(ledger, "COMPACT_BLOCKS", 3)
+    lg = TrafficLedger(str(path), flush_interval=3600)
+    try:
+        assert lg._blocks == 3
+        assert path.read_bytes() == HEADER + BLOCK + _corrupt(BLOCK) + later
+        lg.record("d.org", 1, 1)
+        lg.flush()
+        assert lg._blocks == 0
+        assert [b[2] for b in scan_blocks(path.read_bytes())] == [b"BLKM"] * 2
+        # 2021-07 一个整月块 + 本月一个整月块，损坏块的数据不再出现
+        assert query(str(path)) == dict(expected, **{"d.org": [1, 1, 1]})
+    finally:
+        lg.close()
+
+
+def test_compaction(tmp_path, monkeypatch):
+    monkeypatch.setattr(ledger, "COMPACT_BLOCKS", 2)
+    path = tmp_path / "sub" / "ledger"
+    lg = TrafficLedger(str(path), flush_interval=3600)
+    try:
+        for i in range(3):
+            lg.record("a.example.com", 100, 10)
+            lg.record("b.example.co.uk", 1, 1)
+            lg.flush()
+        # 第 3 个追加块触发压缩：只剩本月的一个整月块
+        assert lg._blocks == 0
+        blocks = scan_blocks(path.read_bytes())
+        assert [b[2] for b in blocks] == [b"BLKM"]
+        assert query(str(path)) == {"example.com": [300, 30, 3], "example.co.uk": [3, 3, 3]}
+
+        lg.record("a.example.com", 1, 1)
+        lg.flush()
+        today = date.today().toordinal()
+        assert query(str(path), today, today)["example.com"] == [301, 31, 4]
+    finally:
+        lg.close()
+    assert not [n for n in os.listdir(path.parent) if n.endswith(".tmp")]
+    if os.name == "posix":
+        # 压缩替换后的文件与原账本一样只有本人可读
+        assert os.stat(path).st_mode & 0o777 == 0o600
+
+
+def test_domain_suffix():
+    assert domain_suffix("www.Example.COM.") == "example.com"
+    assert domain_suffix("a.b.example.co.uk") == "example.co.uk"
+    assert domain_suffix("10.0.0.1") == "10.0.0.1"
+    assert domain_suffix("[::1]") == "[::1]"
@@ -0,0 +1,58 @@
+"""sniff.py 单元测试：固定字节的 ClientHello / HTTP 请求"""
+from ssh_tunnel_vpn.sniff import first_data_complete, parse_http_host, parse_tls_sni, sniff_hostname
+
+# TLS 1.2 记录 + ClientHello，扩展: server_name("Example.COM") + supported_versions(TLS 1.3)
+CLIENT_HELLO_SNI = bytes.fromhex(
+    "160301004a010000460303000102030405060708090a0b0c0d0e0f1011121314"
+    "15161718191a1b1c1d1e1f00000213010100001b00000010000e00000b457861"
+    "6d706c652e434f4d002b0003020304")
+
+# 同上但不带 server_name 扩展
+CLIENT_HELLO_NO_SNI = bytes.fromhex(
+    "1603010036010000320303000102030405060708090a0b0c0d0e0f1011121314"
+    "15161718191a1b1c1d1e1f000002130101000007002b0003020304")
+
+
+def test_client_hello_with_sni():
+    assert parse_tls_sni(CLIENT_HELLO_SNI) == "example.com"
+    assert sniff_hostname(CLIENT_HELLO_SNI) == "example.com"
+
+
+def test_client_hello_without_sni():
+    assert parse_tls_sni(CLIENT_HELLO_NO_SNI) is None
+    assert sniff_hostname(CLIENT_HELLO_NO_SNI) is None
+
+
+def test_truncated_client_hello():
+    # 主机名收齐之前的任何截断：越界读取一律返回 None
+    name_end = CLIENT_HELLO_SNI.index(b"Example.COM") + len(b"Example.COM")
+    for n in range(name_end):
+        assert parse_tls_sni(CLIENT_HELLO_SNI[:n]) is None
+    assert parse_tls_sni(CLIENT_HELLO_SNI[:name_end]) == "example.com"
+
+
+def test_invalid_hostname_rejected():
+    bad = CLIENT_HELLO_SNI.replace(b"Example.COM", b"Exa/ple.COM")
+    assert parse_tls_sni(bad) is None
+
+
+def test_http_host():
+    req = b"GET / HTTP/1.1\r\nUser-Agent: t\r\nHost: WWW.Example.org:8080\r\n\r\n"
+    assert parse_http_host(req) == "www.example.org"
+    assert sniff_hostname(req) == "www.example.org"
+    assert parse_http_host(b"GET / HTTP/1.1\r\nHost: [::1]:80\r\n\r\n") is None
+    assert parse_http_host(b"SSH-2.0-OpenSSH\r\n") is None
+
+
+def test_first_data_complete():
+    assert not first_data_complete(b"")
+    # TLS: 按记录头长度收齐
+    assert not first_data_complete(CLIENT_HELLO_SNI[:4])
+    assert not first_data_complete(CLIENT_HELLO_SNI[:40])
+    assert first_data_complete(CLIENT_HELLO_SNI)
+    # HTTP: 收到头部结束
+    assert not first_data_complete(b"GE")
+    assert not first_data_complete(b"GET / HTTP/1.1\r\nHost: a")
+    assert first_data_complete(b"GET / HTTP/1.1\r\nHost: a\r\n\r\n")
+    # 其他协议不等待
+    assert first_data_complete(b"SSH-2.0-OpenSSH\r\n")
@@ -0,0 +1,98 @@
+"""stats_page.py 单元测试：写者 / 读者经 seqlock 往返"""
+import struct
+import threading
+
+import pytest
+
+from ssh_tunnel_vpn.stats_page import (COUNTER, FIELDS, GAUGE, OPEN_BUCKET_PREFIX, OPEN_LATENCY_BUCKETS_MS,
+                                       StatsPageReader, StatsPageWriter, bucket_index, histogram_quantile)
+
+_SEQ_OFFSET = 16
+
+
+def test_round_trip(tmp_path):
+    path = str(tmp_path / "stats")
+    writer = StatsPageWriter(path, interval=0.5)
+    writer.publish({"bytes_up": 123, "active": 4, f"{OPEN_BUCKET_PREFIX}inf": 2, "unknown": 9, "exits": -1})
+    reader = StatsPageReader(path)
+    try:
+        assert reader.fields == FIELDS
+        assert reader.interval == 0.5
+        updated, values = reader.read()
+        assert updated > 0
+        assert values["bytes_up"] == 123
+        assert values["active"] == 4
+        assert values[f"{OPEN_BUCKET_PREFIX}inf"] == 2
+        assert values["exits"] == 0          # 负值截断为 0
+        assert "unknown" not in values
+    finally:
+        reader.close()
+        writer.close()
+
+
+def test_reader_retries_while_write_in_progress(tmp_path):
+    path = str(tmp_path / "stats")
+    writer = StatsPageWriter(path, [(COUNTER, "a")])
+    writer.publish({"a": 1})
+    reader = StatsPageReader(path)
+    try:
+        # seq 为奇数表示写入中，读者不会采用
+        struct.pack_into("<Q", writer._mm, _SEQ_OFFSET, 3)
+        with pytest.raises(Exception):
+            reader.read(retries=10)
+        struct.pack_into("<Q", writer._mm, _SEQ_OFFSET, 4)
+        assert reader.read()[1] == {"a": 1}
+    finally:
+        reader.close()
+        writer.close()
+
+
+def test_concurrent_snapshots_are_consistent(tmp_path):
+    path = str(tmp_path / "stats")
+    fields = [(GAUGE, f"v{i}") for i in range(8)]
+    writer = StatsPageWriter(path, fields)
+    reader = StatsPageReader(path)
+    stop = threading.Event()
+
+    def write():
+        n = 0
+        while not stop.is_set():
+            n += 1
+            writer.publish({name: n for _, name in fields})
+
+    t = threading.Thread(target=write)
+    t.start()
+    try:
+        for _ in range(2000):
+            values = set(reader.read()[1].values())
+            assert len(values) == 1          # 一次快照内所有字段来自同一次发布
+    finally:
+        stop.set()
+        t.join()
+        reader.close()
+        writer.close()
+
+
+def test_rejects_other_version(tmp_path):
+    path = tmp_path / "stats"
+    StatsPageWriter(str(path), [(COUNTER, "a")]).close()
+    data = bytearray(path.read_bytes())
+    struct.pack_into("<I", data, 8, 1)
+    path.write_bytes(bytes(data))
+    with pytest.raises(Exception):
+        StatsPageReader(str(path))
+
+
+def test_buckets_and_quantile():
+    assert bucket_index(0.5) == 0
+    assert bucket_index(1) == 0
+    assert bucket_index(1.5) == 1
+    assert bucket_index(10_000) == len(OPEN_LATENCY_BUCKETS_MS)
+
+    assert histogram_quantile({}, 0.5) is None
+    # 各桶独立计数: (0,1] 1 次, (5,10] 2 次, (1000,2500] 1 次
+    values = {f"{OPEN_BUCKET_PREFIX}1": 1, f"{OPEN_BUCKET_PREFIX}10": 2, f"{OPEN_BUCKET_PREFIX}2500": 1}
+    assert histogram_quantile(values, 0.25) == 1
+    assert histogram_quantile(values, 0.5) == 10
+    assert histogram_quantile(values, 0.99) == 2500
+    assert histogram_quantile({f"{OPEN_BUCKET_PREFIX}inf": 3}, 0.5) == float("inf")
@@ -0,0 +1,131 @@
+"""tcp_info.py 单元测试：按 struct tcp_info 偏移解析固定的 TCP_INFO 字节块"""
+import socket
+import struct
+import sys
+
+import pytest
+
+from ssh_tunnel_vpn import tcp_info
+from ssh_tunnel_vpn.tcp_info import _interval, _summarize, bottleneck, read_tcp_info
+
+
+def _blob() -> bytes:
+    """按 include/uapi/linux/tcp.h 的偏移写入各字段 (本机字节序，与内核一致)"""
+    buf = bytearray(232)
+    buf[0], buf[1], buf[2] = 1, 4, 2                  # state / ca_state / retransmits
+    buf[7] = 0x01                                     # delivery_rate_app_limited
+    for fmt, off, value in (
+            ("I", 8, 204000), ("I", 16, 1448), ("I", 24, 30), ("I", 32, 2), ("I", 36, 1),
+            ("I", 68, 12345), ("I", 72, 678), ("I", 76, 40), ("I", 80, 64), ("I", 100, 9),
+            ("Q", 104, 5_000_000), ("Q", 120, 1 << 33), ("Q", 128, 777), ("I", 144, 4096),
+            ("I", 148, 10000), ("Q", 160, 2_500_000), ("Q", 168, 3_000_000), ("Q", 176, 1_000_000),
+            ("Q", 184, 250_000), ("Q", 200, 10_000_000), ("Q", 208, 50_000)):
+        struct.pack_into("=" + fmt, buf, off, value)
+    return bytes(buf)
+
+
+class _FakeSocket(socket.socket):
+    """getsockopt(TCP_INFO) 返回固定字节块的套接字"""
+
+    def __init__(self, raw: bytes):
+        super().__init__(socket.AF_INET, socket.SOCK_STREAM)
+        self.raw = raw
+
+    def getsockopt(self, level, opt, size=0):
+        assert (level, opt, size) == (socket.IPPROTO_TCP, tcp_info.TCP_INFO, 256)
+        return self.raw[:size]
+
+
+def _read(raw: bytes) -> dict:
+    with _FakeSocket(raw) as s:
+        return read_tcp_info(s)
+
+
+def test_offsets_from_fixed_blob():
+    info = _read(_blob())
+    assert info["state"] == 1
+    assert info["ca_state"] == 4
+    assert info["retransmits"] == 2
+    assert info["rto"] == 204000
+    assert info["snd_mss"] == 1448
+    assert info["unacked"] == 30
+    assert info["lost"] == 2
+    assert info["retrans"] == 1
+    assert info["rtt"] == 12345
+    assert info["rttvar"] == 678
+    assert info["snd_ssthresh"] == 40
+    assert info["snd_cwnd"] == 64
+    assert info["total_retrans"] == 9
+    assert info["pacing_rate"] == 5_000_000
+    assert info["bytes_acked"] == 1 << 33
+    assert info["bytes_received"] == 777
+    assert info["notsent_bytes"] == 4096
+    assert info["min_rtt"] == 10000
+    assert info["delivery_rate"] == 2_500_000
+    assert info["busy_time"] == 3_000_000
+    assert info["rwnd_limited"] == 1_000_000
+    assert info["sndbuf_limited"] == 250_000
+    assert info["bytes_sent"] == 10_000_000
+    assert info["bytes_retrans"] == 50_000
+    assert info["app_limited"] == 1
+
+
+def test_short_blob_from_older_kernel():
+    # 老内核的结构到 tcpi_total_retrans (104 字节) 为止，之后的字段不出现
+    info = _read(_blob()[:104])
+    assert info["total_retrans"] == 9
+    assert "pacing_rate" not in info
+    assert "busy_time" not in info
+
+
+def test_non_socket_returns_none():
+    assert read_tcp_info(None) is None
+    assert read_tcp_info(object()) is None
+
+
+def test_summary_and_interval():
+    prev = _read(_blob())
+    info = dict(prev, total_retrans=19, bytes_sent=20_000_000, bytes_retrans=60_000,
+                busy_time=4_000_000, rwnd_limited=1_500_000, sndbuf_limited=250_000,
+                bytes_acked=prev["bytes_acked"] + 2_000_000, bytes_received=777)
+    interval = _interval((100.0, prev), 102.0, info)
+    assert interval["interval_s"] == 2.0
+    assert interval["retrans_per_s"] == 5.0
+    assert interval["retrans_share"] == 0.001
+    assert interval["busy_share"] == 0.5
+    assert interval["rwnd_limited_share"] == 0.5
+    assert interval["sndbuf_limited_share"] == 0.0
+    assert interval["acked_rate"] == 1_000_000
+    assert interval["received_rate"] == 0
+
+    s = _summarize(info, interval)
+    assert s["rtt_ms"] == 12.345
+    assert s["min_rtt_ms"] == 10.0
+    assert s["cwnd_bytes"] == 64 * 1448
+    assert s["bottleneck"] == "对端接收窗口"
+    assert _summarize(info, {})["bottleneck"] == ""
+
+
+def test_bottleneck_order():
+    assert bottleneck({"busy_share": 1.0, "sndbuf_limited_share": 0.5, "rwnd_limited_share": 0.5}) == "发送缓冲"
+    assert bottleneck({"busy_share": 1.0, "retrans_share": 0.02}) == "网络丢包"
+    assert bottleneck({"busy_share": 0.01}) == "空闲"
+    assert bottleneck({"busy_share": 0.5, "app_limited": 1}) == "本进程"
+    assert bottleneck({"busy_share": 0.5}) == "网络 (cwnd)"
+
+
+@pytest.mark.skipif(not sys.platform.startswith("linux"), reason="TCP_INFO 仅 Linux")
+def test_real_loopback_socket():
+    srv = socket.create_server(("127.0.0.1", 0))
+    try:
+        with socket.create_connection(srv.getsockname()) as c:
+            conn, _ = srv.accept()
+            with conn:
+                c.sendall(b"x" * 1000)
+                conn.recv(1000)
+                info = read_tcp_info(c)
+                assert info["state"] == 1        # TCP_ESTABLISHED
+                assert info["snd_mss"] > 0
+                assert "bytes_acked" in info
+    finally:
+        srv.close()